@@ -0,0 +1,663 @@
+// archive.c - paged B+tree table file read through the buffer pool
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "archive.h"
+#include "arena.h"
+#include "bloom.h"
+#include "bufpool.h"
+#include "dict.h"
+#include "marks.h"
+#include "names.h"
+#include "psort.h"
+#include "settings.h"
+
+#define ARCHIVE_MAGIC "CMSARC1"
+#define MAX_HEIGHT 16
+#define READ_AHEAD_PAGES 16
+
+enum { PAGE_LEAF = 1, PAGE_INNER = 2 };
+
+// Page 0. Everything is stored in host byte order.
+typedef struct {
+    char magic[8];
+    uint32_t page_size;
+    uint32_t root;
+    uint32_t height;        // 1 when the root is a leaf
+    uint32_t pages;         // pages in the file, header included
+    uint32_t first_leaf;
+    uint32_t rows;
+    // ID filter (bloom.h) in pages of its own, written by ARCHIVE CREATE;
+    // bloom_blocks is 0 in archives made before there was one
+    uint32_t bloom_page;
+    uint32_t bloom_blocks;
+    uint32_t bloom_k;
+    uint32_t bloom_capacity;
+} ArchiveHeader;
+
+typedef struct {
+    int32_t id;
+    int16_t mark;           // tenths
+    uint8_t name_len;
+    uint8_t prog_len;
+    char name[ARCHIVE_NAME_MAX + 1];
+    char prog[ARCHIVE_PROG_MAX + 1];
+} ArchiveRow;
+
+#define LEAF_ROWS ((DB_PAGE_SIZE - 8) / (int)sizeof(ArchiveRow))
+#define INNER_KEYS ((DB_PAGE_SIZE - 12) / 8)
+
+typedef struct {
+    uint16_t kind;
+    uint16_t n;
+    uint32_t next;          // next leaf in ID order, 0 at the end
+    ArchiveRow rows[LEAF_ROWS];
+} LeafPage;
+
+// keys[i] is the smallest ID under child[i + 1]
+typedef struct {
+    uint16_t kind;
+    uint16_t n;             // keys; there are n + 1 children
+    uint32_t unused;
+    int32_t keys[INNER_KEYS];
+    uint32_t child[INNER_KEYS + 1];
+} InnerPage;
+
+static int fd = -1;
+static char path_buf[256];
+static ArchiveHeader hdr;
+
+// The open archive's ID filter: a lookup of an absent ID usually ends here
+// without reading a page. Deleted IDs stay in it until the next ARCHIVE
+// CREATE builds a fresh one.
+static BloomFilter filter;
+static int has_filter;
+static unsigned long filter_probes, filter_negatives, filter_false_pos;
+
+int archiveIsOpen(void) {
+    return fd >= 0;
+}
+
+const char *archivePath(void) {
+    return path_buf;
+}
+
+static int write_header(int to) {
+    unsigned char page[DB_PAGE_SIZE] = { 0 };
+    memcpy(page, &hdr, sizeof(hdr));
+    return pwrite(to, page, DB_PAGE_SIZE, 0) == DB_PAGE_SIZE;
+}
+
+// Persist the pages changed by one command, then the header that points at them.
+static int flush_all(void) {
+    return poolFlush() && write_header(fd);
+}
+
+// first index in keys[0..n) greater than id
+static int upper_bound(const int32_t keys[], int n, int id) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (keys[mid] <= id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// first row in leaf with ID >= id
+static int leaf_lower_bound(const LeafPage *leaf, int id) {
+    int lo = 0, hi = leaf->n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (leaf->rows[mid].id < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Walk from the root to the leaf that would hold id. path[] gets the inner
+// pages and the child taken at each level (root first). Returns the leaf
+// page number, or 0 on a read error.
+static uint32_t descend(int id, uint32_t path_page[], int path_slot[]) {
+    uint32_t page = hdr.root;
+    for (uint32_t level = 1; level < hdr.height; ++level) {
+        InnerPage *inner = (InnerPage *)poolPin(page);
+        if (!inner) return 0;
+        int c = upper_bound(inner->keys, inner->n, id);
+        if (path_page) {
+            path_page[level - 1] = page;
+            path_slot[level - 1] = c;
+        }
+        uint32_t child = inner->child[c];
+        poolUnpin(page, 0);
+        page = child;
+    }
+    return page;
+}
+
+static void print_header_row(void) {
+    printf("%-8s %-20s %-24s %s\n", "ID", "Name", "Programme", "Mark");
+}
+
+static void print_row(const ArchiveRow *r) {
+    char mark[MARK_BUF_LEN];
+    printf("%-8d %-20s %-24s %s\n", r->id, r->name, r->prog, formatMark(r->mark, mark));
+}
+
+static int may_contain(int id) {
+    if (!has_filter) return 1;
+    filter_probes++;
+    if (bloomMayContain(&filter, id)) return 1;
+    filter_negatives++;
+    return 0;
+}
+
+static void filter_missed(void) {
+    if (has_filter) filter_false_pos++;
+}
+
+// Add id to the filter and write its block back at once, so the file never
+// holds a row the filter would rule out.
+static int filter_add(int id) {
+    if (!has_filter) return 1;
+    bloomAdd(&filter, id);
+    uint32_t block = bloomBlockOf(&filter, id);
+    off_t at = (off_t)hdr.bloom_page * DB_PAGE_SIZE + (off_t)block * BLOOM_BLOCK_BYTES;
+    const char *bytes = (const char *)filter.words + (size_t)block * BLOOM_BLOCK_BYTES;
+    return pwrite(fd, bytes, BLOOM_BLOCK_BYTES, at) == BLOOM_BLOCK_BYTES;
+}
+
+static int fill_row(ArchiveRow *r, int id, const char *name, const char *prog, int mark) {
+    size_t name_len = strlen(name);
+    size_t prog_len = strlen(prog);
+    if (name_len > ARCHIVE_NAME_MAX || prog_len > ARCHIVE_PROG_MAX) return 0;
+    memset(r, 0, sizeof(*r));
+    r->id = id;
+    r->mark = (int16_t)mark;
+    r->name_len = (uint8_t)name_len;
+    r->prog_len = (uint8_t)prog_len;
+    memcpy(r->name, name, name_len);
+    memcpy(r->prog, prog, prog_len);
+    return 1;
+}
+
+int archiveCreate(const char *path, const StudentRecord records[], int count) {
+    ArenaMark mark = arenaMark();
+    // leaves are written in ID order
+    SortItem *items = arenaAlloc((size_t)(count > 0 ? count : 1) * sizeof(*items));
+    // first ID and page of every node on the level being built
+    int32_t *level_keys = arenaAlloc((size_t)(count / LEAF_ROWS + 2) * sizeof(*level_keys));
+    uint32_t *level_pages = arenaAlloc((size_t)(count / LEAF_ROWS + 2) * sizeof(*level_pages));
+    unsigned char *page = arenaAlloc(DB_PAGE_SIZE);
+    if (!items || !level_keys || !level_pages || !page) {
+        printf("CMS: ERROR: Out of memory.\n");
+        arenaRelease(mark);
+        return -1;
+    }
+    for (int i = 0; i < count; ++i) {
+        items[i].key = sortKey32(records[i].id, 1);
+        items[i].idx = i;
+    }
+    sortItems(items, count, NULL, NULL, getSetting(SETTING_SORT_PARALLEL_ROWS));
+
+    int out = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        printf("CMS: ERROR: Cannot create archive \"%s\".\n", path);
+        arenaRelease(mark);
+        return -1;
+    }
+
+    ArchiveHeader h = { ARCHIVE_MAGIC, DB_PAGE_SIZE, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+    int ok = 1;
+    int nodes = 0;
+    // sized with room for inserts; without memory the archive just has none
+    BloomFilter ids;
+    int with_filter = bloomInit(&ids, (long)count + count / 4 + 1024, getSetting(SETTING_BLOOM_FP_PER_MILLION));
+
+    // leaves, packed full; an empty table still gets one empty leaf
+    LeafPage *leaf = (LeafPage *)page;
+    memset(page, 0, DB_PAGE_SIZE);
+    leaf->kind = PAGE_LEAF;
+    level_keys[0] = INT_MIN;
+    for (int i = 0; i < count && ok; ++i) {
+        const StudentRecord *r = &records[items[i].idx];
+        ArchiveRow row;
+        // the in-memory table keeps IDs unique; stay safe anyway
+        if (leaf->n > 0 && leaf->rows[leaf->n - 1].id == r->id) continue;
+        if (!fill_row(&row, r->id, recordName(r), programmeName(r->prog), r->mark)) {
+            printf("CMS: WARNING: ID=%d skipped (name or programme too long for the archive).\n", r->id);
+            continue;
+        }
+        if (leaf->n == LEAF_ROWS) {
+            leaf->next = h.pages + 1;
+            ok = pwrite(out, page, DB_PAGE_SIZE, (off_t)h.pages * DB_PAGE_SIZE) == DB_PAGE_SIZE;
+            level_pages[nodes++] = h.pages++;
+            memset(page, 0, DB_PAGE_SIZE);
+            leaf->kind = PAGE_LEAF;
+        }
+        if (leaf->n == 0 && nodes > 0) level_keys[nodes] = r->id;
+        leaf->rows[leaf->n++] = row;
+        h.rows++;
+        if (with_filter) bloomAdd(&ids, r->id);
+    }
+    leaf->next = 0;     // page 0 is the header, so 0 ends the chain
+    ok = ok && pwrite(out, page, DB_PAGE_SIZE, (off_t)h.pages * DB_PAGE_SIZE) == DB_PAGE_SIZE;
+    level_pages[nodes++] = h.pages++;
+
+    // inner levels: spread the children evenly so no node is left nearly empty
+    while (ok && nodes > 1) {
+        int parents = (nodes + INNER_KEYS) / (INNER_KEYS + 1);
+        int at = 0;
+        for (int p = 0; p < parents && ok; ++p) {
+            int take = (nodes - at) / (parents - p);
+            InnerPage *inner = (InnerPage *)page;
+            memset(page, 0, DB_PAGE_SIZE);
+            inner->kind = PAGE_INNER;
+            inner->n = (uint16_t)(take - 1);
+            for (int c = 0; c < take; ++c) {
+                inner->child[c] = level_pages[at + c];
+                if (c > 0) inner->keys[c - 1] = level_keys[at + c];
+            }
+            uint32_t this_page = h.pages++;
+            ok = pwrite(out, page, DB_PAGE_SIZE, (off_t)this_page * DB_PAGE_SIZE) == DB_PAGE_SIZE;
+            level_keys[p] = level_keys[at];
+            level_pages[p] = this_page;
+            at += take;
+        }
+        nodes = parents;
+        h.height++;
+    }
+    h.root = level_pages[0];
+
+    // the filter follows the tree; pages added later go after it
+    if (ok && with_filter) {
+        size_t bytes = (size_t)ids.blocks * BLOOM_BLOCK_BYTES;
+        ok = pwrite(out, ids.words, bytes, (off_t)h.pages * DB_PAGE_SIZE) == (ssize_t)bytes;
+        h.bloom_page = h.pages;
+        h.bloom_blocks = ids.blocks;
+        h.bloom_k = (uint32_t)ids.k;
+        h.bloom_capacity = (uint32_t)ids.capacity;
+        h.pages += (uint32_t)((bytes + DB_PAGE_SIZE - 1) / DB_PAGE_SIZE);
+    }
+    if (with_filter) bloomFree(&ids);
+
+    if (ok) {
+        ArchiveHeader saved = hdr;
+        hdr = h;
+        ok = write_header(out);
+        hdr = saved;
+    }
+    ok = ok && fsync(out) == 0;
+    close(out);
+    arenaRelease(mark);
+    if (!ok) {
+        printf("CMS: ERROR: Writing archive \"%s\" failed.\n", path);
+        return -1;
+    }
+    return (int)h.rows;
+}
+
+int archiveOpen(const char *path) {
+    if (fd >= 0) archiveClose();
+
+    int in = open(path, O_RDWR);
+    if (in < 0) {
+        printf("CMS: ERROR: Cannot open archive \"%s\".\n", path);
+        return 0;
+    }
+    ArchiveHeader h;
+    if (pread(in, &h, sizeof(h), 0) != (ssize_t)sizeof(h) ||
+        memcmp(h.magic, ARCHIVE_MAGIC, sizeof(h.magic)) != 0 ||
+        h.page_size != DB_PAGE_SIZE || h.height == 0 || h.height > MAX_HEIGHT) {
+        printf("CMS: ERROR: \"%s\" is not an archive file.\n", path);
+        close(in);
+        return 0;
+    }
+    if (!poolOpen(in, (int)getSetting(SETTING_BUFFER_POOL_PAGES))) {
+        printf("CMS: ERROR: Out of memory for the buffer pool. Lower buffer_pool_pages.\n");
+        close(in);
+        return 0;
+    }
+    fd = in;
+    hdr = h;
+    strncpy(path_buf, path, sizeof(path_buf) - 1);
+    path_buf[sizeof(path_buf) - 1] = '\0';
+
+    // without its filter an archive still works, one page path per lookup
+    filter_probes = filter_negatives = filter_false_pos = 0;
+    if (h.bloom_blocks > 0) {
+        size_t bytes = (size_t)h.bloom_blocks * BLOOM_BLOCK_BYTES;
+        uint64_t *words = aligned_alloc(BLOOM_BLOCK_BYTES, bytes);
+        if (words && pread(in, words, bytes, (off_t)h.bloom_page * DB_PAGE_SIZE) == (ssize_t)bytes) {
+            bloomAdopt(&filter, words, h.bloom_blocks, (int)h.bloom_k, h.bloom_capacity, h.rows);
+            has_filter = 1;
+        } else {
+            free(words);
+        }
+    }
+    return 1;
+}
+
+int archiveClose(void) {
+    if (fd < 0) return 1;
+    int ok = flush_all();
+    ok = poolClose() && ok;
+    ok = fsync(fd) == 0 && ok;
+    close(fd);
+    fd = -1;
+    path_buf[0] = '\0';
+    if (has_filter) bloomFree(&filter);
+    has_filter = 0;
+    return ok;
+}
+
+int archiveContains(int id) {
+    if (!may_contain(id)) return 0;
+    uint32_t page = descend(id, NULL, NULL);
+    LeafPage *leaf = page ? (LeafPage *)poolPin(page) : NULL;
+    if (!leaf) return -1;
+    int pos = leaf_lower_bound(leaf, id);
+    int found = pos < leaf->n && leaf->rows[pos].id == id;
+    poolUnpin(page, 0);
+    if (!found) filter_missed();
+    return found;
+}
+
+int archiveQuery(int id) {
+    if (!may_contain(id)) {
+        printf("CMS: The record with ID=%d does not exist.\n", id);
+        return 0;
+    }
+    uint32_t page = descend(id, NULL, NULL);
+    LeafPage *leaf = page ? (LeafPage *)poolPin(page) : NULL;
+    if (!leaf) return -1;
+    int pos = leaf_lower_bound(leaf, id);
+    int found = pos < leaf->n && leaf->rows[pos].id == id;
+    if (found) {
+        printf("CMS: The record with ID=%d is found in the archive.\n", id);
+        print_header_row();
+        print_row(&leaf->rows[pos]);
+    } else {
+        printf("CMS: The record with ID=%d does not exist.\n", id);
+        filter_missed();
+    }
+    poolUnpin(page, 0);
+    return found;
+}
+
+// Print leaves from the one holding lo until an ID passes hi.
+static int scan(int lo, int hi) {
+    uint32_t page = descend(lo, NULL, NULL);
+    uint32_t ahead_until = 0;
+    int shown = 0;
+    while (page != 0) {
+        // leaves written by ARCHIVE CREATE are consecutive, so asking for the
+        // next few pages keeps the disk busy while this one is printed
+        if (page + 1 >= ahead_until) {
+            poolReadAhead(page + 1, READ_AHEAD_PAGES);
+            ahead_until = page + 1 + READ_AHEAD_PAGES;
+        }
+        LeafPage *leaf = (LeafPage *)poolPin(page);
+        if (!leaf) return -1;
+        for (int k = leaf_lower_bound(leaf, lo); k < leaf->n; ++k) {
+            if (leaf->rows[k].id > hi) {
+                poolUnpin(page, POOL_COLD);
+                return shown;
+            }
+            print_row(&leaf->rows[k]);
+            shown++;
+        }
+        uint32_t next = leaf->next;
+        poolUnpin(page, POOL_COLD);
+        page = next;
+    }
+    return shown;
+}
+
+int archiveShowAll(void) {
+    printf("CMS: Here are all the records found in the archive \"%s\".\n", path_buf);
+    print_header_row();
+    int shown = scan(INT_MIN, INT_MAX);
+    if (shown == 0) printf("No records.\n");
+    return shown < 0 ? -1 : 1;
+}
+
+int archiveShowRange(int lo, int hi) {
+    printf("CMS: Here are the records with ID between %d and %d.\n", lo, hi);
+    print_header_row();
+    int shown = scan(lo, hi);
+    if (shown == 0) printf("No records.\n");
+    return shown;
+}
+
+// Add key/child to the inner page at path level, splitting upwards as needed.
+static int insert_separator(uint32_t path_page[], int path_slot[], int level, int32_t key, uint32_t child) {
+    for (; level >= 0; --level) {
+        uint32_t page = path_page[level];
+        int at = path_slot[level];
+        InnerPage *inner = (InnerPage *)poolPin(page);
+        if (!inner) return 0;
+
+        if (inner->n < INNER_KEYS) {
+            memmove(&inner->keys[at + 1], &inner->keys[at], (size_t)(inner->n - at) * sizeof(int32_t));
+            memmove(&inner->child[at + 2], &inner->child[at + 1], (size_t)(inner->n - at) * sizeof(uint32_t));
+            inner->keys[at] = key;
+            inner->child[at + 1] = child;
+            inner->n++;
+            poolUnpin(page, POOL_DIRTY);
+            return 1;
+        }
+
+        // full: lay the keys out with the new one, then cut in the middle
+        static int32_t keys[INNER_KEYS + 1];
+        static uint32_t kids[INNER_KEYS + 2];
+        int n = inner->n;
+        memcpy(keys, inner->keys, (size_t)at * sizeof(int32_t));
+        keys[at] = key;
+        memcpy(&keys[at + 1], &inner->keys[at], (size_t)(n - at) * sizeof(int32_t));
+        memcpy(kids, inner->child, (size_t)(at + 1) * sizeof(uint32_t));
+        kids[at + 1] = child;
+        memcpy(&kids[at + 2], &inner->child[at + 1], (size_t)(n - at) * sizeof(uint32_t));
+        n++;
+
+        uint32_t right_page = hdr.pages;
+        InnerPage *right = (InnerPage *)poolPinNew(right_page);
+        if (!right) {
+            poolUnpin(page, 0);
+            return 0;
+        }
+        hdr.pages++;
+        int mid = n / 2;    // keys[mid] moves up
+        inner->n = (uint16_t)mid;
+        memcpy(inner->keys, keys, (size_t)mid * sizeof(int32_t));
+        memcpy(inner->child, kids, (size_t)(mid + 1) * sizeof(uint32_t));
+        right->kind = PAGE_INNER;
+        right->n = (uint16_t)(n - mid - 1);
+        memcpy(right->keys, &keys[mid + 1], (size_t)right->n * sizeof(int32_t));
+        memcpy(right->child, &kids[mid + 1], (size_t)(right->n + 1) * sizeof(uint32_t));
+        poolUnpin(page, POOL_DIRTY);
+        poolUnpin(right_page, POOL_DIRTY);
+        key = keys[mid];
+        child = right_page;
+    }
+
+    // the root split: grow a new root above it
+    uint32_t root_page = hdr.pages;
+    InnerPage *root = (InnerPage *)poolPinNew(root_page);
+    if (!root) return 0;
+    hdr.pages++;
+    root->kind = PAGE_INNER;
+    root->n = 1;
+    root->keys[0] = key;
+    root->child[0] = hdr.root;
+    root->child[1] = child;
+    poolUnpin(root_page, POOL_DIRTY);
+    hdr.root = root_page;
+    hdr.height++;
+    return 1;
+}
+
+int archiveInsert(int id, const char *name, const char *prog, int mark) {
+    ArchiveRow row;
+    if (!fill_row(&row, id, name, prog, mark)) {
+        printf("CMS: The archive holds names up to %d and programmes up to %d characters.\n",
+               ARCHIVE_NAME_MAX, ARCHIVE_PROG_MAX);
+        return 0;
+    }
+    if (hdr.height >= MAX_HEIGHT) {
+        printf("CMS: The archive is full.\n");
+        return 0;
+    }
+
+    uint32_t path_page[MAX_HEIGHT];
+    int path_slot[MAX_HEIGHT];
+    uint32_t page = descend(id, path_page, path_slot);
+    LeafPage *leaf = page ? (LeafPage *)poolPin(page) : NULL;
+    if (!leaf) return -1;
+
+    int pos = leaf_lower_bound(leaf, id);
+    if (pos < leaf->n && leaf->rows[pos].id == id) {
+        poolUnpin(page, 0);
+        printf("CMS: Record with ID %d already exists.\n", id);
+        return 0;
+    }
+    if (!filter_add(id)) {
+        poolUnpin(page, 0);
+        return -1;
+    }
+
+    if (leaf->n < LEAF_ROWS) {
+        memmove(&leaf->rows[pos + 1], &leaf->rows[pos], (size_t)(leaf->n - pos) * sizeof(ArchiveRow));
+        leaf->rows[pos] = row;
+        leaf->n++;
+        poolUnpin(page, POOL_DIRTY);
+    } else {
+        // split: the upper half moves to a new leaf linked in after this one
+        uint32_t right_page = hdr.pages;
+        LeafPage *right = (LeafPage *)poolPinNew(right_page);
+        if (!right) {
+            poolUnpin(page, 0);
+            return -1;
+        }
+        hdr.pages++;
+        int keep = (LEAF_ROWS + 1) / 2;
+        right->kind = PAGE_LEAF;
+        right->n = (uint16_t)(leaf->n - keep);
+        memcpy(right->rows, &leaf->rows[keep], (size_t)right->n * sizeof(ArchiveRow));
+        leaf->n = (uint16_t)keep;
+        right->next = leaf->next;
+        leaf->next = right_page;
+
+        LeafPage *into = pos <= keep ? leaf : right;
+        int at = pos <= keep ? pos : pos - keep;
+        memmove(&into->rows[at + 1], &into->rows[at], (size_t)(into->n - at) * sizeof(ArchiveRow));
+        into->rows[at] = row;
+        into->n++;
+
+        int32_t separator = right->rows[0].id;
+        poolUnpin(page, POOL_DIRTY);
+        poolUnpin(right_page, POOL_DIRTY);
+        if (!insert_separator(path_page, path_slot, (int)hdr.height - 2, separator, right_page)) return -1;
+    }
+    hdr.rows++;
+    return flush_all() ? 1 : -1;
+}
+
+int archiveUpdate(int id, const char *field, const char *value) {
+    if (!may_contain(id)) {
+        printf("CMS: The record with ID=%d does not exist.\n", id);
+        return 0;
+    }
+    uint32_t page = descend(id, NULL, NULL);
+    LeafPage *leaf = page ? (LeafPage *)poolPin(page) : NULL;
+    if (!leaf) return -1;
+    int pos = leaf_lower_bound(leaf, id);
+    if (pos >= leaf->n || leaf->rows[pos].id != id) {
+        poolUnpin(page, 0);
+        printf("CMS: The record with ID=%d does not exist.\n", id);
+        filter_missed();
+        return 0;
+    }
+
+    ArchiveRow *r = &leaf->rows[pos];
+    ArchiveRow next = *r;
+    int ok = 1;
+    if (strcmp(field, "Name") == 0) {
+        ok = fill_row(&next, r->id, value, r->prog, r->mark);
+    } else if (strcmp(field, "Programme") == 0) {
+        ok = fill_row(&next, r->id, r->name, value, r->mark);
+    } else if (strcmp(field, "Mark") == 0) {
+        int tenths = 0;
+        if (!parseMark(value, &tenths) || tenths < MARK_MIN || tenths > MARK_MAX) {
+            poolUnpin(page, 0);
+            printf("CMS: Mark must be a number between 0.0 and 100.0. Update not applied.\n");
+            return 0;
+        }
+        next.mark = (int16_t)tenths;
+    }
+    if (!ok) {
+        poolUnpin(page, 0);
+        printf("CMS: The archive holds names up to %d and programmes up to %d characters. Update not applied.\n",
+               ARCHIVE_NAME_MAX, ARCHIVE_PROG_MAX);
+        return 0;
+    }
+    *r = next;
+    poolUnpin(page, POOL_DIRTY);
+    if (!flush_all()) return -1;
+    printf("CMS: The record with ID=%d is successfully updated.\n", id);
+    return 1;
+}
+
+int archiveDelete(int id) {
+    // Leaves are not merged when they run low: the file is append-mostly and
+    // an emptied leaf simply stays in the chain until the next ARCHIVE CREATE.
+    if (!may_contain(id)) return 0;
+    uint32_t page = descend(id, NULL, NULL);
+    LeafPage *leaf = page ? (LeafPage *)poolPin(page) : NULL;
+    if (!leaf) return -1;
+    int pos = leaf_lower_bound(leaf, id);
+    if (pos >= leaf->n || leaf->rows[pos].id != id) {
+        poolUnpin(page, 0);
+        filter_missed();
+        return 0;
+    }
+    memmove(&leaf->rows[pos], &leaf->rows[pos + 1], (size_t)(leaf->n - pos - 1) * sizeof(ArchiveRow));
+    leaf->n--;
+    poolUnpin(page, POOL_DIRTY);
+    hdr.rows--;
+    return flush_all() ? 1 : -1;
+}
+
+void archiveStatus(void) {
+    if (fd < 0) {
+        printf("CMS: No archive is open.\n");
+        return;
+    }
+    PoolStats s;
+    poolStats(&s);
+    unsigned long lookups = s.hits + s.misses;
+    printf("CMS: Archive \"%s\".\n", path_buf);
+    printf("%-20s %u\n", "Records", hdr.rows);
+    printf("%-20s %u (%u KB)\n", "Pages", hdr.pages, hdr.pages * (DB_PAGE_SIZE / 1024));
+    printf("%-20s %u\n", "Tree height", hdr.height);
+    printf("%-20s %d (%d KB)\n", "Pool frames", s.frames, s.frames * (DB_PAGE_SIZE / 1024));
+    printf("%-20s %lu (%.1f%%)\n", "Pool hits", s.hits, lookups ? 100.0 * (double)s.hits / (double)lookups : 0.0);
+    printf("%-20s %lu\n", "Pages read", s.misses);
+    printf("%-20s %lu\n", "Pages written", s.writes);
+    printf("%-20s %lu\n", "Evictions", s.evictions);
+    if (!has_filter) {
+        printf("%-20s none (made before ID filters; ARCHIVE CREATE adds one)\n", "ID filter");
+        return;
+    }
+    printf("%-20s %lu KB, sized for %u IDs%s\n", "ID filter", (unsigned long)filter.blocks * BLOOM_BLOCK_BYTES / 1024,
+           hdr.bloom_capacity, hdr.rows > hdr.bloom_capacity ? " (outgrown: ARCHIVE CREATE rebuilds it)" : "");
+    printf("%-20s %.0f per million\n", "Expected FP", bloomExpectedFp(&filter, filter.keys));
+    printf("%-20s %lu of %lu lookups, no page read\n", "Ruled out", filter_negatives, filter_probes);
+    printf("%-20s %lu\n", "False positives", filter_false_pos);
+}
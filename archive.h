@@ -0,0 +1,43 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "records.h"
+
+// Paged on-disk table for data sets larger than memory. The archive file is
+// a B+tree on student ID in 4 KB pages: page 0 is the header, leaves hold
+// fixed-width rows and are chained in ID order. Pages are read through the
+// buffer pool (bufpool.h), so a lookup or edit only touches the pages on one
+// root-to-leaf path and SHOW ALL streams the leaves with read-ahead.
+//
+// While an archive is open, QUERY, INSERT, UPDATE, DELETE and SHOW ALL work
+// on it instead of the in-memory table.
+
+#define ARCHIVE_NAME_MAX 71     // longest name a row can hold
+#define ARCHIVE_PROG_MAX 39     // longest programme
+
+// Write the table out as a new archive file (replacing any file of that
+// name). Returns the number of rows written, or -1 with a message on error.
+int archiveCreate(const char *path, const StudentRecord records[], int count);
+
+// Returns 1 when opened; otherwise prints the reason and returns 0.
+int archiveOpen(const char *path);
+
+// Flush and close the open archive. Returns 0 if changes could not be written.
+int archiveClose(void);
+
+int archiveIsOpen(void);
+const char *archivePath(void);
+
+// Each returns 1 on success, 0 for a user error (message printed), -1 on an
+// I/O error.
+int archiveQuery(int id);
+int archiveShowAll(void);
+int archiveShowRange(int lo, int hi);   // returns rows shown, or -1
+int archiveInsert(int id, const char *name, const char *prog, int mark);
+int archiveUpdate(int id, const char *field, const char *value);
+int archiveDelete(int id);
+int archiveContains(int id);            // 1, 0, or -1 on an I/O error
+
+void archiveStatus(void);
+
+#endif
@@ -0,0 +1,203 @@
+// arena.c - per-command scratch arena and the record block pool
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "settings.h"
+
+#define ARENA_ALIGN 16
+#define MIN_CHUNK_BYTES ((size_t)1 << 20)
+
+typedef struct Chunk {
+    struct Chunk *next;
+    size_t size;            // usable bytes after the header
+    size_t used;
+    size_t pad;             // keeps the data ARENA_ALIGN aligned
+} Chunk;
+
+_Static_assert(sizeof(Chunk) % ARENA_ALIGN == 0, "chunk header must keep data aligned");
+
+// Chunks in allocation order. cur is the one being bumped; any after it are
+// empty spares left by an arenaRelease.
+static Chunk *first = NULL;
+static Chunk *cur = NULL;
+static size_t reserved = 0;     // usable bytes over all chunks
+static size_t live = 0;         // bytes handed out and not yet released
+static size_t command_peak = 0;
+
+static unsigned long arena_allocs = 0;
+static unsigned long chunk_mallocs = 0;
+static unsigned long commands = 0;
+static unsigned long spilled = 0;   // commands that needed more than one chunk
+static size_t last_peak = 0, max_peak = 0;
+
+// Free blocks are chained through their first bytes.
+typedef struct FreeBlock {
+    struct FreeBlock *next;
+} FreeBlock;
+
+static FreeBlock *free_blocks = NULL;
+static long blocks_free = 0, blocks_out = 0, blocks_peak = 0;
+static unsigned long block_gets = 0, block_reuses = 0, block_mallocs = 0;
+
+static Chunk *new_chunk(size_t size) {
+    if (size > SIZE_MAX - sizeof(Chunk)) return NULL;
+    Chunk *c = malloc(sizeof(Chunk) + size);
+    if (!c) return NULL;
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+    reserved += size;
+    chunk_mallocs++;
+    return c;
+}
+
+static void free_chunks(void) {
+    while (first) {
+        Chunk *next = first->next;
+        free(first);
+        first = next;
+    }
+    cur = NULL;
+    reserved = 0;
+}
+
+void *arenaAlloc(size_t bytes) {
+    if (bytes > SIZE_MAX - ARENA_ALIGN) return NULL;
+    size_t need = bytes ? (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1) : ARENA_ALIGN;
+
+    // spares after cur are empty; move on to the first that fits
+    while (cur && cur->size - cur->used < need && cur->next) cur = cur->next;
+    if (!cur || cur->size - cur->used < need) {
+        // grow geometrically so a big command needs few chunks
+        size_t size = reserved > MIN_CHUNK_BYTES ? reserved : MIN_CHUNK_BYTES;
+        if (size < need) size = need;
+        Chunk *c = new_chunk(size);
+        if (!c) return NULL;
+        if (cur) {
+            c->next = cur->next;
+            cur->next = c;
+        } else {
+            first = c;
+        }
+        cur = c;
+    }
+
+    void *p = (unsigned char *)(cur + 1) + cur->used;
+    cur->used += need;
+    live += need;
+    if (live > command_peak) command_peak = live;
+    arena_allocs++;
+    return p;
+}
+
+void *arenaCalloc(size_t n, size_t size) {
+    if (size && n > SIZE_MAX / size) return NULL;
+    void *p = arenaAlloc(n * size);
+    if (p) memset(p, 0, n * size);
+    return p;
+}
+
+ArenaMark arenaMark(void) {
+    ArenaMark m = { cur, cur ? cur->used : 0, live };
+    return m;
+}
+
+void arenaRelease(ArenaMark mark) {
+    Chunk *c = mark.chunk;
+    if (c) {
+        c->used = mark.used;
+        c = c->next;
+    } else {
+        c = first;
+    }
+    for (; c; c = c->next) c->used = 0;
+    cur = mark.chunk ? mark.chunk : first;
+    live = mark.live;
+}
+
+// Give back free record blocks beyond record_pool_blocks.
+static void trim_pool(void) {
+    long keep = getSetting(SETTING_RECORD_POOL_BLOCKS);
+    while (blocks_free > keep) {
+        FreeBlock *b = free_blocks;
+        free_blocks = b->next;
+        free(b);
+        blocks_free--;
+    }
+}
+
+void arenaReset(void) {
+    if (command_peak > 0) {
+        commands++;
+        last_peak = command_peak;
+        if (command_peak > max_peak) max_peak = command_peak;
+    }
+
+    size_t keep = (size_t)getSetting(SETTING_ARENA_KEEP_KB) * 1024;
+    if (first && first->next) {
+        // several chunks: swap them for one that holds this command's peak
+        spilled++;
+        size_t want = command_peak > MIN_CHUNK_BYTES ? command_peak : MIN_CHUNK_BYTES;
+        free_chunks();
+        if (want <= keep) cur = first = new_chunk(want);
+    } else if (first && first->size > keep) {
+        free_chunks();
+    }
+    if (first) first->used = 0;
+    cur = first;
+    live = 0;
+    command_peak = 0;
+
+    trim_pool();
+}
+
+StudentRecord *recordBlockGet(void) {
+    block_gets++;
+    StudentRecord *block;
+    if (free_blocks) {
+        FreeBlock *b = free_blocks;
+        free_blocks = b->next;
+        blocks_free--;
+        block_reuses++;
+        block = (StudentRecord *)b;
+    } else {
+        block = malloc(RECORD_BLOCK_ROWS * sizeof(*block));
+        if (!block) return NULL;
+        block_mallocs++;
+    }
+    if (++blocks_out > blocks_peak) blocks_peak = blocks_out;
+    return block;
+}
+
+void recordBlockPut(StudentRecord *block) {
+    if (!block) return;
+    FreeBlock *b = (FreeBlock *)block;
+    b->next = free_blocks;
+    free_blocks = b;
+    blocks_free++;
+    blocks_out--;
+}
+
+void showMemory(void) {
+    int chunks = 0;
+    for (const Chunk *c = first; c; c = c->next) chunks++;
+    printf("CMS: Scratch memory.\n");
+    printf("Command arena\n");
+    printf("%-20s %lu KB in %d chunk(s), %lu KB kept between commands (arena_keep_kb)\n", "Reserved",
+           (unsigned long)(reserved / 1024), chunks, (unsigned long)getSetting(SETTING_ARENA_KEEP_KB));
+    printf("%-20s %lu KB latest, %lu KB largest (per command)\n", "Peak use",
+           (unsigned long)(last_peak / 1024), (unsigned long)(max_peak / 1024));
+    printf("%-20s %lu over %lu command(s)\n", "Allocations", arena_allocs, commands);
+    printf("%-20s %lu (%lu command(s) outgrew one chunk)\n", "Chunk mallocs", chunk_mallocs, spilled);
+    printf("Record pool (%d rows per block, %lu KB)\n", RECORD_BLOCK_ROWS,
+           (unsigned long)(RECORD_BLOCK_ROWS * sizeof(StudentRecord) / 1024));
+    printf("%-20s %ld in use (%ld at most), %ld free, up to %ld kept (record_pool_blocks)\n", "Blocks",
+           blocks_out, blocks_peak, blocks_free, getSetting(SETTING_RECORD_POOL_BLOCKS));
+    printf("%-20s %lu\n", "Gets", block_gets);
+    printf("%-20s %lu (%.1f%%)\n", "Reused", block_reuses,
+           block_gets ? 100.0 * (double)block_reuses / (double)block_gets : 0.0);
+    printf("%-20s %lu\n", "Block mallocs", block_mallocs);
+}
@@ -0,0 +1,51 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#include "records.h"
+
+// Scratch memory for one command. arenaAlloc bumps a pointer through large
+// chunks and nothing is freed on its own: the main loop calls arenaReset
+// after every command, which empties the arena and keeps its memory
+// (up to arena_keep_kb) for the next one. A command that needed several
+// chunks gets them merged into one of its peak size, so the same command
+// next time runs from a single chunk.
+//
+// Command handlers just allocate and leave the rest to the reset. Helpers
+// that can run many times in one command (index builds, sorts) take a mark
+// first and release back to it before returning.
+//
+// Only the thread running commands may use it: the main thread, or the
+// replication thread while it holds the table lock (repl.h). Not worker
+// tasks (threads.h).
+
+// 16-byte aligned, or NULL when out of memory.
+void *arenaAlloc(size_t bytes);
+void *arenaCalloc(size_t n, size_t size);
+
+typedef struct {
+    void *chunk;
+    size_t used;
+    size_t live;
+} ArenaMark;
+
+ArenaMark arenaMark(void);
+void arenaRelease(ArenaMark mark);
+
+// Called after each command. Also trims the record pool.
+void arenaReset(void);
+
+// Fixed-size blocks of record slots for rows that are staged outside the
+// table (IMPORT, columnar queries). Returned blocks go on a free list and
+// are reused; arenaReset keeps up to record_pool_blocks of them.
+#define RECORD_BLOCK_ROWS 8192
+
+// NULL when out of memory.
+StudentRecord *recordBlockGet(void);
+void recordBlockPut(StudentRecord *block);
+
+// SHOW MEMORY
+void showMemory(void);
+
+#endif
@@ -0,0 +1,114 @@
+// bloom.c - blocked Bloom filter for fast "no such ID" answers
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bloom.h"
+
+#define BLOCK_BITS (BLOOM_BLOCK_BYTES * 8)
+#define BLOCK_WORDS (BLOOM_BLOCK_BYTES / 8)
+#define MAX_K 16
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// The high half of the hash picks the block. The bit positions inside it
+// are the top bits of a 64-bit LCG seeded from the whole hash: cheap, and
+// independent enough even for a k of 16 (double hashing in a 512-bit block
+// correlates the positions and misses low targets by several times).
+static uint32_t block_of(const BloomFilter *f, uint64_t h) {
+    return (uint32_t)(((h >> 32) * (uint64_t)f->blocks) >> 32);
+}
+
+static uint64_t next_bit(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> (64 - 9);
+}
+
+uint32_t bloomBlockOf(const BloomFilter *f, int32_t key) {
+    return block_of(f, mix64((uint32_t)key));
+}
+
+void bloomAdd(BloomFilter *f, int32_t key) {
+    uint64_t h = mix64((uint32_t)key);
+    uint64_t *block = f->words + (size_t)block_of(f, h) * BLOCK_WORDS;
+    uint64_t state = h;
+    for (int i = 0; i < f->k; ++i) {
+        uint64_t bit = next_bit(&state);
+        block[bit >> 6] |= 1ULL << (bit & 63);
+    }
+    f->keys++;
+}
+
+int bloomMayContain(const BloomFilter *f, int32_t key) {
+    uint64_t h = mix64((uint32_t)key);
+    const uint64_t *block = f->words + (size_t)block_of(f, h) * BLOCK_WORDS;
+    uint64_t state = h;
+    for (int i = 0; i < f->k; ++i) {
+        uint64_t bit = next_bit(&state);
+        if (!(block[bit >> 6] & (1ULL << (bit & 63)))) return 0;
+    }
+    return 1;
+}
+
+// False positive rate for k bits per key over blocks blocks holding keys
+// keys: the per-block rate averaged over the Poisson spread of keys to
+// blocks, which is what makes a blocked filter a little worse than a
+// classic one of the same size.
+static double expected_fp(int k, uint32_t blocks, long keys) {
+    double lambda = (double)keys / (double)blocks;
+    double p = exp(-lambda), total = 0;
+    int last = (int)(lambda + 12 * sqrt(lambda) + 20);
+    for (int i = 0; i <= last; ++i) {
+        total += p * pow(1 - pow(1 - 1.0 / BLOCK_BITS, (double)k * i), k);
+        p *= lambda / (i + 1);
+    }
+    return total;
+}
+
+double bloomExpectedFp(const BloomFilter *f, long keys) {
+    return f->blocks ? expected_fp(f->k, f->blocks, keys) * 1e6 : 1e6;
+}
+
+int bloomInit(BloomFilter *f, long capacity, long fp_per_million) {
+    double p = (double)fp_per_million / 1e6;
+    if (capacity < 1) capacity = 1;
+    double bits_per_key = -log(p) / (log(2) * log(2));
+    int k = (int)lround(bits_per_key * log(2));
+    k = k < 1 ? 1 : k > MAX_K ? MAX_K : k;
+
+    // start from the classic size and grow until the blocked layout meets p
+    double blocks = ceil((double)capacity * bits_per_key / BLOCK_BITS);
+    if (blocks < 1) blocks = 1;
+    for (int i = 0; i < 64 && expected_fp(k, (uint32_t)blocks, capacity) > p; ++i) blocks = ceil(blocks * 1.05);
+    if (blocks > UINT32_MAX / 2) return 0;
+
+    memset(f, 0, sizeof(*f));
+    // blocks start on cache line boundaries
+    f->words = aligned_alloc(BLOOM_BLOCK_BYTES, (size_t)blocks * BLOOM_BLOCK_BYTES);
+    if (!f->words) return 0;
+    memset(f->words, 0, (size_t)blocks * BLOOM_BLOCK_BYTES);
+    f->blocks = (uint32_t)blocks;
+    f->k = k;
+    f->capacity = capacity;
+    return 1;
+}
+
+void bloomAdopt(BloomFilter *f, uint64_t *words, uint32_t blocks, int k, long capacity, long keys) {
+    f->words = words;
+    f->blocks = blocks;
+    f->k = k < 1 ? 1 : k > MAX_K ? MAX_K : k;
+    f->capacity = capacity;
+    f->keys = keys;
+}
+
+void bloomFree(BloomFilter *f) {
+    free(f->words);
+    memset(f, 0, sizeof(*f));
+}
@@ -0,0 +1,40 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <stdint.h>
+
+// Blocked Bloom filter over student IDs. A key's bits all fall in one
+// 64-byte block (one cache line) picked by its hash, so a probe reads a
+// single line. "No" answers are certain. "Maybe" answers for absent keys
+// come at about the false positive rate the filter was sized for, as long
+// as it holds no more keys than its capacity. Keys cannot be removed; a
+// deleted key stays a false positive until the filter is rebuilt.
+
+#define BLOOM_BLOCK_BYTES 64
+
+typedef struct {
+    uint64_t *words;        // blocks * 8 words
+    uint32_t blocks;
+    int k;                  // bits set per key
+    long capacity;          // keys it was sized for
+    long keys;              // keys added
+} BloomFilter;
+
+// Size f for capacity keys with fp_per_million false positives per million
+// probes of absent keys. Returns 0 when out of memory.
+int bloomInit(BloomFilter *f, long capacity, long fp_per_million);
+
+// Set up f over words loaded from elsewhere (blocks * 8 of them, owned by f).
+void bloomAdopt(BloomFilter *f, uint64_t *words, uint32_t blocks, int k, long capacity, long keys);
+void bloomFree(BloomFilter *f);
+
+void bloomAdd(BloomFilter *f, int32_t key);
+int bloomMayContain(const BloomFilter *f, int32_t key);
+
+// The block holding key's bits, for writing back just that block.
+uint32_t bloomBlockOf(const BloomFilter *f, int32_t key);
+
+// Expected false positives per million absent keys with keys keys added.
+double bloomExpectedFp(const BloomFilter *f, long keys);
+
+#endif
@@ -0,0 +1,488 @@
+// btree.c - cache-line B+tree index from student ID to table slot
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "btree.h"
+
+#define NODE_BYTES 64
+#define LEAF_KEYS 7
+#define INNER_KEYS 7
+#define LEAF_MIN (LEAF_KEYS / 2)
+#define INNER_MIN (INNER_KEYS / 2)
+#define NIL UINT32_MAX
+
+// Level tells a node's kind, so a node needs no tag: with height h the root
+// is at level h and leaves are at level 0.
+typedef union {
+    struct {
+        int32_t n;
+        uint32_t next;                  // next leaf in key order
+        int32_t key[LEAF_KEYS];
+        int32_t slot[LEAF_KEYS];
+    } leaf;
+    struct {
+        int32_t n;                      // keys; children = n + 1
+        int32_t key[INNER_KEYS];        // child[i] holds keys < key[i] <= child[i + 1]
+        uint32_t child[INNER_KEYS + 1];
+    } inner;
+    uint32_t free_next;
+} Node;
+
+_Static_assert(sizeof(Node) == NODE_BYTES, "B+tree node must be one cache line");
+
+static Node *pool = NULL;
+static uint32_t pool_cap = 0;
+static uint32_t pool_used = 0;
+static uint32_t free_list = NIL;
+static uint32_t root = NIL;
+static int height = 0;
+static int entries = 0;
+
+// make sure k more nodes can be taken from the pool without allocating
+static int reserve_nodes(uint32_t k) {
+    if (pool_cap - pool_used >= k) return 1;
+    uint32_t new_cap = pool_cap ? pool_cap : 1024;
+    while (new_cap - pool_used < k) new_cap *= 2;
+    Node *grown = aligned_alloc(NODE_BYTES, (size_t)new_cap * sizeof(Node));
+    if (!grown) return 0;
+    if (pool) memcpy(grown, pool, (size_t)pool_used * sizeof(Node));
+    free(pool);
+    pool = grown;
+    pool_cap = new_cap;
+    return 1;
+}
+
+// a zeroed node; leaves get their next link set by the caller
+static uint32_t new_node(void) {
+    uint32_t id;
+    if (free_list != NIL) {
+        id = free_list;
+        free_list = pool[id].free_next;
+    } else {
+        if (!reserve_nodes(1)) return NIL;
+        id = pool_used++;
+    }
+    memset(&pool[id], 0, sizeof(Node));
+    return id;
+}
+
+static void free_node(uint32_t id) {
+    pool[id].free_next = free_list;
+    free_list = id;
+}
+
+void btreeClear(void) {
+    pool_used = 0;
+    free_list = NIL;
+    root = NIL;
+    height = 0;
+    entries = 0;
+}
+
+int btreeCount(void) {
+    return entries;
+}
+
+// number of keys in k[0..n) that are <= id: the child to descend into
+static int route(const int32_t k[], int n, int id) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (k[mid] <= id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// first position in k[0..n) with key >= id
+static int lower_bound(const int32_t k[], int n, int id) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (k[mid] < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static uint32_t find_leaf(int id) {
+    uint32_t node = root;
+    for (int level = height; level > 0; --level) {
+        node = pool[node].inner.child[route(pool[node].inner.key, pool[node].inner.n, id)];
+    }
+    return node;
+}
+
+int btreeFind(int id) {
+    if (root == NIL) return -1;
+    const Node *leaf = &pool[find_leaf(id)];
+    int pos = lower_bound(leaf->leaf.key, leaf->leaf.n, id);
+    return pos < leaf->leaf.n && leaf->leaf.key[pos] == id ? leaf->leaf.slot[pos] : -1;
+}
+
+int btreeSetSlot(int id, int slot) {
+    if (root == NIL) return 0;
+    Node *leaf = &pool[find_leaf(id)];
+    int pos = lower_bound(leaf->leaf.key, leaf->leaf.n, id);
+    if (pos == leaf->leaf.n || leaf->leaf.key[pos] != id) return 0;
+    leaf->leaf.slot[pos] = slot;
+    return 1;
+}
+
+// Insert below node. On a split, *up_key / *up_node describe the new right
+// sibling for the parent. Returns 1 added, 0 duplicate, -1 out of memory.
+static int insert_rec(uint32_t node, int level, int id, int slot, int32_t *up_key, uint32_t *up_node) {
+    *up_node = NIL;
+
+    if (level == 0) {
+        Node *lf = &pool[node];
+        int pos = lower_bound(lf->leaf.key, lf->leaf.n, id);
+        if (pos < lf->leaf.n && lf->leaf.key[pos] == id) return 0;
+
+        if (lf->leaf.n < LEAF_KEYS) {
+            int move = lf->leaf.n - pos;
+            memmove(&lf->leaf.key[pos + 1], &lf->leaf.key[pos], (size_t)move * sizeof(int32_t));
+            memmove(&lf->leaf.slot[pos + 1], &lf->leaf.slot[pos], (size_t)move * sizeof(int32_t));
+            lf->leaf.key[pos] = id;
+            lf->leaf.slot[pos] = slot;
+            lf->leaf.n++;
+            return 1;
+        }
+
+        // full: split the LEAF_KEYS + 1 entries between this leaf and a new one
+        uint32_t right = new_node();
+        Node *rt = &pool[right];
+        int32_t keys[LEAF_KEYS + 1], slots[LEAF_KEYS + 1];
+        for (int i = 0, j = 0; i <= LEAF_KEYS; ++i) {
+            if (i == pos) {
+                keys[i] = id;
+                slots[i] = slot;
+            } else {
+                keys[i] = lf->leaf.key[j];
+                slots[i] = lf->leaf.slot[j];
+                j++;
+            }
+        }
+        int left_n = (LEAF_KEYS + 1) / 2;
+        lf->leaf.n = left_n;
+        rt->leaf.n = LEAF_KEYS + 1 - left_n;
+        memcpy(lf->leaf.key, keys, (size_t)left_n * sizeof(int32_t));
+        memcpy(lf->leaf.slot, slots, (size_t)left_n * sizeof(int32_t));
+        memcpy(rt->leaf.key, keys + left_n, (size_t)rt->leaf.n * sizeof(int32_t));
+        memcpy(rt->leaf.slot, slots + left_n, (size_t)rt->leaf.n * sizeof(int32_t));
+        rt->leaf.next = lf->leaf.next;
+        lf->leaf.next = right;
+        *up_key = rt->leaf.key[0];
+        *up_node = right;
+        return 1;
+    }
+
+    int i = route(pool[node].inner.key, pool[node].inner.n, id);
+    int32_t child_key;
+    uint32_t child_split;
+    int rc = insert_rec(pool[node].inner.child[i], level - 1, id, slot, &child_key, &child_split);
+    if (rc <= 0 || child_split == NIL) return rc;
+
+    Node *in = &pool[node];
+    if (in->inner.n < INNER_KEYS) {
+        int move = in->inner.n - i;
+        memmove(&in->inner.key[i + 1], &in->inner.key[i], (size_t)move * sizeof(int32_t));
+        memmove(&in->inner.child[i + 2], &in->inner.child[i + 1], (size_t)move * sizeof(uint32_t));
+        in->inner.key[i] = child_key;
+        in->inner.child[i + 1] = child_split;
+        in->inner.n++;
+        return 1;
+    }
+
+    // full inner node: the middle key moves up, the rest is split in two
+    uint32_t right = new_node();
+    Node *rt = &pool[right];
+    int32_t keys[INNER_KEYS + 1];
+    uint32_t kids[INNER_KEYS + 2];
+    for (int k = 0, j = 0; k <= INNER_KEYS; ++k) keys[k] = k == i ? child_key : in->inner.key[j++];
+    for (int k = 0, j = 0; k <= INNER_KEYS + 1; ++k) kids[k] = k == i + 1 ? child_split : in->inner.child[j++];
+
+    int left_n = (INNER_KEYS + 1) / 2;
+    in->inner.n = left_n;
+    memcpy(in->inner.key, keys, (size_t)left_n * sizeof(int32_t));
+    memcpy(in->inner.child, kids, (size_t)(left_n + 1) * sizeof(uint32_t));
+    rt->inner.n = INNER_KEYS - left_n;
+    memcpy(rt->inner.key, keys + left_n + 1, (size_t)rt->inner.n * sizeof(int32_t));
+    memcpy(rt->inner.child, kids + left_n + 1, (size_t)(rt->inner.n + 1) * sizeof(uint32_t));
+    *up_key = keys[left_n];
+    *up_node = right;
+    return 1;
+}
+
+int btreeInsert(int id, int slot) {
+    // one split per level plus a new root at most, so reserve up front and
+    // never fail half way through a split
+    if (!reserve_nodes((uint32_t)height + 2)) return -1;
+    if (root == NIL) {
+        root = new_node();
+        pool[root].leaf.next = NIL;
+        height = 0;
+    }
+    int32_t up_key;
+    uint32_t up_node;
+    int rc = insert_rec(root, height, id, slot, &up_key, &up_node);
+    if (rc == 1 && up_node != NIL) {
+        // the root split: grow the tree by one level
+        uint32_t new_root = new_node();
+        pool[new_root].inner.n = 1;
+        pool[new_root].inner.key[0] = up_key;
+        pool[new_root].inner.child[0] = root;
+        pool[new_root].inner.child[1] = up_node;
+        root = new_root;
+        height++;
+    }
+    if (rc == 1) entries++;
+    return rc;
+}
+
+static void remove_inner_entry(Node *in, int key_pos) {
+    // drop key[key_pos] and the child to its right
+    int move = in->inner.n - key_pos - 1;
+    memmove(&in->inner.key[key_pos], &in->inner.key[key_pos + 1], (size_t)move * sizeof(int32_t));
+    memmove(&in->inner.child[key_pos + 1], &in->inner.child[key_pos + 2], (size_t)move * sizeof(uint32_t));
+    in->inner.n--;
+}
+
+// Child i of parent (at level-1 == child_level) fell below its minimum:
+// borrow one entry from a sibling, or merge with it.
+static void fix_child(uint32_t parent, int i, int child_level) {
+    Node *p = &pool[parent];
+    int has_left = i > 0, has_right = i < p->inner.n;
+    Node *c = &pool[p->inner.child[i]];
+
+    if (child_level == 0) {
+        if (has_left && pool[p->inner.child[i - 1]].leaf.n > LEAF_MIN) {
+            Node *l = &pool[p->inner.child[i - 1]];
+            memmove(&c->leaf.key[1], &c->leaf.key[0], (size_t)c->leaf.n * sizeof(int32_t));
+            memmove(&c->leaf.slot[1], &c->leaf.slot[0], (size_t)c->leaf.n * sizeof(int32_t));
+            l->leaf.n--;
+            c->leaf.key[0] = l->leaf.key[l->leaf.n];
+            c->leaf.slot[0] = l->leaf.slot[l->leaf.n];
+            c->leaf.n++;
+            p->inner.key[i - 1] = c->leaf.key[0];
+            return;
+        }
+        if (has_right && pool[p->inner.child[i + 1]].leaf.n > LEAF_MIN) {
+            Node *r = &pool[p->inner.child[i + 1]];
+            c->leaf.key[c->leaf.n] = r->leaf.key[0];
+            c->leaf.slot[c->leaf.n] = r->leaf.slot[0];
+            c->leaf.n++;
+            r->leaf.n--;
+            memmove(&r->leaf.key[0], &r->leaf.key[1], (size_t)r->leaf.n * sizeof(int32_t));
+            memmove(&r->leaf.slot[0], &r->leaf.slot[1], (size_t)r->leaf.n * sizeof(int32_t));
+            p->inner.key[i] = r->leaf.key[0];
+            return;
+        }
+        // merge the pair (left, right) into left
+        int s = has_left ? i - 1 : i;
+        uint32_t right_id = p->inner.child[s + 1];
+        Node *l = &pool[p->inner.child[s]], *r = &pool[right_id];
+        memcpy(&l->leaf.key[l->leaf.n], r->leaf.key, (size_t)r->leaf.n * sizeof(int32_t));
+        memcpy(&l->leaf.slot[l->leaf.n], r->leaf.slot, (size_t)r->leaf.n * sizeof(int32_t));
+        l->leaf.n += r->leaf.n;
+        l->leaf.next = r->leaf.next;
+        remove_inner_entry(p, s);
+        free_node(right_id);
+        return;
+    }
+
+    if (has_left && pool[p->inner.child[i - 1]].inner.n > INNER_MIN) {
+        Node *l = &pool[p->inner.child[i - 1]];
+        memmove(&c->inner.key[1], &c->inner.key[0], (size_t)c->inner.n * sizeof(int32_t));
+        memmove(&c->inner.child[1], &c->inner.child[0], (size_t)(c->inner.n + 1) * sizeof(uint32_t));
+        c->inner.key[0] = p->inner.key[i - 1];
+        c->inner.child[0] = l->inner.child[l->inner.n];
+        c->inner.n++;
+        p->inner.key[i - 1] = l->inner.key[l->inner.n - 1];
+        l->inner.n--;
+        return;
+    }
+    if (has_right && pool[p->inner.child[i + 1]].inner.n > INNER_MIN) {
+        Node *r = &pool[p->inner.child[i + 1]];
+        c->inner.key[c->inner.n] = p->inner.key[i];
+        c->inner.child[c->inner.n + 1] = r->inner.child[0];
+        c->inner.n++;
+        p->inner.key[i] = r->inner.key[0];
+        memmove(&r->inner.key[0], &r->inner.key[1], (size_t)(r->inner.n - 1) * sizeof(int32_t));
+        memmove(&r->inner.child[0], &r->inner.child[1], (size_t)r->inner.n * sizeof(uint32_t));
+        r->inner.n--;
+        return;
+    }
+    int s = has_left ? i - 1 : i;
+    uint32_t right_id = p->inner.child[s + 1];
+    Node *l = &pool[p->inner.child[s]], *r = &pool[right_id];
+    l->inner.key[l->inner.n] = p->inner.key[s];
+    memcpy(&l->inner.key[l->inner.n + 1], r->inner.key, (size_t)r->inner.n * sizeof(int32_t));
+    memcpy(&l->inner.child[l->inner.n + 1], r->inner.child, (size_t)(r->inner.n + 1) * sizeof(uint32_t));
+    l->inner.n += r->inner.n + 1;
+    remove_inner_entry(p, s);
+    free_node(right_id);
+}
+
+static int remove_rec(uint32_t node, int level, int id) {
+    if (level == 0) {
+        Node *lf = &pool[node];
+        int pos = lower_bound(lf->leaf.key, lf->leaf.n, id);
+        if (pos == lf->leaf.n || lf->leaf.key[pos] != id) return 0;
+        int move = lf->leaf.n - pos - 1;
+        memmove(&lf->leaf.key[pos], &lf->leaf.key[pos + 1], (size_t)move * sizeof(int32_t));
+        memmove(&lf->leaf.slot[pos], &lf->leaf.slot[pos + 1], (size_t)move * sizeof(int32_t));
+        lf->leaf.n--;
+        return 1;
+    }
+
+    int i = route(pool[node].inner.key, pool[node].inner.n, id);
+    uint32_t child = pool[node].inner.child[i];
+    if (!remove_rec(child, level - 1, id)) return 0;
+
+    int child_n = level - 1 == 0 ? pool[child].leaf.n : pool[child].inner.n;
+    int child_min = level - 1 == 0 ? LEAF_MIN : INNER_MIN;
+    if (child_n < child_min) fix_child(node, i, level - 1);
+    return 1;
+}
+
+int btreeRemove(int id) {
+    if (root == NIL || !remove_rec(root, height, id)) return 0;
+    entries--;
+
+    // shrink from the top when the root is left with a single child
+    while (height > 0 && pool[root].inner.n == 0) {
+        uint32_t old = root;
+        root = pool[root].inner.child[0];
+        free_node(old);
+        height--;
+    }
+    if (height == 0 && pool[root].leaf.n == 0) btreeClear();
+    return 1;
+}
+
+static uint32_t first_leaf(void) {
+    uint32_t node = root;
+    for (int level = height; level > 0; --level) node = pool[node].inner.child[0];
+    return node;
+}
+
+void btreeShiftSlots(int from, int delta) {
+    if (root == NIL) return;
+    for (uint32_t lf = first_leaf(); lf != NIL; lf = pool[lf].leaf.next) {
+        Node *n = &pool[lf];
+        for (int k = 0; k < n->leaf.n; ++k) {
+            if (n->leaf.slot[k] >= from) n->leaf.slot[k] += delta;
+        }
+    }
+}
+
+void btreeCompactSlots(const int removed[], int n) {
+    if (root == NIL || n <= 0) return;
+    for (uint32_t lf = first_leaf(); lf != NIL; lf = pool[lf].leaf.next) {
+        Node *node = &pool[lf];
+        for (int k = 0; k < node->leaf.n; ++k) {
+            // subtract the number of removed slots below this one
+            int slot = node->leaf.slot[k];
+            int lo = 0, hi = n;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (removed[mid] < slot) lo = mid + 1;
+                else hi = mid;
+            }
+            node->leaf.slot[k] = slot - lo;
+        }
+    }
+}
+
+int btreeBuild(const int ids[], const int slots[], int n) {
+    btreeClear();
+    if (n == 0) return 1;
+
+    // Fill leaves left to right, leaving room for later inserts, then stack
+    // inner levels on top until one node remains.
+    const int per_leaf = LEAF_KEYS - 1;
+    int nleaves = (n + per_leaf - 1) / per_leaf;
+    if (!reserve_nodes((uint32_t)nleaves * 2 + 8)) return 0;
+    uint32_t *level_nodes = malloc((size_t)nleaves * sizeof(*level_nodes));
+    int32_t *level_keys = malloc((size_t)nleaves * sizeof(*level_keys));
+    if (!level_nodes || !level_keys) {
+        free(level_nodes);
+        free(level_keys);
+        return 0;
+    }
+
+    uint32_t prev = NIL;
+    for (int l = 0; l < nleaves; ++l) {
+        uint32_t id = new_node();
+        if (id == NIL) goto fail;
+        int begin = (int)((long)n * l / nleaves), end = (int)((long)n * (l + 1) / nleaves);
+        Node *lf = &pool[id];
+        lf->leaf.n = end - begin;
+        lf->leaf.next = NIL;
+        memcpy(lf->leaf.key, ids + begin, (size_t)(end - begin) * sizeof(int32_t));
+        memcpy(lf->leaf.slot, slots + begin, (size_t)(end - begin) * sizeof(int32_t));
+        if (prev != NIL) pool[prev].leaf.next = id;
+        prev = id;
+        level_nodes[l] = id;
+        level_keys[l] = ids[begin];
+    }
+
+    int count = nleaves, h = 0;
+    while (count > 1) {
+        const int per_inner = INNER_KEYS;   // children per node, at most INNER_KEYS + 1
+        int parents = (count + per_inner - 1) / per_inner;
+        for (int p = 0; p < parents; ++p) {
+            uint32_t id = new_node();
+            if (id == NIL) goto fail;
+            int begin = (int)((long)count * p / parents), end = (int)((long)count * (p + 1) / parents);
+            Node *in = &pool[id];
+            in->inner.n = end - begin - 1;
+            for (int c = begin; c < end; ++c) {
+                in->inner.child[c - begin] = level_nodes[c];
+                if (c > begin) in->inner.key[c - begin - 1] = level_keys[c];
+            }
+            int32_t first_key = level_keys[begin];
+            level_nodes[p] = id;
+            level_keys[p] = first_key;
+        }
+        count = parents;
+        h++;
+    }
+
+    root = level_nodes[0];
+    height = h;
+    entries = n;
+    free(level_nodes);
+    free(level_keys);
+    return 1;
+
+fail:
+    free(level_nodes);
+    free(level_keys);
+    btreeClear();
+    return 0;
+}
+
+void btreeSeek(BTreeCursor *c, int id) {
+    if (root == NIL) {
+        c->leaf = NIL;
+        c->pos = 0;
+        return;
+    }
+    c->leaf = find_leaf(id);
+    c->pos = lower_bound(pool[c->leaf].leaf.key, pool[c->leaf].leaf.n, id);
+}
+
+int btreeNext(BTreeCursor *c, int *id, int *slot) {
+    while (c->leaf != NIL && c->pos >= pool[c->leaf].leaf.n) {
+        c->leaf = pool[c->leaf].leaf.next;
+        c->pos = 0;
+    }
+    if (c->leaf == NIL) return 0;
+    *id = pool[c->leaf].leaf.key[c->pos];
+    *slot = pool[c->leaf].leaf.slot[c->pos];
+    c->pos++;
+    return 1;
+}
@@ -0,0 +1,50 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <stdint.h>
+
+// In-memory B+tree mapping student ID -> row slot in the table array. Nodes
+// are 64 bytes (one cache line) and live in one aligned pool, linked by
+// 32-bit node numbers instead of pointers to keep the fanout up. Leaves are
+// chained, so ID-ordered scans never sort. IDs are unique keys.
+
+typedef struct {
+    uint32_t leaf;
+    int pos;
+} BTreeCursor;
+
+// Drop every entry.
+void btreeClear(void);
+
+// Replace the tree with ids[i] -> slots[i]; ids must be ascending and unique.
+// Returns 0 when out of memory (the tree is then empty).
+int btreeBuild(const int ids[], const int slots[], int n);
+
+// Returns 1 when added, 0 if id is already present, -1 when out of memory.
+int btreeInsert(int id, int slot);
+
+// Returns 1 when id was present.
+int btreeRemove(int id);
+
+// Slot for id, or -1.
+int btreeFind(int id);
+
+// Change the slot stored for id. Returns 0 if id is not present.
+int btreeSetSlot(int id, int slot);
+
+// Add delta to every slot >= from (after a row is inserted or removed in the
+// middle of the table).
+void btreeShiftSlots(int from, int delta);
+
+// After the rows at removed[0..n) (ascending slots) were compacted out of the
+// table, renumber the remaining slots to match.
+void btreeCompactSlots(const int removed[], int n);
+
+int btreeCount(void);
+
+// Position c at the first entry with key >= id. Then btreeNext returns
+// entries in ascending ID order until it returns 0.
+void btreeSeek(BTreeCursor *c, int id);
+int btreeNext(BTreeCursor *c, int *id, int *slot);
+
+#endif
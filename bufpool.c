@@ -0,0 +1,201 @@
+// bufpool.c - CLOCK buffer pool over a page file
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bufpool.h"
+
+#define NO_PAGE UINT32_MAX
+#define NO_FRAME -1
+
+typedef struct {
+    uint32_t page;      // NO_PAGE when the frame is free
+    int pins;
+    unsigned char dirty;
+    unsigned char ref;  // CLOCK second-chance bit
+} Frame;
+
+static int pool_fd = -1;
+static int frame_count = 0;
+static Frame *frames = NULL;
+static unsigned char *frame_data = NULL;    // frame_count pages, page aligned
+static int hand = 0;
+
+// page -> frame lookup: open addressing with linear probing
+static int *slots = NULL;
+static uint32_t slot_mask = 0;
+
+static PoolStats stats;
+
+static uint32_t slot_of(uint32_t page) {
+    return (page * 2654435761u) & slot_mask;
+}
+
+static int lookup(uint32_t page) {
+    for (uint32_t s = slot_of(page);; s = (s + 1) & slot_mask) {
+        int f = slots[s];
+        if (f == NO_FRAME) return NO_FRAME;
+        if (frames[f].page == page) return f;
+    }
+}
+
+static void map_page(uint32_t page, int f) {
+    uint32_t s = slot_of(page);
+    while (slots[s] != NO_FRAME) s = (s + 1) & slot_mask;
+    slots[s] = f;
+}
+
+// remove page from the table, moving later entries of its probe run back
+static void unmap_page(uint32_t page) {
+    uint32_t s = slot_of(page);
+    while (frames[slots[s]].page != page) s = (s + 1) & slot_mask;
+    slots[s] = NO_FRAME;
+    for (uint32_t t = (s + 1) & slot_mask; slots[t] != NO_FRAME; t = (t + 1) & slot_mask) {
+        uint32_t home = slot_of(frames[slots[t]].page);
+        // the entry at t may fill the hole at s unless its home lies in (s, t]
+        if (((t - home) & slot_mask) >= ((t - s) & slot_mask)) {
+            slots[s] = slots[t];
+            slots[t] = NO_FRAME;
+            s = t;
+        }
+    }
+}
+
+static unsigned char *data_of(int f) {
+    return frame_data + (size_t)f * DB_PAGE_SIZE;
+}
+
+static int write_frame(int f) {
+    off_t at = (off_t)frames[f].page * DB_PAGE_SIZE;
+    if (pwrite(pool_fd, data_of(f), DB_PAGE_SIZE, at) != DB_PAGE_SIZE) return 0;
+    frames[f].dirty = 0;
+    stats.writes++;
+    return 1;
+}
+
+// Find a frame for a new page: a free one, else the first unpinned frame
+// the CLOCK hand reaches with its reference bit clear.
+static int grab_frame(void) {
+    for (int sweep = 0; sweep < 2 * frame_count; ++sweep) {
+        int f = hand;
+        hand = (hand + 1) % frame_count;
+        Frame *fr = &frames[f];
+        if (fr->page == NO_PAGE) return f;
+        if (fr->pins > 0) continue;
+        if (fr->ref) {
+            fr->ref = 0;
+            continue;
+        }
+        if (fr->dirty && !write_frame(f)) return NO_FRAME;
+        unmap_page(fr->page);
+        fr->page = NO_PAGE;
+        stats.evictions++;
+        return f;
+    }
+    return NO_FRAME;    // everything is pinned
+}
+
+int poolOpen(int fd, int count) {
+    poolClose();
+
+    uint32_t table = 1;
+    while (table < (uint32_t)count * 2) table <<= 1;
+
+    frames = malloc((size_t)count * sizeof(*frames));
+    slots = malloc((size_t)table * sizeof(*slots));
+    frame_data = aligned_alloc(DB_PAGE_SIZE, (size_t)count * DB_PAGE_SIZE);
+    if (!frames || !slots || !frame_data) {
+        free(frames);
+        free(slots);
+        free(frame_data);
+        frames = NULL;
+        slots = NULL;
+        frame_data = NULL;
+        return 0;
+    }
+    for (int f = 0; f < count; ++f) frames[f] = (Frame){ NO_PAGE, 0, 0, 0 };
+    for (uint32_t s = 0; s < table; ++s) slots[s] = NO_FRAME;
+    slot_mask = table - 1;
+    frame_count = count;
+    pool_fd = fd;
+    hand = 0;
+    memset(&stats, 0, sizeof(stats));
+    stats.frames = count;
+    return 1;
+}
+
+int poolClose(void) {
+    if (!frames) return 1;
+    int ok = poolFlush();
+    free(frames);
+    free(slots);
+    free(frame_data);
+    frames = NULL;
+    slots = NULL;
+    frame_data = NULL;
+    frame_count = 0;
+    pool_fd = -1;
+    return ok;
+}
+
+unsigned char *poolPin(uint32_t page) {
+    int f = lookup(page);
+    if (f != NO_FRAME) {
+        stats.hits++;
+    } else {
+        f = grab_frame();
+        if (f == NO_FRAME) return NULL;
+        off_t at = (off_t)page * DB_PAGE_SIZE;
+        if (pread(pool_fd, data_of(f), DB_PAGE_SIZE, at) != DB_PAGE_SIZE) return NULL;
+        frames[f] = (Frame){ page, 0, 0, 0 };
+        map_page(page, f);
+        stats.misses++;
+    }
+    frames[f].pins++;
+    frames[f].ref = 1;
+    return data_of(f);
+}
+
+unsigned char *poolPinNew(uint32_t page) {
+    int f = grab_frame();
+    if (f == NO_FRAME) return NULL;
+    memset(data_of(f), 0, DB_PAGE_SIZE);
+    frames[f] = (Frame){ page, 1, 1, 1 };
+    map_page(page, f);
+    return data_of(f);
+}
+
+void poolUnpin(uint32_t page, int flags) {
+    int f = lookup(page);
+    if (f == NO_FRAME) return;
+    Frame *fr = &frames[f];
+    if (fr->pins > 0) fr->pins--;
+    if (flags & POOL_DIRTY) fr->dirty = 1;
+    // a page read once by a scan should not push out the hot index pages
+    if (flags & POOL_COLD) fr->ref = 0;
+}
+
+int poolFlush(void) {
+    int ok = 1;
+    for (int f = 0; f < frame_count; ++f) {
+        if (frames[f].page != NO_PAGE && frames[f].dirty && !write_frame(f)) ok = 0;
+    }
+    return ok;
+}
+
+void poolReadAhead(uint32_t page, int n) {
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(pool_fd, (off_t)page * DB_PAGE_SIZE, (off_t)n * DB_PAGE_SIZE, POSIX_FADV_WILLNEED);
+#else
+    (void)page;
+    (void)n;
+#endif
+}
+
+void poolStats(PoolStats *out) {
+    *out = stats;
+    out->frames = frame_count;
+}
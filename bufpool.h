@@ -0,0 +1,49 @@
+#ifndef BUFPOOL_H
+#define BUFPOOL_H
+
+#include <stdint.h>
+
+// Page cache for one open page file. A fixed number of 4 KB frames hold the
+// most recently used pages; when all are taken the CLOCK hand evicts a page
+// nobody has pinned, writing it back first if it was changed. Pages stay
+// valid between poolPin and poolUnpin only.
+
+#define DB_PAGE_SIZE 4096
+
+// poolUnpin flags
+#define POOL_DIRTY 1    // the caller changed the page
+#define POOL_COLD  2    // sequential scan: let this page be evicted first
+
+typedef struct {
+    unsigned long hits;
+    unsigned long misses;       // pages read from the file
+    unsigned long writes;       // pages written back
+    unsigned long evictions;
+    int frames;
+} PoolStats;
+
+// Cache pages of fd in frames frames. Returns 0 when out of memory.
+int poolOpen(int fd, int frames);
+
+// Write back every changed page and free the frames. Returns 0 on a write error.
+int poolClose(void);
+
+// Pin page and return its bytes, reading it in if needed. Returns NULL on a
+// read error or when every frame is pinned.
+unsigned char *poolPin(uint32_t page);
+
+// Pin a zeroed frame for a page just added at the end of the file. The page
+// is written when it is evicted or flushed.
+unsigned char *poolPinNew(uint32_t page);
+
+void poolUnpin(uint32_t page, int flags);
+
+// Write back every changed page. Returns 0 on a write error.
+int poolFlush(void);
+
+// Ask the OS to start reading pages [page, page + n) in the background.
+void poolReadAhead(uint32_t page, int n);
+
+void poolStats(PoolStats *out);
+
+#endif
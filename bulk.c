@@ -0,0 +1,280 @@
+// bulk.c - UPDATE SET ... WHERE and DELETE WHERE
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bulk.h"
+#include "where.h"
+#include "history.h"
+#include "dict.h"
+#include "marks.h"
+#include "arena.h"
+
+typedef enum { MARK_KEEP, MARK_SET, MARK_ADD } MarkAction;
+
+typedef struct {
+    MarkAction mark_action;
+    int mark_value;         // tenths; the delta for MARK_ADD
+    int set_prog;
+    char prog_name[256];
+} SetClause;
+
+static char *trim(char *s) {
+    while (*s && isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+    return s;
+}
+
+static int starts_with_ci(const char *s, const char *prefix) {
+    while (*prefix) {
+        if (toupper((unsigned char)*s) != toupper((unsigned char)*prefix)) return 0;
+        s++; prefix++;
+    }
+    return 1;
+}
+
+static int iequals(const char *a, const char *b) {
+    while (*a && *b) {
+        if (toupper((unsigned char)*a) != toupper((unsigned char)*b)) return 0;
+        a++; b++;
+    }
+    return *a == *b;
+}
+
+// Parse "Mark=Mark+5, Programme=X" into set. Returns 0 with a message on error.
+static int parse_set(char *text, SetClause *set) {
+    memset(set, 0, sizeof(*set));
+    for (char *item = strtok(text, ","); item; item = strtok(NULL, ",")) {
+        item = trim(item);
+        char *eq = strchr(item, '=');
+        if (!eq) {
+            printf("CMS: Invalid SET item '%s'. Use Field=<value>.\n", item);
+            return 0;
+        }
+        *eq = '\0';
+        char *field = trim(item);
+        char *value = trim(eq + 1);
+
+        if (iequals(field, "Mark")) {
+            if (set->mark_action != MARK_KEEP) {
+                printf("CMS: Mark is assigned more than once.\n");
+                return 0;
+            }
+            // Mark=Mark+n / Mark=Mark-n, or a plain Mark=n
+            if (starts_with_ci(value, "Mark")) {
+                char *op = trim(value + 4);
+                if (*op != '+' && *op != '-') {
+                    printf("CMS: Use Mark=Mark+<n> or Mark=Mark-<n>.\n");
+                    return 0;
+                }
+                int delta;
+                if (!parseMark(trim(op + 1), &delta)) {
+                    printf("CMS: Invalid Mark adjustment '%s'.\n", op + 1);
+                    return 0;
+                }
+                set->mark_action = MARK_ADD;
+                set->mark_value = *op == '-' ? -delta : delta;
+            } else {
+                int m;
+                if (!parseMark(value, &m)) {
+                    printf("CMS: Invalid Mark type. Mark must be a number\n");
+                    return 0;
+                }
+                if (m < MARK_MIN || m > MARK_MAX) {
+                    printf("CMS: Mark must be between 0.0 and 100.0\n");
+                    return 0;
+                }
+                set->mark_action = MARK_SET;
+                set->mark_value = m;
+            }
+        } else if (iequals(field, "Programme")) {
+            if (set->set_prog) {
+                printf("CMS: Programme is assigned more than once.\n");
+                return 0;
+            }
+            if (*value == '\0') {
+                printf("CMS: Programme field is empty.\n");
+                return 0;
+            }
+            set->set_prog = 1;
+            strncpy(set->prog_name, value, sizeof(set->prog_name) - 1);
+        } else {
+            printf("CMS: Only Mark and Programme can be set for many rows at once.\n");
+            return 0;
+        }
+    }
+    if (set->mark_action == MARK_KEEP && !set->set_prog) {
+        printf("CMS: SET needs at least one assignment.\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Split "<head> WHERE <predicate>" and parse the predicate. head may be NULL
+// when nothing is expected before WHERE.
+static int split_where(const char *args, char *head, size_t head_size, Predicate *pred, char *where_text, size_t where_size) {
+    const char *w = findKeyword(args, "WHERE");
+    if (!w) return 0;
+    if (head) {
+        size_t len = (size_t)(w - args);
+        if (len >= head_size) len = head_size - 1;
+        memcpy(head, args, len);
+        head[len] = '\0';
+    }
+    strncpy(where_text, w + 5, where_size - 1);
+    where_text[where_size - 1] = '\0';
+
+    char err[128];
+    if (!parseWhere(where_text, pred, err, sizeof(err))) {
+        printf("CMS: Invalid WHERE clause: %s.\n", err);
+        return -1;
+    }
+    return 1;
+}
+
+// one Y/N for the whole batch
+static int confirm(const char *question) {
+    printf("CMS: %s Type \"Y\" to Confirm or type \"N\" to cancel.\n", question);
+    fflush(stdout);
+    printf("P5_4: ");
+    fflush(stdout);
+
+    char resp[16] = { 0 };
+    if (!fgets(resp, sizeof(resp), stdin)) return 0;
+    return resp[0] == 'Y' || resp[0] == 'y';
+}
+
+static void history_entry(const char *action, int n, const char *where_text) {
+    char msg[HISTORY_DESC_LEN];
+    char cond[96];
+    strncpy(cond, where_text, sizeof(cond) - 1);
+    cond[sizeof(cond) - 1] = '\0';
+    snprintf(msg, sizeof(msg), "%s %d record(s) WHERE %s", action, n, trim(cond));
+    addHistory(msg);
+}
+
+int bulkUpdate(const char *local_args, StudentRecord records[], int *count) {
+    Predicate pred;
+    char set_text[512], where_text[512];
+    int parsed = split_where(local_args, set_text, sizeof(set_text), &pred, where_text, sizeof(where_text));
+    if (parsed == 0) {
+        printf("CMS: Bulk UPDATE requires WHERE. Use: UPDATE SET Mark=Mark+5 WHERE Programme=<programme>\n");
+        addHistory("UPDATE: Failed - bulk update without WHERE");
+        return 1;
+    }
+    if (parsed < 0) {
+        addHistory("UPDATE: Failed - invalid WHERE clause");
+        return 1;
+    }
+
+    char *assignments = trim(set_text);
+    if (!starts_with_ci(assignments, "SET") || !isspace((unsigned char)assignments[3])) {
+        printf("CMS: Use: UPDATE SET <Field>=<value>[, ...] WHERE <condition>\n");
+        addHistory("UPDATE: Failed - invalid SET clause");
+        return 1;
+    }
+    SetClause set;
+    if (!parse_set(assignments + 3, &set)) {
+        addHistory("UPDATE: Failed - invalid SET clause");
+        return 1;
+    }
+
+    int *sel = arenaAlloc((size_t)*count * sizeof(*sel));
+    if (!sel) {
+        printf("CMS: ERROR: Out of memory.\n");
+        return 1;
+    }
+    int n = selectRows(records, *count, &pred, sel);
+    if (n == 0) {
+        printf("CMS: No records match the WHERE clause.\n");
+        history_entry("UPDATE: Matched", 0, where_text);
+        return 1;
+    }
+
+    // the whole batch is refused if any row would leave the mark range
+    if (set.mark_action == MARK_ADD) {
+        int out_of_range = 0;
+        for (int k = 0; k < n; ++k) {
+            int m = records[sel[k]].mark + set.mark_value;
+            out_of_range += (m < MARK_MIN) | (m > MARK_MAX);
+        }
+        if (out_of_range > 0) {
+            printf("CMS: %d matching record(s) would end up outside 0.0 to 100.0. No records were updated.\n", out_of_range);
+            addHistory("UPDATE: Failed - bulk update out of mark range");
+            return 1;
+        }
+    }
+
+    char question[96];
+    snprintf(question, sizeof(question), "Are you sure you want to update %d record(s)?", n);
+    if (!confirm(question)) {
+        printf("CMS: The update is cancelled.\n");
+        addHistory("UPDATE: Bulk update cancelled");
+        return 1;
+    }
+
+    int prog = -1;
+    if (set.set_prog) {
+        prog = internProgramme(set.prog_name);
+        if (prog < 0) {
+            printf("CMS: ERROR: Too many distinct programmes.\n");
+            addHistory("UPDATE: Failed - programme dictionary full");
+            return 1;
+        }
+    }
+
+    for (int k = 0; k < n; ++k) {
+        StudentRecord next = records[sel[k]];
+        if (set.mark_action == MARK_SET) next.mark = (int16_t)set.mark_value;
+        else if (set.mark_action == MARK_ADD) next.mark = (int16_t)(next.mark + set.mark_value);
+        if (prog >= 0) next.prog = (uint16_t)prog;
+        replaceRow(records, sel[k], &next);
+    }
+
+    printf("CMS: %d record(s) successfully updated.\n", n);
+    history_entry("UPDATE: Bulk updated", n, where_text);
+    return 1;
+}
+
+int bulkDelete(const char *local_args, StudentRecord records[], int *count) {
+    Predicate pred;
+    char where_text[512];
+    int parsed = split_where(local_args, NULL, 0, &pred, where_text, sizeof(where_text));
+    if (parsed == 0) {
+        printf("CMS: ERROR: Invalid DELETE. Use: DELETE ID=<ID> or DELETE WHERE <condition>\n");
+        addHistory("DELETE: Failed - invalid format");
+        return 1;
+    }
+    if (parsed < 0) {
+        addHistory("DELETE: Failed - invalid WHERE clause");
+        return 1;
+    }
+
+    int *sel = arenaAlloc((size_t)*count * sizeof(*sel));
+    if (!sel) {
+        printf("CMS: ERROR: Out of memory.\n");
+        return 1;
+    }
+    int n = selectRows(records, *count, &pred, sel);
+    if (n == 0) {
+        printf("CMS: No records match the WHERE clause.\n");
+        history_entry("DELETE: Matched", 0, where_text);
+        return 1;
+    }
+
+    char question[96];
+    snprintf(question, sizeof(question), "Are you sure you want to delete %d record(s)?", n);
+    if (!confirm(question)) {
+        printf("CMS: The deletion is cancelled.\n");
+        addHistory("DELETE: Bulk delete cancelled");
+        return 1;
+    }
+
+    removeRows(records, count, sel, n);
+    printf("CMS: %d record(s) successfully deleted.\n", n);
+    history_entry("DELETE: Deleted", n, where_text);
+    return 1;
+}
@@ -0,0 +1,19 @@
+#ifndef BULK_H
+#define BULK_H
+
+#include "records.h"
+
+// Set-based edits driven by a WHERE predicate (where.h):
+//   UPDATE SET Mark=Mark+5 WHERE Programme=Computer Science
+//   UPDATE SET Mark=50, Programme=Applied AI WHERE ID BETWEEN 2300000 AND 2300100
+//   DELETE WHERE Mark<10
+// Matching rows are selected in one pass, confirmed once and written as one
+// batch with a single history entry.
+
+// local_args is everything after UPDATE, starting with SET.
+int bulkUpdate(const char *local_args, StudentRecord records[], int *count);
+
+// local_args is everything after DELETE, starting with WHERE.
+int bulkDelete(const char *local_args, StudentRecord records[], int *count);
+
+#endif
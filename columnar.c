@@ -0,0 +1,345 @@
+// columnar.c - column-chunked export with zone maps, and WHERE scans over it
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "columnar.h"
+#include "dict.h"
+#include "marks.h"
+#include "names.h"
+#include "psort.h"
+#include "settings.h"
+#include "where.h"
+#include "arena.h"
+
+#define COLUMNAR_MAGIC "CMSCOL1"
+#define CHUNK_ROWS 8192
+
+// a query reads a chunk's rows into one record pool block
+_Static_assert(CHUNK_ROWS <= RECORD_BLOCK_ROWS, "a chunk must fit in a record block");
+
+enum { COL_ID, COL_MARK, COL_PROG, COL_NAME, COL_COUNT };
+
+// Everything is stored in host byte order.
+typedef struct {
+    char magic[8];
+    uint32_t rows;
+    uint32_t chunk_rows;
+    uint32_t chunks;
+    uint32_t progs;
+    uint64_t dict_at;       // programme names: uint16 length + text each
+    uint64_t dir_at;        // one ChunkEntry per chunk
+} ColumnarHeader;
+
+typedef struct {
+    uint64_t offset;
+    uint32_t bytes;
+    int32_t min;            // zone map; 0/0 for the name column
+    int32_t max;
+} ColumnEntry;
+
+typedef struct {
+    uint32_t rows;
+    uint32_t unused;
+    ColumnEntry col[COL_COUNT];
+} ChunkEntry;
+
+static int write_block(FILE *fp, const void *data, size_t bytes, ColumnEntry *e) {
+    long at = ftell(fp);
+    if (at < 0) return 0;
+    e->offset = (uint64_t)at;
+    e->bytes = (uint32_t)bytes;
+    return bytes == 0 || fwrite(data, 1, bytes, fp) == bytes;
+}
+
+int exportColumnar(const char *path, const StudentRecord records[], int count) {
+    int chunks = (count + CHUNK_ROWS - 1) / CHUNK_ROWS;
+    SortItem *items = arenaAlloc((size_t)count * sizeof(*items));
+    ChunkEntry *dir = arenaCalloc((size_t)chunks, sizeof(*dir));
+    int32_t *ids = arenaAlloc(CHUNK_ROWS * sizeof(*ids));
+    int16_t *marks = arenaAlloc(CHUNK_ROWS * sizeof(*marks));
+    uint16_t *progs = arenaAlloc(CHUNK_ROWS * sizeof(*progs));
+    uint32_t *ends = arenaAlloc(CHUNK_ROWS * sizeof(*ends));
+    char *text = NULL;
+    FILE *fp = NULL;
+    int ok = items && dir && ids && marks && progs && ends;
+    if (!ok) printf("CMS: ERROR: Out of memory.\n");
+
+    if (ok) {
+        for (int i = 0; i < count; ++i) {
+            items[i].key = sortKey32(records[i].id, 1);
+            items[i].idx = i;
+        }
+        sortItems(items, count, NULL, NULL, getSetting(SETTING_SORT_PARALLEL_ROWS));
+        fp = fopen(path, "wb");
+        if (!fp) {
+            printf("CMS: ERROR: Cannot write \"%s\".\n", path);
+            ok = 0;
+        }
+    }
+
+    ColumnarHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, COLUMNAR_MAGIC, sizeof(h.magic));
+    h.rows = (uint32_t)count;
+    h.chunk_rows = CHUNK_ROWS;
+    h.chunks = (uint32_t)chunks;
+    h.progs = (uint32_t)programmeCount();
+    ok = ok && fwrite(&h, sizeof(h), 1, fp) == 1;   // rewritten at the end
+
+    ArenaMark chunk_mark = arenaMark();     // each chunk's name text goes back here
+    for (int c = 0; c < chunks && ok; ++c) {
+        int first = c * CHUNK_ROWS;
+        int n = count - first < CHUNK_ROWS ? count - first : CHUNK_ROWS;
+        ChunkEntry *e = &dir[c];
+        e->rows = (uint32_t)n;
+
+        size_t text_len = 0;
+        for (int k = 0; k < n; ++k) text_len += records[items[first + k].idx].name_len;
+        arenaRelease(chunk_mark);
+        text = arenaAlloc(text_len);
+        if (!text) {
+            printf("CMS: ERROR: Out of memory.\n");
+            ok = 0;
+            break;
+        }
+
+        // split the rows into columns and track each column's range
+        e->col[COL_ID].min = e->col[COL_MARK].min = e->col[COL_PROG].min = INT32_MAX;
+        e->col[COL_ID].max = e->col[COL_MARK].max = e->col[COL_PROG].max = INT32_MIN;
+        size_t at = 0;
+        for (int k = 0; k < n; ++k) {
+            const StudentRecord *r = &records[items[first + k].idx];
+            ids[k] = r->id;
+            marks[k] = r->mark;
+            progs[k] = r->prog;
+            memcpy(text + at, recordName(r), r->name_len);
+            at += r->name_len;
+            ends[k] = (uint32_t)at;
+            int32_t v[3] = { r->id, r->mark, r->prog };
+            for (int col = COL_ID; col <= COL_PROG; ++col) {
+                if (v[col] < e->col[col].min) e->col[col].min = v[col];
+                if (v[col] > e->col[col].max) e->col[col].max = v[col];
+            }
+        }
+
+        ok = write_block(fp, ids, (size_t)n * sizeof(*ids), &e->col[COL_ID]) &&
+             write_block(fp, marks, (size_t)n * sizeof(*marks), &e->col[COL_MARK]) &&
+             write_block(fp, progs, (size_t)n * sizeof(*progs), &e->col[COL_PROG]) &&
+             write_block(fp, ends, (size_t)n * sizeof(*ends), &e->col[COL_NAME]);
+        // the name block is the offsets followed by the text
+        ok = ok && (text_len == 0 || fwrite(text, 1, text_len, fp) == text_len);
+        e->col[COL_NAME].bytes += (uint32_t)text_len;
+    }
+
+    if (ok) {
+        long at = ftell(fp);
+        h.dict_at = (uint64_t)(at < 0 ? 0 : at);
+        for (uint32_t p = 0; p < h.progs && ok; ++p) {
+            const char *name = programmeName((uint16_t)p);
+            uint16_t len = (uint16_t)strlen(name);
+            ok = fwrite(&len, sizeof(len), 1, fp) == 1 && fwrite(name, 1, len, fp) == len;
+        }
+        at = ftell(fp);
+        h.dir_at = (uint64_t)(at < 0 ? 0 : at);
+        ok = ok && (chunks == 0 || fwrite(dir, sizeof(*dir), (size_t)chunks, fp) == (size_t)chunks);
+        ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, fp) == 1;
+    }
+    if (fp && fclose(fp) == EOF) ok = 0;
+    if (fp && !ok) printf("CMS: ERROR: Writing \"%s\" failed.\n", path);
+
+    return ok ? count : -1;
+}
+
+// ---- queries ----
+
+typedef struct {
+    FILE *fp;
+    unsigned long bytes_read;
+} Reader;
+
+static int read_at(Reader *rd, uint64_t offset, void *buf, size_t bytes) {
+    if (bytes == 0) return 1;
+    if (fseek(rd->fp, (long)offset, SEEK_SET) != 0 || fread(buf, 1, bytes, rd->fp) != bytes) return 0;
+    rd->bytes_read += (unsigned long)bytes;
+    return 1;
+}
+
+// Could any value in [min, max] satisfy c?
+static int zone_may_match(const Condition *c, int32_t min, int32_t max) {
+    switch (c->op) {
+    case OP_EQ:      return c->lo >= min && c->lo <= max;
+    case OP_NE:      return !(min == max && min == c->lo);
+    case OP_LT:      return min < c->lo;
+    case OP_LE:      return min <= c->lo;
+    case OP_GT:      return max > c->lo;
+    case OP_GE:      return max >= c->lo;
+    case OP_BETWEEN: return max >= c->lo && min <= c->hi;
+    }
+    return 1;
+}
+
+static int column_of(PredField f) {
+    switch (f) {
+    case FIELD_ID:        return COL_ID;
+    case FIELD_MARK:      return COL_MARK;
+    case FIELD_PROGRAMME: return COL_PROG;
+    }
+    return COL_ID;
+}
+
+// Read one numeric column of a chunk into the matching field of rows.
+static int load_column(Reader *rd, const ChunkEntry *e, int col, StudentRecord rows[], void *scratch) {
+    const ColumnEntry *ce = &e->col[col];
+    size_t width = col == COL_ID ? sizeof(int32_t) : sizeof(int16_t);
+    if (ce->bytes != e->rows * width || !read_at(rd, ce->offset, scratch, ce->bytes)) return 0;
+    for (uint32_t k = 0; k < e->rows; ++k) {
+        if (col == COL_ID) rows[k].id = ((const int32_t *)scratch)[k];
+        else if (col == COL_MARK) rows[k].mark = ((const int16_t *)scratch)[k];
+        else rows[k].prog = ((const uint16_t *)scratch)[k];
+    }
+    return 1;
+}
+
+int queryColumnar(const char *path, const char *where_text) {
+    Reader rd = { fopen(path, "rb"), 0 };
+    if (!rd.fp) {
+        printf("CMS: ERROR: Cannot open \"%s\".\n", path);
+        return -1;
+    }
+
+    ColumnarHeader h;
+    if (fread(&h, sizeof(h), 1, rd.fp) != 1 || memcmp(h.magic, COLUMNAR_MAGIC, sizeof(h.magic)) != 0 ||
+        h.chunk_rows == 0 || h.chunk_rows > CHUNK_ROWS) {
+        printf("CMS: ERROR: \"%s\" is not a columnar export.\n", path);
+        fclose(rd.fp);
+        return -1;
+    }
+    rd.bytes_read = sizeof(h);
+
+    // the file's programme codes -> this run's codes (-1: not in the
+    // dictionary), and the file's own names for printing
+    int *prog_map = arenaAlloc((size_t)h.progs * sizeof(*prog_map));
+    char **prog_name = arenaAlloc((size_t)h.progs * sizeof(*prog_name));
+    ChunkEntry *dir = arenaAlloc((size_t)h.chunks * sizeof(*dir));
+    StudentRecord *rows = recordBlockGet();
+    int *sel = arenaAlloc(CHUNK_ROWS * sizeof(*sel));
+    uint32_t *ends = arenaAlloc(CHUNK_ROWS * sizeof(*ends));
+    char *scratch = arenaAlloc(CHUNK_ROWS * sizeof(int32_t));
+    char *text = NULL;
+    int ok = prog_map && prog_name && dir && rows && sel && ends && scratch;
+    int reported = !ok;     // a specific message was already printed
+    if (!ok) printf("CMS: ERROR: Out of memory.\n");
+
+    // A query must not grow the live dictionary: only the programmes the
+    // WHERE clause names are interned, so the file's names can be looked up
+    Predicate pred;
+    char err[128];
+    if (ok && !parseWhereInterning(where_text, &pred, err, sizeof(err))) {
+        printf("CMS: Invalid WHERE clause: %s.\n", err);
+        ok = 0;
+        reported = 1;
+    }
+
+    ok = ok && fseek(rd.fp, (long)h.dict_at, SEEK_SET) == 0;
+    for (uint32_t p = 0; p < h.progs && ok; ++p) {
+        uint16_t len;
+        ok = fread(&len, sizeof(len), 1, rd.fp) == 1;
+        prog_name[p] = ok ? arenaAlloc((size_t)len + 1) : NULL;
+        ok = prog_name[p] && fread(prog_name[p], 1, len, rd.fp) == len;
+        if (ok) {
+            prog_name[p][len] = '\0';
+            prog_map[p] = findProgramme(prog_name[p]);
+            rd.bytes_read += sizeof(len) + len;
+        }
+    }
+    ok = ok && read_at(&rd, h.dir_at, dir, (size_t)h.chunks * sizeof(*dir));
+    if (!ok && !reported) {
+        printf("CMS: ERROR: \"%s\" is damaged.\n", path);
+        reported = 1;
+    }
+
+    int used[COL_COUNT] = { 0 };
+    for (int c = 0; ok && c < pred.n; ++c) {
+        Condition *cond = &pred.cond[c];
+        used[column_of(cond->field)] = 1;
+        if (cond->field != FIELD_PROGRAMME) continue;
+        // compare against the file's code for that programme (-1: none)
+        int code = -1;
+        for (uint32_t p = 0; p < h.progs && cond->lo >= 0; ++p) {
+            if (prog_map[p] == cond->lo) code = (int)p;
+        }
+        cond->lo = code;
+    }
+
+    ArenaMark chunk_mark = arenaMark();     // each chunk's name text goes back here
+    int matched = 0, scanned = 0, skipped = 0;
+    if (ok) {
+        printf("CMS: Here are the records in \"%s\" matching the WHERE clause.\n", path);
+        printf("%-8s %-20s %-24s %s\n", "ID", "Name", "Programme", "Mark");
+    }
+    for (uint32_t c = 0; c < h.chunks && ok; ++c) {
+        const ChunkEntry *e = &dir[c];
+        if (e->rows == 0 || e->rows > h.chunk_rows) {
+            ok = 0;
+            break;
+        }
+
+        // zone maps first: one impossible condition rules the chunk out
+        int possible = 1;
+        for (int k = 0; k < pred.n && possible; ++k) {
+            const ColumnEntry *ce = &e->col[column_of(pred.cond[k].field)];
+            possible = zone_may_match(&pred.cond[k], ce->min, ce->max);
+        }
+        if (!possible) {
+            skipped++;
+            continue;
+        }
+        scanned++;
+
+        // only the predicate's columns, then the rest for chunks with matches
+        for (int col = COL_ID; col <= COL_PROG && ok; ++col) {
+            if (used[col]) ok = load_column(&rd, e, col, rows, scratch);
+        }
+        int n = ok ? selectRows(rows, (int)e->rows, &pred, sel) : 0;
+        if (n == 0) continue;
+        for (int col = COL_ID; col <= COL_PROG && ok; ++col) {
+            if (!used[col]) ok = load_column(&rd, e, col, rows, scratch);
+        }
+
+        const ColumnEntry *names = &e->col[COL_NAME];
+        size_t ends_bytes = e->rows * sizeof(*ends);
+        ok = ok && names->bytes >= ends_bytes && read_at(&rd, names->offset, ends, ends_bytes);
+        size_t text_len = ok ? names->bytes - ends_bytes : 0;
+        if (ok) {
+            arenaRelease(chunk_mark);
+            text = arenaAlloc(text_len);
+            ok = text && read_at(&rd, names->offset + ends_bytes, text, text_len);
+        }
+        for (int k = 0; k < n && ok; ++k) {
+            int i = sel[k];
+            uint32_t from = i > 0 ? ends[i - 1] : 0;
+            if (ends[i] < from || ends[i] > text_len) {
+                ok = 0;
+                break;
+            }
+            const StudentRecord *r = &rows[i];
+            char mark[MARK_BUF_LEN];
+            printf("%-8d %-20.*s %-24s %s\n", r->id, (int)(ends[i] - from), text + from,
+                   r->prog < h.progs ? prog_name[r->prog] : "", formatMark(r->mark, mark));
+        }
+        matched += n;
+    }
+
+    if (ok) {
+        if (matched == 0) printf("No records.\n");
+        printf("CMS: %d record(s) matched. Scanned %d of %u chunk(s), %d skipped by zone maps, %lu bytes read.\n",
+               matched, scanned, h.chunks, skipped, rd.bytes_read);
+    } else if (!reported) {
+        printf("CMS: ERROR: Reading \"%s\" failed.\n", path);
+    }
+
+    fclose(rd.fp);
+    recordBlockPut(rows);
+    return ok ? matched : -1;
+}
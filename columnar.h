@@ -0,0 +1,24 @@
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include "records.h"
+
+// Columnar export for analytics. Rows are written in ID order, cut into
+// chunks of 8192 rows, and each chunk stores ID, Mark, Programme and Name as
+// separate column blocks. A directory at the end of the file keeps every
+// block's position together with the min/max of its values (the zone map).
+//
+// A WHERE query against the file reads the directory, skips each chunk whose
+// zone maps rule the predicate out, reads only the columns the predicate
+// uses for the remaining chunks, and fetches the other columns just for the
+// chunks that have matches.
+
+// Write the table to path. Returns the number of rows written, or -1 with a
+// message on error.
+int exportColumnar(const char *path, const StudentRecord records[], int count);
+
+// Print the rows of the columnar file at path that satisfy where_text (see
+// where.h). Returns the number of matches, or -1 with a message on error.
+int queryColumnar(const char *path, const char *where_text);
+
+#endif
@@ -0,0 +1,217 @@
+// csv.c - block-scanning RFC 4180 CSV reader
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "csv.h"
+
+#define CSV_BLOCK (1 << 20)     // initial buffer; grows for longer records
+#define CSV_PAD 32              // readable bytes past len, so 32-byte loads never overrun
+
+// Bitmasks of the quotes, commas and line feeds among the 32 bytes at p
+// (bit i is byte i).
+#ifdef __SSE2__
+static void block_masks(const char *p, uint32_t *quote, uint32_t *comma, uint32_t *nl) {
+    __m128i lo = _mm_loadu_si128((const __m128i *)p);
+    __m128i hi = _mm_loadu_si128((const __m128i *)(p + 16));
+    __m128i q = _mm_set1_epi8('"'), c = _mm_set1_epi8(','), n = _mm_set1_epi8('\n');
+    *quote = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, q)) |
+             (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, q)) << 16;
+    *comma = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, c)) |
+             (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, c)) << 16;
+    *nl = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, n)) |
+          (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, n)) << 16;
+}
+#else
+static void block_masks(const char *p, uint32_t *quote, uint32_t *comma, uint32_t *nl) {
+    uint32_t q = 0, c = 0, n = 0;
+    for (int i = 0; i < 32; ++i) {
+        q |= (uint32_t)(p[i] == '"') << i;
+        c |= (uint32_t)(p[i] == ',') << i;
+        n |= (uint32_t)(p[i] == '\n') << i;
+    }
+    *quote = q;
+    *comma = c;
+    *nl = n;
+}
+#endif
+
+// Bit i of the result is the XOR of bits 0..i: set for every byte after an
+// odd number of quotes, i.e. inside a quoted field.
+static uint32_t prefix_xor(uint32_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    return x;
+}
+
+static int lowest_bit(uint32_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#else
+    int i = 0;
+    while (!(x & 1u)) { x >>= 1; i++; }
+    return i;
+#endif
+}
+
+static int bit_count(uint32_t x) {
+    int n = 0;
+    for (; x; x &= x - 1) n++;
+    return n;
+}
+
+int csvOpen(CsvReader *rd, const char *path) {
+    memset(rd, 0, sizeof(*rd));
+    rd->fp = fopen(path, "rb");
+    if (!rd->fp) return 0;
+    rd->buf = malloc(CSV_BLOCK + CSV_PAD);
+    if (!rd->buf) {
+        fclose(rd->fp);
+        rd->fp = NULL;
+        return 0;
+    }
+    rd->cap = CSV_BLOCK;
+    rd->line = 1;
+    rd->len = fread(rd->buf, 1, rd->cap, rd->fp);
+    rd->eof = rd->len < rd->cap;
+    memset(rd->buf + rd->len, 0, CSV_PAD);
+    if (rd->len >= 3 && memcmp(rd->buf, "\xEF\xBB\xBF", 3) == 0) rd->pos = 3;
+    return 1;
+}
+
+void csvClose(CsvReader *rd) {
+    if (rd->fp) fclose(rd->fp);
+    free(rd->buf);
+    memset(rd, 0, sizeof(*rd));
+}
+
+// Keep the unread tail, grow the buffer if the tail fills it, and read more.
+// Returns 0 when out of memory or on a read error.
+static int refill(CsvReader *rd) {
+    size_t keep = rd->len - rd->pos;
+    memmove(rd->buf, rd->buf + rd->pos, keep);
+    rd->pos = 0;
+    rd->len = keep;
+    if (keep == rd->cap) {
+        char *grown = realloc(rd->buf, rd->cap * 2 + CSV_PAD);
+        if (!grown) return 0;
+        rd->buf = grown;
+        rd->cap *= 2;
+    }
+    size_t got = fread(rd->buf + rd->len, 1, rd->cap - rd->len, rd->fp);
+    rd->len += got;
+    if (rd->len < rd->cap) rd->eof = 1;
+    memset(rd->buf + rd->len, 0, CSV_PAD);
+    return !ferror(rd->fp);
+}
+
+// Strip the quotes of a quoted field in place and NUL-terminate it. Text
+// after the closing quote is kept as is.
+static CsvField finish_field(char *buf, size_t s, size_t e) {
+    CsvField f = { buf + s, 0 };
+    size_t out = s;
+    if (e > s && buf[s] == '"') {
+        size_t i = s + 1;
+        while (i < e) {
+            if (buf[i] != '"') {
+                buf[out++] = buf[i++];
+            } else if (i + 1 < e && buf[i + 1] == '"') {
+                buf[out++] = '"';
+                i += 2;
+            } else {
+                for (++i; i < e; ++i) buf[out++] = buf[i];
+            }
+        }
+    } else {
+        out = e;
+    }
+    buf[out] = '\0';
+    f.len = out - s;
+    return f;
+}
+
+int csvNextRecord(CsvReader *rd, CsvField fields[], int max, int *nfields, long *line) {
+    size_t start[CSV_MAX_FIELDS + 1], end[CSV_MAX_FIELDS + 1];
+    if (max > CSV_MAX_FIELDS) max = CSV_MAX_FIELDS;
+
+    for (;;) {
+        if (rd->pos >= rd->len) {
+            if (rd->eof) return 0;
+            if (!refill(rd)) return -2;
+            continue;
+        }
+
+        // Find the record's delimiters block by block. The record starts
+        // outside quotes, so a rescan after a refill starts from scratch.
+        size_t field_start = rd->pos;
+        int n = 0, found = 0;
+        long lines = 0;
+        uint32_t carry = 0;     // all ones while inside quotes across blocks
+        size_t off;
+        for (off = rd->pos; off < rd->len && !found; off += 32) {
+            uint32_t q, c, nl;
+            block_masks(rd->buf + off, &q, &c, &nl);
+            size_t avail = rd->len - off;
+            uint32_t valid = avail >= 32 ? ~0u : (1u << avail) - 1;
+            q &= valid;
+            c &= valid;
+            nl &= valid;
+            uint32_t inside = prefix_xor(q) ^ carry;
+            uint32_t delim = (c | nl) & ~inside;
+            while (delim) {
+                int bit = lowest_bit(delim);
+                size_t at = off + (size_t)bit;
+                if (n < max) {
+                    start[n] = field_start;
+                    end[n] = at;
+                }
+                n++;
+                field_start = at + 1;
+                if (nl & (1u << bit)) {
+                    lines += bit_count(nl & ((2u << bit) - 1));
+                    rd->pos = at + 1;
+                    found = 1;
+                    break;
+                }
+                delim &= delim - 1;
+            }
+            if (found) break;
+            lines += bit_count(nl);
+            int last = avail >= 32 ? 31 : (int)avail - 1;
+            carry = (inside >> last) & 1u ? ~0u : 0;
+        }
+
+        if (!found) {
+            if (!rd->eof) {
+                if (!refill(rd)) return -2;
+                continue;
+            }
+            if (carry) return -1;   // quote still open at end of file
+            if (n < max) {
+                start[n] = field_start;
+                end[n] = rd->len;
+            }
+            n++;
+            rd->pos = rd->len;
+        }
+
+        *line = rd->line;
+        rd->line += lines;
+
+        // a CRLF line ending leaves '\r' on the last field
+        int kept = n < max ? n : max;
+        if (found && n <= max && end[n - 1] > start[n - 1] && rd->buf[end[n - 1] - 1] == '\r') end[n - 1]--;
+        if (n == 1 && end[0] == start[0]) continue;     // blank line
+
+        for (int i = 0; i < kept; ++i) fields[i] = finish_field(rd->buf, start[i], end[i]);
+        *nfields = n;
+        return 1;
+    }
+}
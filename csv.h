@@ -0,0 +1,44 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Streaming RFC 4180 CSV reader. The file is read in large blocks and each
+// block is scanned 32 bytes at a time: commas, quotes and line breaks become
+// bitmasks, and a prefix XOR over the quote mask tells which of them sit
+// inside a quoted field. Quoted fields may hold commas, line breaks and
+// doubled quotes (""). A leading UTF-8 byte order mark is skipped.
+
+#define CSV_MAX_FIELDS 16
+
+// One field of the current record: NUL-terminated text inside the reader's
+// buffer, unquoted and unescaped. Valid until the next csvNextRecord call;
+// the caller may modify it in place (e.g. trim it).
+typedef struct {
+    char *text;
+    size_t len;
+} CsvField;
+
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t cap;         // usable bytes in buf (padding follows)
+    size_t len;         // bytes read into buf
+    size_t pos;         // start of the next record
+    int eof;
+    long line;          // physical line the next record starts on (1-based)
+} CsvReader;
+
+// Open path for reading. Returns 1 on success, 0 if the file cannot be opened
+// or memory runs out.
+int csvOpen(CsvReader *rd, const char *path);
+void csvClose(CsvReader *rd);
+
+// Read the next record into fields (at most max fields are kept; *nfields
+// gets the real count). *line gets the line the record starts on.
+// Returns 1 for a record, 0 at end of file, -1 for an unterminated quoted
+// field, or -2 for a read error or when memory runs out.
+int csvNextRecord(CsvReader *rd, CsvField fields[], int max, int *nfields, long *line);
+
+#endif
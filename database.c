@@ -1,9 +1,164 @@
 // database.c is a File I/O focused Module. File contains functions: loadDB(), saveDB()
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "records.h"
+#include "database.h"
+#include "arena.h"
+#include "dict.h"
+#include "names.h"
+#include "marks.h"
+#include "slotmap.h"
+#include "snapshot.h"
+#include "shard.h"
+
+// Room left on every line of a saved file, so an edit that makes a row a
+// little longer can still be written over the old line.
+#define SLOT_SLACK 8
+
+#define LOAD_BLOCK (1 << 22)     // bytes read per refill; grows for longer lines
+
+// Block-buffered line reader for loadDB: whole blocks are read at once and
+// lines are found with memchr rather than one fgets per line.
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t cap;     // usable bytes; one spare byte follows for a terminator
+    size_t len;
+    size_t pos;
+    long base;      // file offset of buf[0]
+    int eof;
+} LineReader;
+
+// Bytes of the text file the table was last loaded from or saved to (-1:
+// none).
+static long loaded_bytes = -1;
+
+// Keep the unread tail, grow the buffer when the tail fills it, and read
+// the next block. Returns 0 when out of memory.
+static int refill_lines(LineReader *lr) {
+    size_t keep = lr->len - lr->pos;
+    memmove(lr->buf, lr->buf + lr->pos, keep);
+    lr->base += (long)lr->pos;
+    lr->pos = 0;
+    lr->len = keep;
+    if (keep == lr->cap) {
+        char *grown = realloc(lr->buf, lr->cap * 2 + 1);
+        if (!grown) return 0;
+        lr->buf = grown;
+        lr->cap *= 2;
+    }
+    lr->len += fread(lr->buf + lr->len, 1, lr->cap - lr->len, lr->fp);
+    if (lr->len < lr->cap) lr->eof = 1;
+    return 1;
+}
+
+// The next line, including its '\n' when it has one. The byte after the
+// line may be overwritten. Returns 1 for a line, 0 at end of file, -1 when
+// out of memory.
+static int next_line(LineReader *lr, char **line, size_t *len) {
+    for (;;) {
+        char *start = lr->buf + lr->pos;
+        char *nl = memchr(start, '\n', lr->len - lr->pos);
+        if (nl || (lr->eof && lr->pos < lr->len)) {
+            *line = start;
+            *len = nl ? (size_t)(nl - start) + 1 : lr->len - lr->pos;
+            lr->pos += *len;
+            return 1;
+        }
+        if (lr->eof) return 0;
+        if (!refill_lines(lr)) return -1;
+    }
+}
+
+// Split a row in the exact shape SAVE writes, ID<TAB>Name<TAB>Programme<TAB>
+// Mark (trailing padding allowed), in place. Only accepts lines that the
+// sscanf parse below would read the same way; anything else returns 0 and
+// is left untouched for it.
+int splitRow(char *s, char *end, int *id, char **name, char **prog, char **mark) {
+    char *p = s;
+    int v = 0, digits = 0;
+    while (p < end && isdigit((unsigned char)*p)) {
+        v = v * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (digits > 9 || p == end || *p != '\t') return 0;
+
+    char *n = p + 1;
+    if (n == end || isspace((unsigned char)*n)) return 0;
+    char *n_end = memchr(n, '\t', (size_t)(end - n));
+    if (!n_end) return 0;
+
+    char *g = n_end + 1;
+    if (g == end || isspace((unsigned char)*g)) return 0;
+    char *g_end = memchr(g, '\t', (size_t)(end - g));
+    if (!g_end) return 0;
+
+    char *m = g_end + 1;
+    while (m < end && isspace((unsigned char)*m)) m++;
+    char *m_end = m;
+    while (m_end < end && !isspace((unsigned char)*m_end)) m_end++;
+    if (m == m_end || m_end - m > 31) return 0;
+
+    *n_end = *g_end = *m_end = '\0';
+    *id = v;
+    *name = n;
+    *prog = g;
+    *mark = m;
+    return 1;
+}
+
+int storeRow(const char *filename, int id, const char *name, const char *prog_text, int mark, StudentRecord *out) {
+    // programme text is interned; the record only keeps its code
+    int prog = internProgramme(prog_text);
+    if (prog < 0) {
+        printf("CMS: Too many distinct programmes in '%s'.\n", filename);
+        return -1;
+    }
+
+    // store record safely
+    out->id = id;
+    if (!storeRecordName(out, name)) {
+        printf("CMS: Out of memory while reading '%s'.\n", filename);
+        return -1;
+    }
+    out->prog = (uint16_t)prog;
+    out->mark = (int16_t)mark;
+    return 1;
+}
+
+int parseRow(const char *filename, char *s, char *end, StudentRecord *out) {
+    int id = 0;
+    int mark = 0;
+    char *name, *prog_text, *mark_text;
+    char name_buf[512];
+    char prog_buf[512];
+    char mark_buf[32];
+
+    if (!splitRow(s, end, &id, &name, &prog_text, &mark_text)) {
+        // Try to parse tab-separated: ID<TAB>Name<TAB>Programme<TAB>Mark
+        int matched = sscanf(s, "%d\t%511[^\t]\t%511[^\t]\t%31s", &id, name_buf, prog_buf, mark_buf);
+        if (matched != 4) {
+            // fallback: try whitespace-separated tokens (names/programme without spaces)
+            matched = sscanf(s, "%d %511s %511s %31s", &id, name_buf, prog_buf, mark_buf);
+            if (matched != 4) return 0; // could not parse; skip line
+        }
+        name = name_buf;
+        prog_text = prog_buf;
+        mark_text = mark_buf;
+    }
+    if (!parseMark(mark_text, &mark) || mark < MARK_MIN || mark > MARK_MAX) return 0; // bad mark; skip line
+    return storeRow(filename, id, name, prog_text, mark, out);
+}
 
 // Rmb to make sure file is read-only
 int loadDB(const char *filename, StudentRecord records[], int *count)
@@ -13,68 +168,277 @@ int loadDB(const char *filename, StudentRecord records[], int *count)
         return 0;
     }
 
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
+    // binary snapshots (SAVE SNAPSHOT) are recognised by their first bytes,
+    // shard manifests (SAVE SHARDED) by their first line
+    loaded_bytes = -1;
+    if (isShardManifest(filename)) return loadShards(filename, records, count);
+    shardDetach();
+    if (isSnapshotFile(filename)) return loadSnapshot(filename, records, count);
+
+    LineReader lr = { fopen(filename, "r"), NULL, LOAD_BLOCK, 0, 0, 0, 0 };
+    if (!lr.fp) {
         printf("CMS: Unable to open file '%s'\n", filename);
         return 0;
     }
+    lr.buf = malloc(LOAD_BLOCK + 1);
+    if (!lr.buf) {
+        printf("CMS: Out of memory while reading '%s'.\n", filename);
+        fclose(lr.fp);
+        return 0;
+    }
 
-    char line[512];
     *count = 0;
+    resetNames(); // the previous table's names are dropped with it
+    tableReloaded();
+
+    // A file whose lines all have one width (as SAVE writes them) can later be
+    // saved in place; remember which line each row came from.
+    int fixed = slotMapStart(filename);
+    size_t width = 0;
+    int line_no = 0;
+    int ok = 1;
+    char *line;
+    size_t len;
+    int got;
 
-    while (*count < MAX_RECORDS && fgets(line, sizeof(line), fp)) {
-        size_t len = strlen(line);
-        
-        while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r')) line[--len] = '\0';
-        if (len == 0) continue; // skip blank lines
+    // The metadata block (Database Name, Authors, Table Name, column header)
+    // holds no rows: skip the leading lines that are text or empty in one go.
+    // A row or a space-padded free slot ends the block.
+    while ((got = next_line(&lr, &line, &len)) > 0) {
+        char *s = line, *end = line + len;
+        while (s < end && (*s == ' ' || *s == '\t')) s++;
+        int text = s < end && *s != '\n' && *s != '\r';
+        if ((text && isdigit((unsigned char)*s)) || (!text && s > line)) {
+            lr.pos -= len;      // hand the line back to the row loop
+            break;
+        }
+        if (line_no++ == 0) width = len;
+        fixed = 0;
+    }
+
+    while (got > 0 && *count < MAX_RECORDS && (got = next_line(&lr, &line, &len)) > 0) {
+        if (line_no == 0) width = len;
+        if (len != width || line[len - 1] != '\n') fixed = 0;
+        int slot = line_no++;
+
+        char *end = line + len;
+        while (end > line && (end[-1] == '\n' || end[-1] == '\r')) end--;
+        *end = '\0';
+        if (end == line) continue; // skip blank lines
 
-    
         char *s = line;
         while (*s && isspace((unsigned char)*s)) s++;
+        if (*s == '\0') {
+            // a line blanked by SAVE after a delete; a new row may reuse it
+            if (fixed) fixed = slotMapAddFree(slot);
+            continue;
+        }
 
         // skip non-data lines (metadata or header). Data lines start with a digit (ID).
         if (!isdigit((unsigned char)*s)) {
-            // also skip header like "ID\tName..." 
-            if (strncmp(s, "ID\t", 3) == 0 || strncmp(s, "ID ", 3) == 0) continue;
+            fixed = 0;
             continue;
         }
 
-        // Try to parse tab-separated: ID<TAB>Name<TAB>Programme<TAB>Mark 
-        int id = 0;
-        char name_buf[STRING_LEN];
-        char prog_buf[STRING_LEN];
-        float mark = 0.0f;
-
-        int matched = sscanf(s, "%d\t%49[^\t]\t%49[^\t]\t%f", &id, name_buf, prog_buf, &mark);
-        if (matched != 4) {
-            // fallback: try whitespace-separated tokens (names/programme without spaces) 
-            matched = sscanf(s, "%d %49s %49s %f", &id, name_buf, prog_buf, &mark);
-            if (matched != 4) continue; // could not parse; skip line 
+        int rc = parseRow(filename, s, end, &records[*count]);
+        if (rc < 0) {
+            ok = 0;
+            break;
         }
-
-        // store record safely 
-        records[*count].id = id;
-        strncpy(records[*count].name, name_buf, STRING_LEN - 1);
-        records[*count].name[STRING_LEN - 1] = '\0';
-        strncpy(records[*count].programme, prog_buf, STRING_LEN - 1);
-        records[*count].programme[STRING_LEN - 1] = '\0';
-        records[*count].mark = mark;
+        if (rc == 0) { fixed = 0; continue; }
+        if (fixed) slotMapPlace(*count, slot);
         (*count)++;
     }
+    if (ok && got < 0) {
+        printf("CMS: Out of memory while reading '%s'.\n", filename);
+        ok = 0;
+    }
+    if (*count == MAX_RECORDS && (lr.pos < lr.len || !lr.eof)) fixed = 0;
+    long parsed = lr.base + (long)lr.pos;
 
-    if (ferror(fp)) {
+    if (ok && ferror(lr.fp)) {
         printf("CMS: Error while reading file '%s'.\n", filename);
-        fclose(fp);
+        ok = 0;
+    }
+    free(lr.buf);
+    if (!ok) {
+        fclose(lr.fp);
         return 0;
     }
 
-    if (fclose(fp) == EOF) {
+    if (fclose(lr.fp) == EOF) {
         printf("CMS: File '%s' was not closed properly. Data may be incomplete.\n", filename);
         return -1;
     }
 
+    // IDs are the primary key: index them and keep the first row of any repeat
+    int dropped = rebuildIdIndex(records, count);
+    if (dropped > 0) {
+        printf("CMS: WARNING: %d line(s) in '%s' repeat an earlier ID and were skipped.\n", dropped, filename);
+    }
+
+    if (fixed && dropped == 0 && width > 1) slotMapFinish(line_no, (int)width);
+    else slotMapForget();
+
+    loaded_bytes = parsed;
+    return 1;
+}
+
+long loadedBytes(void) {
+    return loaded_bytes;
+}
+
+int loadTail(const char *filename, long *offset, StudentRecord records[], int *count, int *skipped) {
+    LineReader lr = { fopen(filename, "r"), NULL, LOAD_BLOCK, 0, 0, *offset, 0 };
+    *skipped = 0;
+    if (!lr.fp) {
+        printf("CMS: Unable to open file '%s'\n", filename);
+        return -1;
+    }
+    lr.buf = malloc(LOAD_BLOCK + 1);
+    if (!lr.buf || fseek(lr.fp, *offset, SEEK_SET) != 0) {
+        printf("CMS: Error while reading file '%s'.\n", filename);
+        free(lr.buf);
+        fclose(lr.fp);
+        return -1;
+    }
+
+    int added = 0, fatal = 0, got;
+    char *line;
+    size_t len;
+    while ((got = next_line(&lr, &line, &len)) > 0) {
+        // a line still being written is left for the next call
+        if (line[len - 1] != '\n') {
+            lr.pos -= len;
+            break;
+        }
+        char *end = line + len;
+        while (end > line && (end[-1] == '\n' || end[-1] == '\r')) end--;
+        *end = '\0';
+        char *s = line;
+        while (*s && isspace((unsigned char)*s)) s++;
+        if (!isdigit((unsigned char)*s)) continue;
+
+        StudentRecord r;
+        int rc = parseRow(filename, s, end, &r);
+        if (rc < 0) {
+            fatal = 1;
+            break;
+        }
+        if (rc == 0) continue;
+        // IDs are the primary key: a repeat of a loaded row is dropped, as in loadDB
+        if (*count >= MAX_RECORDS || findRecordById(records, *count, r.id) >= 0) {
+            releaseRecordName(&r);
+            (*skipped)++;
+            continue;
+        }
+        appendRow(records, count, &r);
+        added++;
+    }
+    *offset = lr.base + (long)lr.pos;
+    loaded_bytes = *offset;
+    int failed = got < 0 || ferror(lr.fp);
+    free(lr.buf);
+    fclose(lr.fp);
+    if (failed) printf("CMS: Error while reading file '%s'.\n", filename);
+    return failed || fatal ? -1 : added;
+}
+
+// One row as a tab-separated line without the newline. Returns its full
+// length, even when that did not fit in size (buf may then be NULL).
+static int format_row(const StudentRecord *r, char *buf, size_t size) {
+    char mark[MARK_BUF_LEN];
+    return snprintf(buf, size, "%d\t%s\t%s\t%s",
+                    r->id, recordName(r), programmeName(r->prog), formatMark(r->mark, mark));
+}
+
+// Write one row padded with spaces to width bytes, newline included.
+static int write_row(FILE *fp, const StudentRecord *r, int width) {
+    char mark[MARK_BUF_LEN];
+    int len = fprintf(fp, "%d\t%s\t%s\t%s", r->id, recordName(r), programmeName(r->prog), formatMark(r->mark, mark));
+    return len >= 0 && fprintf(fp, "%*s\n", width - 1 - len, "") >= 0;
+}
+
+#ifndef _WIN32
+#define RUN_BYTES (1 << 16)
+
+typedef struct {
+    int slot;
+    int row;
+} SlotRow;
+
+static int by_slot(const void *a, const void *b) {
+    const SlotRow *x = a, *y = b;
+    return (x->slot > y->slot) - (x->slot < y->slot);
+}
+
+// Overwrite just the lines that changed since the file was last read or
+// written: edited rows, blanked deletes and new rows in reused or appended
+// lines. Runs of neighbouring lines go out in one pwrite. Returns 0 when the
+// whole file has to be rewritten instead.
+static int save_in_place(const char *filename, const StudentRecord records[], int count) {
+    if (!slotMapReady(filename)) return 0;
+    int fd = open(filename, O_WRONLY);
+    if (fd < 0) return 0;
+
+    // someone else changed the file since we read or wrote it
+    // (and lines wider than the run buffer are left to a full rewrite)
+    struct stat st;
+    int width = slotMapWidth();
+    if (width > RUN_BYTES || fstat(fd, &st) != 0 || st.st_size != (off_t)slotMapSlots() * width || !slotMapAssign(count)) {
+        close(fd);
+        return 0;
+    }
+
+    // rows sitting on dirty lines, in file order
+    int dirty = slotMapDirtyCount();
+    ArenaMark mark = arenaMark();
+    SlotRow *rows = arenaAlloc((size_t)(dirty > 0 ? dirty : 1) * sizeof(*rows));
+    if (!rows) {
+        close(fd);
+        return 0;
+    }
+    int n = 0;
+    for (int i = 0; i < count && n < dirty; ++i) {
+        int slot = slotOfRow(i);
+        if (slotIsDirty(slot)) rows[n++] = (SlotRow){ slot, i };
+    }
+    qsort(rows, (size_t)n, sizeof(*rows), by_slot);
+
+    static char run[RUN_BYTES];
+    int run_start = 0, run_len = 0, k = 0, ok = 1;
+    for (int s = slotMapNextDirty(0); s != NO_SLOT && ok; s = slotMapNextDirty(s + 1)) {
+        if (run_len > 0 && (s != run_start + run_len / width || run_len + width > (int)sizeof(run))) {
+            ok = pwrite(fd, run, (size_t)run_len, (off_t)run_start * width) == run_len;
+            run_len = 0;
+        }
+        if (run_len == 0) run_start = s;
+        char *line = run + run_len;
+        int len = 0;
+        if (k < n && rows[k].slot == s) {
+            len = format_row(&records[rows[k++].row], line, (size_t)width);
+            if (len >= width) ok = 0;   // the row outgrew its line
+        }
+        if (ok) {
+            memset(line + len, ' ', (size_t)(width - 1 - len));
+            line[width - 1] = '\n';
+            run_len += width;
+        }
+    }
+    if (ok && run_len > 0) ok = pwrite(fd, run, (size_t)run_len, (off_t)run_start * width) == run_len;
+    ok = close(fd) == 0 && ok;
+    arenaRelease(mark);
+
+    if (!ok) {
+        // lines already written are rewritten along with everything else
+        slotMapForget();
+        return 0;
+    }
+    slotMapClean();
+    loaded_bytes = (long)st.st_size;
     return 1;
 }
+#endif
 
 int saveDB(const char *filename, const StudentRecord records[], int count)
 {
@@ -83,6 +447,23 @@ int saveDB(const char *filename, const StudentRecord records[], int count)
         return 0;
     }
 
+    if (shardedAt(filename)) {
+        loaded_bytes = -1;
+        return saveShards(filename, records, count);
+    }
+#ifndef _WIN32
+    if (save_in_place(filename, records, count)) return 1;
+#endif
+
+    // Every line gets the same width so later SAVEs can overwrite single
+    // rows in place; the longest row sets it.
+    int longest = 0;
+    for (int i = 0; i < count; ++i) {
+        int len = format_row(&records[i], NULL, 0);
+        if (len > longest) longest = len;
+    }
+    int width = (longest + 1 + SLOT_SLACK + 15) / 16 * 16;
+
     FILE *fp = fopen(filename, "w");
     if (!fp) {
         printf("CMS: Unable to write to file: %s\n", filename);
@@ -91,20 +472,20 @@ int saveDB(const char *filename, const StudentRecord records[], int count)
 
     // save as tab-separated to preserve spaces inside name/programme 
     for (int i = 0; i < count; ++i) {
-        if (fprintf(fp, "%d\t%s\t%s\t%.1f\n",
-                    records[i].id,
-                    records[i].name,
-                    records[i].programme,
-                    records[i].mark) < 0) {
+        if (!write_row(fp, &records[i], width)) {
             printf("CMS: Write error occurred while saving to file: %s\n", filename);
             fclose(fp);
+            slotMapForget();
             return 0;
         }
     }
 
     if (fclose(fp) == EOF) {
         printf("CMS: Critical error while closing file: %s\n", filename);
+        slotMapForget();
         return -1;
     }
+    slotMapAdopt(filename, width, count);
+    loaded_bytes = (long)count * width;
     return 1;
 }
\ No newline at end of file
@@ -11,6 +11,29 @@ extern "C" {
 int loadDB(const char *filename, StudentRecord records[], int *count);
 int saveDB(const char *filename, const StudentRecord records[], int count);
 
+// Size of the text file as the table last loaded or saved it (what loadDB
+// or loadTail parsed, or what saveDB wrote), or -1 when the table did not
+// come from a text file.
+long loadedBytes(void);
+
+// Parse the complete lines appended to filename after byte *offset and
+// append their rows to the table. *offset moves past the last complete line;
+// a partly written last line is left for the next call. Rows repeating an
+// ID already in the table are counted in *skipped. Returns the number of
+// rows added, or -1 on error.
+int loadTail(const char *filename, long *offset, StudentRecord records[], int *count, int *skipped);
+
+// Row parsing, shared with the sharded loader (shard.c).
+// splitRow splits a line in the exact shape SAVE writes in place (s is its
+// first non-blank byte, *end its terminator) and returns 1, or returns 0 and
+// leaves any other line untouched. storeRow interns the programme and copies
+// the name into *out. parseRow parses a line of any accepted shape into *out:
+// 1 for a row, 0 for a line that holds no valid row. Both return -1 when the
+// row cannot be stored (message printed).
+int splitRow(char *s, char *end, int *id, char **name, char **prog, char **mark);
+int storeRow(const char *filename, int id, const char *name, const char *prog, int mark, StudentRecord *out);
+int parseRow(const char *filename, char *s, char *end, StudentRecord *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,96 @@
+// dict.c interns programme strings. Records store a small integer code and
+// this module maps codes <-> text, so equal programmes compare as integers.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dict.h"
+
+#define EMPTY_SLOT 0xFFFF
+
+static char **names = NULL;       // code -> interned text
+static int name_count = 0;
+static int name_cap = 0;
+
+static uint16_t *slots = NULL;    // open-addressing hash table of codes
+static size_t slot_cap = 0;       // always a power of two
+
+// FNV-1a string hash
+static uint32_t hash_str(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// find the slot holding name, or the empty slot where it would go
+static size_t probe(const char *name, uint32_t h) {
+    size_t mask = slot_cap - 1;
+    size_t i = h & mask;
+    while (slots[i] != EMPTY_SLOT && strcmp(names[slots[i]], name) != 0) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// double the hash table and re-insert every code
+static int grow_slots(void) {
+    size_t new_cap = slot_cap ? slot_cap * 2 : 64;
+    uint16_t *fresh = malloc(new_cap * sizeof(*fresh));
+    if (!fresh) return 0;
+    for (size_t i = 0; i < new_cap; ++i) fresh[i] = EMPTY_SLOT;
+
+    free(slots);
+    slots = fresh;
+    slot_cap = new_cap;
+    for (int c = 0; c < name_count; ++c) {
+        slots[probe(names[c], hash_str(names[c]))] = (uint16_t)c;
+    }
+    return 1;
+}
+
+int findProgramme(const char *name) {
+    if (!name || slot_cap == 0) return -1;
+    size_t i = probe(name, hash_str(name));
+    return slots[i] == EMPTY_SLOT ? -1 : slots[i];
+}
+
+int internProgramme(const char *name) {
+    if (!name) return -1;
+
+    int code = findProgramme(name);
+    if (code != -1) return code;
+    if (name_count >= MAX_PROGRAMMES) return -1;
+
+    // keep the load factor at or below one half
+    if ((size_t)(name_count + 1) * 2 > slot_cap && !grow_slots()) return -1;
+
+    if (name_count == name_cap) {
+        int new_cap = name_cap ? name_cap * 2 : 32;
+        char **grown = realloc(names, (size_t)new_cap * sizeof(*grown));
+        if (!grown) return -1;
+        names = grown;
+        name_cap = new_cap;
+    }
+
+    size_t len = strlen(name);
+    char *copy = malloc(len + 1);
+    if (!copy) return -1;
+    memcpy(copy, name, len + 1);
+
+    code = name_count++;
+    names[code] = copy;
+    slots[probe(copy, hash_str(copy))] = (uint16_t)code;
+    return code;
+}
+
+const char *programmeName(uint16_t code) {
+    if (code >= name_count) return "";
+    return names[code];
+}
+
+int programmeCount(void) {
+    return name_count;
+}
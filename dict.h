@@ -0,0 +1,25 @@
+#ifndef DICT_H
+#define DICT_H
+
+#include <stdint.h>
+
+// Programme dictionary. Every distinct programme string is stored once and
+// each StudentRecord keeps a 16-bit code into this table instead of the text.
+// Codes are handed out in first-seen order and stay valid for the whole run.
+
+#define MAX_PROGRAMMES 65535
+
+// Return the code for name, adding it to the dictionary if it is new.
+// Returns -1 when the dictionary is full or name is NULL.
+int internProgramme(const char *name);
+
+// Return the code for name without adding it, or -1 if it was never interned.
+int findProgramme(const char *name);
+
+// Decode a programme code back to its text ("" for an unknown code).
+const char *programmeName(uint16_t code);
+
+// Number of distinct programmes interned so far.
+int programmeCount(void);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "records.h"
+
+// Write the table to path as CSV in the format IMPORT reads: a header line
+// "ID,Name,Programme,Mark", then one row per line. Fields holding a comma,
+// quote or line break are quoted RFC 4180 style. Rows are formatted in
+// chunks on several threads and written in large sequential writes.
+// Returns the number of rows written, or -1 with a message on error.
+int exportCsv(const char *path, const StudentRecord records[], int count);
+
+#endif
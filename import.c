@@ -4,8 +4,15 @@
 #include <stdlib.h>
 
 #include "import.h"
+#include "csv.h"
 #include "history.h"
 #include "records.h"
+#include "dict.h"
+#include "names.h"
+#include "marks.h"
+#include "sketch.h"
+#include "summary.h"
+#include "arena.h"
 
 #ifndef REQUIRED_LENGTH
 #define REQUIRED_LENGTH 7
@@ -23,6 +30,118 @@ static char *trim(char *s) {
     return s;
 }
 
+// Rows parsed from the file, staged in record pool blocks (arena.h): a
+// small file takes one block rather than a table-sized buffer.
+typedef struct {
+    StudentRecord *block[MAX_RECORDS / RECORD_BLOCK_ROWS + 1];
+    int blocks;
+    int count;
+} Staged;
+
+static StudentRecord *staged_row(const Staged *s, int t) {
+    return &s->block[t / RECORD_BLOCK_ROWS][t % RECORD_BLOCK_ROWS];
+}
+
+// Slot for the next row (counted once filled in), or NULL when out of memory.
+static StudentRecord *stage_slot(Staged *s) {
+    if (s->count == s->blocks * RECORD_BLOCK_ROWS) {
+        StudentRecord *b = recordBlockGet();
+        if (!b) return NULL;
+        s->block[s->blocks++] = b;
+    }
+    return staged_row(s, s->count);
+}
+
+// Hand the blocks back to the pool
+static void free_staged(Staged *s) {
+    for (int b = 0; b < s->blocks; ++b) recordBlockPut(s->block[b]);
+    s->blocks = s->count = 0;
+}
+
+// release the arena names of staged rows that will not reach the table
+static void discard_staged(Staged *s) {
+    for (int t = 0; t < s->count; ++t) releaseRecordName(staged_row(s, t));
+    free_staged(s);
+}
+
+// (id, position) pairs used to reconcile staged rows against the table
+typedef struct {
+    int id;
+    int pos;
+} IdPos;
+
+static int compare_id_pos(const void *pa, const void *pb) {
+    const IdPos *a = pa, *b = pb;
+    if (a->id != b->id) return (a->id > b->id) - (a->id < b->id);
+    return (a->pos > b->pos) - (a->pos < b->pos);
+}
+
+// Match the staged rows against the table. For every staged row,
+// target[t] becomes the table index it overwrites, -1 to append it, or -2
+// when a later row in the same file has the same ID (last one wins).
+// Returns the number of table rows that will be overwritten, or -1 when out
+// of memory. *file_dups gets the number of rows dropped as within-file duplicates.
+//
+// The ID filter settles most new IDs without a lookup. When few of the rest
+// may exist they are looked up in the index; otherwise they are merged
+// against a sorted copy of the table's IDs.
+static int reconcile(const StudentRecord records[], int count, const Staged *staged,
+                     int target[], int *file_dups) {
+    int n = staged->count;
+    ArenaMark mark = arenaMark();
+    IdPos *in = arenaAlloc((size_t)n * sizeof(*in));
+    if (!in) return -1;
+    for (int t = 0; t < n; ++t) in[t] = (IdPos){ staged_row(staged, t)->id, t };
+    qsort(in, (size_t)n, sizeof(*in), compare_id_pos);
+
+    int dups = 0, maybe = 0;
+    for (int t = 0; t < n; ++t) {
+        // equal IDs are adjacent and in file order; only the last survives
+        if (t + 1 < n && in[t + 1].id == in[t].id) {
+            target[in[t].pos] = -2;
+            dups++;
+        } else if (!idMayExist(records, count, in[t].id)) {
+            target[in[t].pos] = -1;
+        } else {
+            in[maybe++] = in[t];    // still in ID order
+        }
+    }
+    *file_dups = dups;
+
+    int overwrites = 0;
+    if (maybe <= count / 8) {
+        for (int t = 0; t < maybe; ++t) {
+            int i = findRecordById(records, count, in[t].id);
+            target[in[t].pos] = i;
+            if (i >= 0) overwrites++;
+        }
+        arenaRelease(mark);
+        return overwrites;
+    }
+
+    IdPos *table = arenaAlloc((size_t)count * sizeof(*table));
+    if (!table) {
+        arenaRelease(mark);
+        return -1;
+    }
+    for (int i = 0; i < count; ++i) table[i] = (IdPos){ records[i].id, i };
+    qsort(table, (size_t)count, sizeof(*table), compare_id_pos);
+
+    int i = 0;
+    for (int t = 0; t < maybe; ++t) {
+        while (i < count && table[i].id < in[t].id) i++;
+        if (i < count && table[i].id == in[t].id) {
+            target[in[t].pos] = table[i].pos;
+            overwrites++;
+        } else {
+            target[in[t].pos] = -1;
+        }
+    }
+
+    arenaRelease(mark);
+    return overwrites;
+}
+
 // Logic for IMPORT feature
 int importRecords(const char *local_args, StudentRecord records[], int *count) {
     // Make sure IMPORT contains filename
@@ -39,8 +158,8 @@ int importRecords(const char *local_args, StudentRecord records[], int *count) {
     trim(fname);
 
     // Open CSV file
-    FILE *fp = fopen(fname, "r");
-    if (!fp) {
+    CsvReader rd;
+    if (!csvOpen(&rd, fname)) {
         printf("CMS: Unable to find '%s' for import.\n", fname);
         char msg[HISTORY_DESC_LEN]; 
         snprintf(msg, sizeof(msg), "IMPORT: Failed to open '%s'", fname); 
@@ -49,63 +168,61 @@ int importRecords(const char *local_args, StudentRecord records[], int *count) {
     }
 
     // Temporary storage for parsed rows
-    StudentRecord tmp[MAX_RECORDS];
-    int tmp_count = 0;
-    int dup_count = 0;
+    Staged staged = { .blocks = 0, .count = 0 };
 
-    // Read file line by line
-    char line[512];
-    char header[512];
+    // Read the file record by record; fields arrive unquoted
+    CsvField f[CSV_MAX_FIELDS];
+    int nf = 0;
+    long line_no = 0;
     // Skip first row, since it is header
-    if (!fgets(header, sizeof(header), fp)) {
+    int got = csvNextRecord(&rd, f, CSV_MAX_FIELDS, &nf, &line_no);
+    if (got <= 0) {
         // Return error if no rows or missing rows
-        printf("CMS: Missing key columns in \"%s\". IMPORT cancelled.\n", fname);
-        fclose(fp);
+        if (got == -2) printf("CMS: Error while reading \"%s\". IMPORT cancelled.\n", fname);
+        else printf("CMS: Missing key columns in \"%s\". IMPORT cancelled.\n", fname);
+        csvClose(&rd);
         return 1;
     }
-    int line_no = 1;
-    while (fgets(line, sizeof(line), fp)) {
-        line_no++;
-        // Remove trailing newlines and skip empty newlines
-        size_t L = strlen(line);
-        while (L > 0 && (line[L - 1] == '\n' || line[L - 1] == '\r')) line[--L] = '\0';
-        if (L == 0) continue;
-
-        // Make a copy for splitting string
-        char buf[512];
-        strncpy(buf, line, sizeof(buf) - 1);
-        buf[sizeof(buf) - 1] = '\0';
-
-        // Split CSV into ID, Name, Programme, Mark
-        char *f0 = strtok(buf, ",");
-        char *f1 = strtok(NULL, ",");
-        char *f2 = strtok(NULL, ",");
-        char *f3 = strtok(NULL, ",");
-
-        // Check for missing columns, if any missing abort IMPORT
-        if (!f0 || !f1 || !f2 || !f3) {
-            printf("CMS: Missing value on line %d in \"%s\"\n", line_no, fname);
+    while ((got = csvNextRecord(&rd, f, CSV_MAX_FIELDS, &nf, &line_no)) > 0) {
+        // Trim whitespace from each field
+        char *p0 = nf > 0 ? trim(f[0].text) : "";
+        char *p1 = nf > 1 ? trim(f[1].text) : "";
+        char *p2 = nf > 2 ? trim(f[2].text) : "";
+        char *p3 = nf > 3 ? trim(f[3].text) : "";
+
+        // Check for missing or extra columns, if any abort IMPORT
+        if (nf != 4 || !*p0 || !*p1 || !*p2 || !*p3) {
+            if (nf > 4) printf("CMS: Too many values on line %ld in \"%s\" (quote fields that contain commas)\n", line_no, fname);
+            else printf("CMS: Missing value on line %ld in \"%s\"\n", line_no, fname);
             char msg[HISTORY_DESC_LEN];
-            snprintf(msg, sizeof(msg), "IMPORT: Failed - malformed CSV '%s' line %d", fname, line_no);
+            snprintf(msg, sizeof(msg), "IMPORT: Failed - malformed CSV '%s' line %ld", fname, line_no);
             addHistory(msg);
-            fclose(fp);
+            discard_staged(&staged);
+            csvClose(&rd);
             return 1;
         }
-
-        // Trim whitespace from each field
-        char *p0 = trim(f0);
-        char *p1 = trim(f1);
-        char *p2 = trim(f2);
-        char *p3 = trim(f3);
         
+        // A quoted field may hold a line break or tab, but the database file
+        // keeps one row per line with tab-separated fields
+        if (strpbrk(p0, "\n\r\t") || strpbrk(p1, "\n\r\t") || strpbrk(p2, "\n\r\t") || strpbrk(p3, "\n\r\t")) {
+            printf("CMS: Line break or tab inside a value on line %ld in \"%s\". IMPORT cancelled.\n", line_no, fname);
+            char msg[HISTORY_DESC_LEN];
+            snprintf(msg, sizeof(msg), "IMPORT: Failed - line break or tab in '%.100s' line %ld", fname, line_no);
+            addHistory(msg);
+            discard_staged(&staged);
+            csvClose(&rd);
+            return 1;
+        }
+
         // Make sure ID has REQUIRED_LENGTH = 7, if not, return error
         size_t idlen = strlen(p0);
         if (idlen != REQUIRED_LENGTH) {
-            printf("CMS: Invalid ID on line %d in \"%s\" - expected %d characters.\n", line_no, fname, REQUIRED_LENGTH);
+            printf("CMS: Invalid ID on line %ld in \"%s\" - expected %d characters.\n", line_no, fname, REQUIRED_LENGTH);
             char msg[HISTORY_DESC_LEN];
-            snprintf(msg, sizeof(msg), "IMPORT: Failed - invalid ID length in '%s' line %d", fname, line_no);
+            snprintf(msg, sizeof(msg), "IMPORT: Failed - invalid ID length in '%s' line %ld", fname, line_no);
             addHistory(msg);
-            fclose(fp);
+            discard_staged(&staged);
+            csvClose(&rd);
             return 1;
         }
         int id_digits = 1;
@@ -113,47 +230,83 @@ int importRecords(const char *local_args, StudentRecord records[], int *count) {
             if (!isdigit((unsigned char)p0[k])) { id_digits = 0; break; }
         }
         if (!id_digits) {
-            printf("CMS: Invalid ID on line %d in \"%s\" - ID must contain only digits.\n", line_no, fname);
+            printf("CMS: Invalid ID on line %ld in \"%s\" - ID must contain only digits.\n", line_no, fname);
             char msg[HISTORY_DESC_LEN];
-            snprintf(msg, sizeof(msg), "IMPORT: Failed - non-digit ID in '%s' line %d", fname, line_no);
+            snprintf(msg, sizeof(msg), "IMPORT: Failed - non-digit ID in '%s' line %ld", fname, line_no);
             addHistory(msg);
-            fclose(fp);
+            discard_staged(&staged);
+            csvClose(&rd);
             return 1;
         }
 
         // Parse and validate numeric/text fields
         int id = 0;
-        float mark = 0.0f;
+        int mark = 0;
         if (sscanf(p0, "%d", &id) != 1) continue;        // invalid ID
-        if (sscanf(p3, "%f", &mark) != 1) continue;      // invalid mark
-        if (mark < 0.0f || mark > 100.0f) continue;      // out-of-range mark
-
-        // Store parsed row into temporary array
-        if (tmp_count >= MAX_RECORDS) break;
-        tmp[tmp_count].id = id;
-        strncpy(tmp[tmp_count].name, p1, STRING_LEN - 1); tmp[tmp_count].name[STRING_LEN - 1] = '\0';
-        strncpy(tmp[tmp_count].programme, p2, STRING_LEN - 1); tmp[tmp_count].programme[STRING_LEN - 1] = '\0';
-        tmp[tmp_count].mark = mark;
-
-        // Check for duplicates
-        int is_dup = 0;
-        for (int i = 0; i < *count; ++i) {
-            if (records[i].id == id) { is_dup = 1; break; }
+        if (!parseMark(p3, &mark)) continue;             // invalid mark
+        if (mark < MARK_MIN || mark > MARK_MAX) continue; // out-of-range mark
+
+        // Encode programme into the shared dictionary
+        int prog = internProgramme(p2);
+        if (prog < 0) {
+            printf("CMS: Too many distinct programmes on line %ld in \"%s\". IMPORT cancelled.\n", line_no, fname);
+            addHistory("IMPORT: Failed - programme dictionary full");
+            discard_staged(&staged);
+            csvClose(&rd);
+            return 1;
         }
-        if (is_dup) dup_count++;
 
-        tmp_count++;
+        // Store parsed row in the staging blocks
+        if (staged.count >= MAX_RECORDS) break;
+        StudentRecord *row = stage_slot(&staged);
+        if (row) row->id = id;
+        if (!row || !storeRecordName(row, p1)) {
+            printf("CMS: Out of memory on line %ld in \"%s\". IMPORT cancelled.\n", line_no, fname);
+            discard_staged(&staged);
+            csvClose(&rd);
+            return 1;
+        }
+        row->prog = (uint16_t)prog;
+        row->mark = (int16_t)mark;
+        staged.count++;
     }
 
     // Close file
-    fclose(fp);
+    csvClose(&rd);
+    if (got < 0) {
+        char msg[HISTORY_DESC_LEN];
+        if (got == -2) {
+            printf("CMS: Error while reading \"%s\" after line %ld (out of memory or a read error). IMPORT cancelled.\n", fname, line_no);
+            snprintf(msg, sizeof(msg), "IMPORT: Failed - read error in '%.100s'", fname);
+        } else {
+            printf("CMS: Unterminated quoted field after line %ld in \"%s\". IMPORT cancelled.\n", line_no, fname);
+            snprintf(msg, sizeof(msg), "IMPORT: Failed - malformed CSV '%.100s'", fname);
+        }
+        addHistory(msg);
+        discard_staged(&staged);
+        return 1;
+    }
 
     // Return error if no valid rows found
-    if (tmp_count == 0) {
+    if (staged.count == 0) {
         printf("CMS: Missing valid rows in \"%s\". IMPORT cancelled.\n", fname);
+        free_staged(&staged);
         return 1;
     }
 
+    // Match staged rows to existing IDs in one sorted pass
+    int *target = arenaAlloc((size_t)staged.count * sizeof(*target));
+    int file_dups = 0;
+    int dup_count = target ? reconcile(records, *count, &staged, target, &file_dups) : -1;
+    if (dup_count < 0) {
+        printf("CMS: Out of memory. IMPORT cancelled.\n");
+        discard_staged(&staged);
+        return 1;
+    }
+    if (file_dups > 0) {
+        printf("CMS: %d row(s) in \"%s\" repeat an earlier ID; the last occurrence is used.\n", file_dups, fname);
+    }
+
     // Prompt if any rows will be overwritten (Y/N) to continue
     if (dup_count > 0) {
         char resp[8];
@@ -161,36 +314,104 @@ int importRecords(const char *local_args, StudentRecord records[], int *count) {
         fflush(stdout);
         if (!fgets(resp, sizeof(resp), stdin)) {
             printf("\nCMS: IMPORT cancelled.\n");
+            discard_staged(&staged);
             return 1;
         }
         if (!(resp[0] == 'Y' || resp[0] == 'y')) {
             printf("CMS: IMPORT cancelled by user.\n");
+            discard_staged(&staged);
             return 1;
         }
     }
 
-    // Overwrite existing IDs or append new ones
-    for (int t = 0; t < tmp_count; ++t) {
-        int found = 0;
-        for (int i = 0; i < *count; ++i) {
-            if (records[i].id == tmp[t].id) {
-                records[i] = tmp[t];
-                found = 1;
-                break;
-            }
-        }
-        if (!found) {
-            if (*count >= MAX_RECORDS) break;
-            records[*count] = tmp[t];
-            (*count)++;
+    // Overwrite existing IDs or append new ones, in file order
+    int imported = 0;
+    for (int t = 0; t < staged.count; ++t) {
+        StudentRecord *row = staged_row(&staged, t);
+        if (target[t] == -2) {
+            releaseRecordName(row);
+        } else if (target[t] >= 0) {
+            replaceRow(records, target[t], row);
+            imported++;
+        } else if (*count < MAX_RECORDS) {
+            appendRow(records, count, row);
+            imported++;
+        } else {
+            releaseRecordName(row);
         }
     }
+    free_staged(&staged);
 
     // Confirmation message
     printf("Imported successfully!\n");
     char msg_imp[HISTORY_DESC_LEN]; 
-    snprintf(msg_imp, sizeof(msg_imp), "IMPORT: Imported file '%s' (%d rows)", fname, 0);
+    snprintf(msg_imp, sizeof(msg_imp), "IMPORT: Imported file '%s' (%d rows)", fname, imported);
     addHistory(msg_imp);
     return 1;
 }
 
+
+// Stream a CSV once, feeding each valid mark into a KLL sketch and the
+// histogram. Memory use does not depend on the number of rows.
+int csvDistribution(const char *local_args) {
+    if (!local_args || !local_args[0]) {
+        printf("CMS: SHOW DISTRIBUTION requires a filename. Usage: SHOW DISTRIBUTION file.csv\n");
+        return 1;
+    }
+
+    char fname[260];
+    strncpy(fname, local_args, sizeof(fname) - 1);
+    fname[sizeof(fname) - 1] = '\0';
+    trim(fname);
+
+    CsvReader rd;
+    if (!csvOpen(&rd, fname)) {
+        printf("CMS: Unable to find '%s'.\n", fname);
+        return 1;
+    }
+
+    QuantileSketch sk;
+    sketchInit(&sk, SKETCH_DEFAULT_K);
+    long hist[DIST_BUCKETS] = { 0 };
+    long skipped = 0;
+
+    CsvField f[CSV_MAX_FIELDS];
+    int nf = 0;
+    long line_no = 0;
+    // Skip first row, since it is header
+    if (csvNextRecord(&rd, f, CSV_MAX_FIELDS, &nf, &line_no) > 0) {
+        while (csvNextRecord(&rd, f, CSV_MAX_FIELDS, &nf, &line_no) > 0) {
+            // only the Mark column (4th field) matters here
+            int mark = 0;
+            if (nf < 4 || !parseMark(trim(f[3].text), &mark) || mark < MARK_MIN || mark > MARK_MAX) {
+                skipped++;
+                continue;
+            }
+            if (!sketchAdd(&sk, mark)) {
+                printf("CMS: Out of memory while reading '%s'.\n", fname);
+                sketchFree(&sk);
+                csvClose(&rd);
+                return 1;
+            }
+            hist[distBucket(mark)]++;
+        }
+    }
+    csvClose(&rd);
+
+    double q[DIST_PERCENTILES];
+    for (int p = 0; p < DIST_PERCENTILES; ++p) q[p] = distPercentiles[p] / 100.0;
+    int values[DIST_PERCENTILES];
+    if (!sketchQuantiles(&sk, q, DIST_PERCENTILES, values)) {
+        printf("CMS: No valid marks in \"%s\".\n", fname);
+        sketchFree(&sk);
+        return 1;
+    }
+
+    char title[300];
+    snprintf(title, sizeof(title), "DISTRIBUTION of \"%s\"", fname);
+    char note[64];
+    snprintf(note, sizeof(note), "(approximate; %ld invalid row(s) skipped)", skipped);
+    printDistribution(title, sk.n, values, hist, note);
+    sketchFree(&sk);
+    return 1;
+}
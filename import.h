@@ -7,4 +7,8 @@
 
 int importRecords(const char *local_args, StudentRecord records[], int *count);
 
+// SHOW DISTRIBUTION <file.csv>: percentiles and histogram of a CSV's marks,
+// streamed through a quantile sketch without keeping the rows.
+int csvDistribution(const char *local_args);
+
 #endif
\ No newline at end of file
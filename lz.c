@@ -0,0 +1,116 @@
+// lz.c - byte-oriented LZ77 compressor and decompressor
+#include <string.h>
+
+#include "lz.h"
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+#define HASH_BITS 13
+
+static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// 15 in the nibble, then 255s and a final byte for the rest of len
+static size_t put_length(uint8_t *dst, size_t op, size_t cap, size_t len) {
+    while (len >= 255) {
+        if (op >= cap) return 0;
+        dst[op++] = 255;
+        len -= 255;
+    }
+    if (op >= cap) return 0;
+    dst[op++] = (uint8_t)len;
+    return op;
+}
+
+// Emit one sequence. match_len 0 means literals only (the last sequence).
+static size_t put_sequence(uint8_t *dst, size_t op, size_t cap, const uint8_t *lit, size_t lit_len,
+                           size_t offset, size_t match_len) {
+    if (op >= cap) return 0;
+    size_t token_at = op++;
+    uint8_t token = (uint8_t)((lit_len < 15 ? lit_len : 15) << 4);
+    if (lit_len >= 15 && !(op = put_length(dst, op, cap, lit_len - 15))) return 0;
+    if (lit_len > cap - op) return 0;
+    memcpy(dst + op, lit, lit_len);
+    op += lit_len;
+
+    if (match_len > 0) {
+        if (cap - op < 2) return 0;
+        dst[op++] = (uint8_t)(offset & 0xff);
+        dst[op++] = (uint8_t)(offset >> 8);
+        size_t extra = match_len - MIN_MATCH;
+        token |= (uint8_t)(extra < 15 ? extra : 15);
+        if (extra >= 15 && !(op = put_length(dst, op, cap, extra - 15))) return 0;
+    }
+    dst[token_at] = token;
+    return op;
+}
+
+size_t lzCompress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    uint32_t table[1 << HASH_BITS];     // position + 1 of the last 4 bytes with that hash
+    memset(table, 0, sizeof(table));
+
+    size_t ip = 0, anchor = 0, op = 0;
+    while (n >= MIN_MATCH && ip <= n - MIN_MATCH) {
+        uint32_t h = hash4(read32(src + ip));
+        size_t cand = table[h];
+        table[h] = (uint32_t)(ip + 1);
+        if (cand == 0 || ip - (cand - 1) > MAX_OFFSET || read32(src + cand - 1) != read32(src + ip)) {
+            ip++;
+            continue;
+        }
+        cand--;
+        size_t len = MIN_MATCH;
+        while (ip + len < n && src[cand + len] == src[ip + len]) len++;
+        op = put_sequence(dst, op, cap, src + anchor, ip - anchor, ip - cand, len);
+        if (op == 0) return 0;
+        ip += len;
+        anchor = ip;
+    }
+    return put_sequence(dst, op, cap, src + anchor, n - anchor, 0, 0);
+}
+
+// read a length continued past a 15 nibble
+static int get_length(const uint8_t *src, size_t n, size_t *ip, size_t *len) {
+    uint8_t b;
+    do {
+        if (*ip >= n) return 0;
+        b = src[(*ip)++];
+        *len += b;
+    } while (b == 255);
+    return 1;
+}
+
+int lzDecompress(const uint8_t *src, size_t n, uint8_t *dst, size_t dst_n) {
+    size_t ip = 0, op = 0;
+    while (ip < n) {
+        uint8_t token = src[ip++];
+
+        size_t lit = token >> 4;
+        if (lit == 15 && !get_length(src, n, &ip, &lit)) return 0;
+        if (lit > n - ip || lit > dst_n - op) return 0;
+        memcpy(dst + op, src + ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == n) break;     // the last sequence has no match
+
+        if (n - ip < 2) return 0;
+        size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+        ip += 2;
+        size_t len = token & 15;
+        if (len == 15 && !get_length(src, n, &ip, &len)) return 0;
+        len += MIN_MATCH;
+        if (offset == 0 || offset > op || len > dst_n - op) return 0;
+        // byte by byte: a match may overlap the bytes it is producing
+        const uint8_t *from = dst + op - offset;
+        for (size_t k = 0; k < len; ++k) dst[op + k] = from[k];
+        op += len;
+    }
+    return op == dst_n;
+}
@@ -0,0 +1,25 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Small LZ77 codec for blocks of text. The stream is a series of sequences:
+// a token byte (literal count in the high nibble, match length - 4 in the
+// low nibble, 15 meaning "more length bytes follow"), the literals, then a
+// 2-byte offset back into the output and any extra match length bytes. The
+// last sequence has literals only. Matches are found through a 4-byte hash,
+// so compression is one pass and decompression is a plain copy loop.
+
+// Worst-case compressed size for n input bytes.
+#define LZ_BOUND(n) ((n) + (n) / 255 + 16)
+
+// Compress src[0..n) into dst. Returns the compressed size, or 0 if it does
+// not fit in cap bytes.
+size_t lzCompress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap);
+
+// Decompress src[0..n) into exactly dst_n bytes. Returns 0 on a malformed
+// stream (never reads or writes out of bounds).
+int lzDecompress(const uint8_t *src, size_t n, uint8_t *dst, size_t dst_n);
+
+#endif
@@ -3,13 +3,28 @@
 #include <stdlib.h>
 #include <ctype.h> 
 #include <stdlib.h>
-#include <math.h>
 #include "database.h"
 #include "records.h"
 #include "sort.h"
 #include "summary.h"
 #include "banner.h"
 #include "history.h"
+#include "import.h"
+#include "dict.h"
+#include "names.h"
+#include "marks.h"
+#include "txn.h"
+#include "bulk.h"
+#include "settings.h"
+#include "archive.h"
+#include "snapshot.h"
+#include "columnar.h"
+#include "export.h"
+#include "where.h"
+#include "watch.h"
+#include "repl.h"
+#include "shard.h"
+#include "arena.h"
 
 # define REQUIRED_LENGTH 7
 
@@ -107,10 +122,60 @@ static int iequals(const char *a, const char *b) {
     return *a == *b;
 }
 
+// True when s starts with word (any case) followed by whitespace
+static int starts_with_word(const char *s, const char *word) {
+    while (*word) {
+        if (tolower((unsigned char)*s) != tolower((unsigned char)*word)) return 0;
+        s++; word++;
+    }
+    return isspace((unsigned char)*s);
+}
+
+// Commands that have an archive version (archive.h); the rest need the
+// in-memory table.
+static int archive_allows(const char *command, const char *args) {
+    static const char *const plain[] = { "ARCHIVE", "QUERY", "INSERT", "SET", "HISTORY", "EXIT", "QUIT" };
+    if (iequals(command, "UPDATE")) return !starts_with_word(args, "SET");
+    if (iequals(command, "DELETE")) return !starts_with_word(args, "WHERE");
+    if (iequals(command, "SHOW")) return args[0] == '\0' || iequals(args, "ALL") || iequals(args, "SETTINGS");
+    for (size_t i = 0; i < sizeof(plain) / sizeof(plain[0]); ++i) {
+        if (iequals(command, plain[i])) return 1;
+    }
+    return 0;
+}
+
+// Commands a read replica (repl.h) serves; edits come only from its primary.
+static int replica_allows(const char *command) {
+    static const char *const reads[] = { "QUERY", "SHOW", "EXPORT", "HISTORY", "SET", "REPLICATE", "EXIT", "QUIT" };
+    for (size_t i = 0; i < sizeof(reads) / sizeof(reads[0]); ++i) {
+        if (iequals(command, reads[i])) return 1;
+    }
+    return 0;
+}
+
+static void archive_io_error(const char *what) {
+    printf("CMS: ERROR: Reading or writing the archive \"%s\" failed.\n", archivePath());
+    char msg[HISTORY_DESC_LEN];
+    snprintf(msg, sizeof(msg), "%s: Failed - archive I/O error", what);
+    addHistory(msg);
+}
+
+// The table was just loaded from or saved to the database file: WATCH
+// carries on from there, or stops when the file is no longer plain text.
+static void rebase_watch(void) {
+    if (loadedBytes() >= 0) {
+        watchRebase(loadedBytes());
+    } else if (watchActive()) {
+        watchStop();
+        printf("CMS: WATCH stopped; the database file is no longer a single text file.\n");
+    }
+}
+
 // Print single record in a simple format
 static void print_record(const StudentRecord *r) {
     if (!r) return;
-    printf("%d %s %s %.1f\n", r->id, r->name, r->programme, r->mark);
+    char mark[MARK_BUF_LEN];
+    printf("%d %s %s %s\n", r->id, recordName(r), programmeName(r->prog), formatMark(r->mark, mark));
 }
 
 // extract_input helper function to take inputs without quotes
@@ -151,14 +216,65 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
         trim(local_args);
     }
 
+    // OPEN and SAVE would replace or persist half a transaction
+    if (txnActive() && (iequals(command, "OPEN") || iequals(command, "SAVE") || iequals(command, "ARCHIVE") ||
+                        iequals(command, "REPLICATE"))) {
+        printf("CMS: A transaction is open. COMMIT or ROLLBACK before %s.\n", command);
+        return 1;
+    }
+
+    // with an archive open, commands that only know the in-memory table are refused
+    if (archiveIsOpen() && !archive_allows(command, local_args)) {
+        printf("CMS: %s does not work on an archive. Use ARCHIVE CLOSE first.\n", command);
+        return 1;
+    }
+
+    // a read replica only changes through its primary
+    if (replRole() == REPL_FOLLOWER && !replica_allows(command)) {
+        printf("CMS: This session is a read replica; %s is refused. Use REPLICATE STOP first.\n", command);
+        return 1;
+    }
+
+    // OPEN SNAPSHOT <file>: load a compressed snapshot instead of the text file
+    if (iequals(command, "OPEN") && starts_with_word(local_args, "SNAPSHOT")) {
+        char *file = trim(local_args + 8);
+        char msg[HISTORY_DESC_LEN];
+        if (loadDB(file, records, count) == 1) {
+            printf("CMS: The snapshot \"%s\" is successfully opened (%d records).\n", file, *count);
+            db_opened = 1;
+            if (watchActive()) {
+                watchStop();
+                printf("CMS: WATCH stopped; the table no longer comes from the database file.\n");
+            }
+            snprintf(msg, sizeof(msg), "OPEN: Opened snapshot %.100s", file);
+        } else {
+            printf("CMS: ERROR: The snapshot \"%s\" failed to open.\n", file);
+            db_opened = 0;
+            snprintf(msg, sizeof(msg), "OPEN: Failed to open snapshot %.100s", file);
+        }
+        addHistory(msg);
+        return 1;
+    }
+
     // OPEN 
     if (iequals(command, "OPEN")) {
         const char* file = default_filename && *default_filename ? default_filename : "P5_4-CMS.txt";
         int rc = loadDB(file, records, count);
         if (rc == 1) {
             printf("CMS: The database file \"%s\" is successfully opened.\n", file);
+            if (shardedAt(file)) printf("CMS: Read %d shard file(s) (%d records).\n", shardCount(), *count);
             db_opened = 1;
             addHistory("OPEN: Opened database file");
+            rebase_watch();
+
+            // re-apply transactions committed since the last SAVE
+            int replayed = replayJournal(file, records, count);
+            if (replayed > 0) {
+                printf("CMS: Recovered %d committed change(s) from the journal.\n", replayed);
+                addHistory("OPEN: Replayed committed journal entries");
+            } else if (replayed < 0) {
+                printf("CMS: WARNING: The journal could not be replayed (out of memory).\n");
+            }
         }
         else { 
             printf("CMS: ERROR: The database file \"%s\" failed to open.\n", file);
@@ -170,16 +286,54 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
         return 1;
     }
 
-    // SAVE 
+    // SAVE SNAPSHOT <file>: write the table as a compressed snapshot
+    if (iequals(command, "SAVE") && starts_with_word(local_args, "SNAPSHOT")) {
+        char *file = trim(local_args + 8);
+        char msg[HISTORY_DESC_LEN];
+        long bytes = 0;
+        if (saveSnapshot(file, records, *count, &bytes)) {
+            printf("CMS: The snapshot \"%s\" is successfully saved (%d records, %ld bytes).\n", file, *count, bytes);
+            snprintf(msg, sizeof(msg), "SAVE: Saved snapshot %.100s", file);
+        } else {
+            snprintf(msg, sizeof(msg), "SAVE: Failed to save snapshot %.100s", file);
+        }
+        addHistory(msg);
+        return 1;
+    }
+
+    // SAVE | SAVE SHARDED | SAVE UNSHARDED
     if (iequals(command, "SAVE")) {
         // Ignore any filename supplied by user; always use default_filename
         const char* file = default_filename && *default_filename ? default_filename : "P5_4-CMS.txt";
+        // SHARDED turns the file into a manifest of per-ID-range shard files
+        // from now on; UNSHARDED writes it back as one file
+        int was_sharded = shardedAt(file);
+        int to_shards = iequals(local_args, "SHARDED");
+        int to_single = iequals(local_args, "UNSHARDED");
+        if (to_single && !was_sharded) {
+            printf("CMS: The database file \"%s\" is not sharded.\n", file);
+            return 1;
+        }
+        if (to_shards && !was_sharded) shardAttach(file);
+        if (to_single) shardDetach();
+        // write names out of a freshly compacted arena
+        compactNames(records, *count);
         int rc = saveDB(file, records, *count);
         if (rc == 1) {
+            clearJournal(file); // the file now holds every committed change
+            if (to_single) removeShardFiles(file);
+            rebase_watch();
             printf("CMS: The database file \"%s\" is successfully saved.\n", file);
-            addHistory("SAVE: Saved database file");
+            if (shardedAt(file)) {
+                printf("CMS: %d of %d shard file(s) rewritten.\n", shardsWritten(), shardCount());
+                addHistory(was_sharded ? "SAVE: Saved changed shards" : "SAVE: Saved database as shards");
+            } else {
+                addHistory("SAVE: Saved database file");
+            }
         }
         else {
+            if (to_shards && !was_sharded) shardDetach();
+            if (to_single) shardAttach(file);   // the next SAVE writes every shard again
             printf("CMS: ERROR: SAVE unsuccessful for '%s'.\n", file);
             char msg[HISTORY_DESC_LEN];
             snprintf(msg, sizeof(msg), "SAVE: Failed to save %s", file);
@@ -211,12 +365,12 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
 
         // Allocate size for each input
         char idstr[32] = {0};
-        char namestr[STRING_LEN] = {0};
+        char namestr[sizeof(input)] = {0};
         char progstr[STRING_LEN] = {0};
         char markstr[32] = {0};
 
-        // Check ID for duplicates first
-        if (input_id) {
+        // Check ID for duplicates first; with an archive open, archiveInsert decides
+        if (input_id && !archiveIsOpen()) {
             extract_input(input, starting_len, index_id,
                           index_id, index_name, index_prog, index_mark,
                           (int)strlen("ID="), sizeof(idstr), idstr);
@@ -267,36 +421,60 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
 
         // Parse numeric values
         int id = 0;
-        float mark = 0.0f;
+        int mark = 0;
         if (sscanf(idstr, "%d", &id) != 1) {
             printf("CMS: Invalid ID value.\n");
             addHistory("INSERT Failed - invalid ID value");
             return 1;
         }
-        if (sscanf(markstr, "%f", &mark) != 1) {
+        // Parse into exact tenths (rounds to 1 decimal point)
+        if (!parseMark(markstr, &mark)) {
             printf("CMS: Invalid Mark value. Mark must be a number.\n");
             addHistory("INSERT Failed - invalid Mark value.");
             return 1;
         }
-        // Round to 1 decimal point
-        mark = round(mark * 10) / 10.0;
         // Marks only between 0.0 and 100.0
-        if (mark < 0.0f || mark > 100.0f) {
+        if (mark < MARK_MIN || mark > MARK_MAX) {
             printf("CMS: Mark must be between 0.0 and 100.0.\n");
             addHistory("INSERT: Failed - mark out of range");
             return 1;
         }
 
+        if (archiveIsOpen()) {
+            int rc = archiveInsert(id, namestr, progstr, mark);
+            char msg[HISTORY_DESC_LEN];
+            if (rc < 0) {
+                archive_io_error("INSERT");
+            } else if (rc == 0) {
+                snprintf(msg, sizeof(msg), "INSERT: Failed for ID=%d in archive", id);
+                addHistory(msg);
+            } else {
+                printf("INSERT successful (ID %d).\n", id);
+                snprintf(msg, sizeof(msg), "INSERT: Inserted record ID=%d into archive", id);
+                addHistory(msg);
+            }
+            return 1;
+        }
+
         // Turn values into StudentRecord for database
         StudentRecord sr;
         sr.id = id;
-        strncpy(sr.name, namestr, STRING_LEN - 1);
-        sr.name[STRING_LEN - 1] = '\0';
-        strncpy(sr.programme, progstr, STRING_LEN - 1);
-        sr.programme[STRING_LEN - 1] = '\0';
-        sr.mark = mark;
+        int prog = internProgramme(progstr);
+        if (prog < 0) {
+            printf("CMS: Too many distinct programmes. INSERT cancelled.\n");
+            addHistory("INSERT: Failed - programme dictionary full");
+            return 1;
+        }
+        sr.prog = (uint16_t)prog;
+        sr.mark = (int16_t)mark;
+        if (!storeRecordName(&sr, namestr)) {
+            printf("CMS: Out of memory. INSERT cancelled.\n");
+            addHistory("INSERT: Failed - out of memory");
+            return 1;
+        }
 
         if (!insertRecord(records, count, &sr)) {
+            releaseRecordName(&sr);
             char msg[HISTORY_DESC_LEN];
             addHistory(msg);
         } else {
@@ -316,13 +494,148 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
             addHistory("IMPORT: Failed - no DB opened");
             return 1;
         }
-        //return importRecords(local_args, records, count);
+        return importRecords(local_args, records, count);
+    }
+
+    // ARCHIVE CREATE <file> | ARCHIVE OPEN <file> | ARCHIVE CLOSE | ARCHIVE STATUS
+    if (iequals(command, "ARCHIVE")) {
+        char verb[16] = { 0 };
+        int used = 0;
+        sscanf(local_args, "%15s%n", verb, &used);
+        char *file = trim(local_args + used);
+        char msg[HISTORY_DESC_LEN];
+
+        if (iequals(verb, "CREATE") && *file) {
+            if (!db_opened) {
+                printf("CMS: No database opened. Use OPEN before ARCHIVE CREATE.\n");
+                addHistory("ARCHIVE: Failed - no DB opened");
+                return 1;
+            }
+            if (archiveIsOpen() && strcmp(file, archivePath()) == 0) {
+                printf("CMS: \"%s\" is the open archive. Use ARCHIVE CLOSE first.\n", file);
+                return 1;
+            }
+            int n = archiveCreate(file, records, *count);
+            if (n >= 0) {
+                printf("CMS: Archive \"%s\" created with %d record(s).\n", file, n);
+                snprintf(msg, sizeof(msg), "ARCHIVE: Created %.100s with %d record(s)", file, n);
+            } else {
+                snprintf(msg, sizeof(msg), "ARCHIVE: Failed to create %.100s", file);
+            }
+            addHistory(msg);
+            return 1;
+        }
+        if (iequals(verb, "OPEN") && *file) {
+            if (archiveOpen(file)) {
+                printf("CMS: Archive \"%s\" opened. QUERY, INSERT, UPDATE, DELETE and SHOW ALL now use it.\n", file);
+                snprintf(msg, sizeof(msg), "ARCHIVE: Opened %.100s", file);
+            } else {
+                snprintf(msg, sizeof(msg), "ARCHIVE: Failed to open %.100s", file);
+            }
+            addHistory(msg);
+            return 1;
+        }
+        if (iequals(verb, "CLOSE") && !*file) {
+            if (!archiveIsOpen()) {
+                printf("CMS: No archive is open.\n");
+                return 1;
+            }
+            char closing[256];
+            snprintf(closing, sizeof(closing), "%s", archivePath());
+            if (archiveClose()) {
+                printf("CMS: Archive \"%s\" closed. Commands use the in-memory table again.\n", closing);
+                addHistory("ARCHIVE: Closed archive");
+            } else {
+                printf("CMS: ERROR: Archive \"%s\" closed, but some changes could not be written.\n", closing);
+                addHistory("ARCHIVE: Failed - changes lost on close");
+            }
+            return 1;
+        }
+        if (iequals(verb, "STATUS") && !*file) {
+            archiveStatus();
+            return 1;
+        }
+        printf("CMS: ERROR: Use ARCHIVE CREATE <file>, ARCHIVE OPEN <file>, ARCHIVE CLOSE or ARCHIVE STATUS.\n");
+        addHistory("ARCHIVE: Failed - invalid format");
+        return 1;
+    }
+
+    // EXPORT <file.csv> | EXPORT COLUMNAR <file>
+    if (iequals(command, "EXPORT")) {
+        char msg[HISTORY_DESC_LEN];
+        int columnar = starts_with_word(local_args, "COLUMNAR");
+        char *file = trim(columnar ? local_args + 8 : local_args);
+        if (!*file) {
+            printf("CMS: ERROR: Use EXPORT <file.csv> or EXPORT COLUMNAR <file>.\n");
+            addHistory("EXPORT: Failed - invalid format");
+            return 1;
+        }
+        if (!db_opened) {
+            printf("CMS: No database opened. Use OPEN before EXPORT.\n");
+            addHistory("EXPORT: Failed - no DB opened");
+            return 1;
+        }
+        int n = columnar ? exportColumnar(file, records, *count)
+                         : exportCsv(file, records, *count);
+        if (n >= 0 && columnar) {
+            printf("CMS: Exported %d record(s) to \"%s\" in columnar format.\n", n, file);
+            snprintf(msg, sizeof(msg), "EXPORT: Columnar export of %d record(s) to %.80s", n, file);
+        } else if (n >= 0) {
+            printf("CMS: Exported %d record(s) to \"%s\".\n", n, file);
+            snprintf(msg, sizeof(msg), "EXPORT: Exported %d record(s) to %.80s", n, file);
+        } else {
+            snprintf(msg, sizeof(msg), "EXPORT: Failed to export %.100s", file);
+        }
+        addHistory(msg);
+        return 1;
     }
 
         // QUERY
        // Uses ID to search for record
     if (iequals(command, "QUERY")) {
 
+        // QUERY COLUMNAR <file> WHERE <condition>
+        if (starts_with_word(local_args, "COLUMNAR")) {
+            const char *where = findKeyword(local_args, "WHERE");
+            if (!where) {
+                printf("CMS: ERROR: Use QUERY COLUMNAR <file> WHERE <condition>.\n");
+                addHistory("QUERY: Failed - columnar query without WHERE");
+                return 1;
+            }
+            char file[256];
+            int len = (int)(where - (local_args + 8));
+            snprintf(file, sizeof(file), "%.*s", len, local_args + 8);
+            int n = queryColumnar(trim(file), where + 5);
+            char msg[HISTORY_DESC_LEN];
+            if (n >= 0) snprintf(msg, sizeof(msg), "QUERY: Matched %d record(s) in columnar %.100s", n, trim(file));
+            else snprintf(msg, sizeof(msg), "QUERY: Failed columnar query on %.100s", trim(file));
+            addHistory(msg);
+            return 1;
+        }
+
+        // QUERY ID BETWEEN <low> AND <high>
+        {
+            char w1[16] = { 0 }, w2[16] = { 0 }, w3[16] = { 0 }, extra[2] = { 0 };
+            int lo = 0, hi = 0;
+            int got = sscanf(local_args, "%15s %15s %d %15s %d %1s", w1, w2, &lo, w3, &hi, extra);
+            if (got >= 2 && iequals(w1, "ID") && iequals(w2, "BETWEEN")) {
+                if (got != 5 || !iequals(w3, "AND") || lo > hi) {
+                    printf("CMS: ERROR: Invalid QUERY range. Use: QUERY ID BETWEEN <low> AND <high>\n");
+                    addHistory("QUERY: Failed - invalid range");
+                    return 1;
+                }
+                int shown = archiveIsOpen() ? archiveShowRange(lo, hi) : showRecordsInRange(records, *count, lo, hi);
+                if (shown < 0) {
+                    archive_io_error("QUERY");
+                    return 1;
+                }
+                char msg[HISTORY_DESC_LEN];
+                snprintf(msg, sizeof(msg), "QUERY: Found %d record(s) with ID between %d and %d", shown, lo, hi);
+                addHistory(msg);
+                return 1;
+            }
+        }
+
         char buf[256];
         strncpy(buf, local_args, sizeof(buf) - 1);
         buf[sizeof(buf) - 1] = '\0';
@@ -342,7 +655,11 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
         }
         if (id_str) {
             int id = atoi(id_str + 3);
-            int found = queryRecord(records, *count, id);
+            int found = archiveIsOpen() ? archiveQuery(id) : queryRecord(records, *count, id);
+            if (found < 0) {
+                archive_io_error("QUERY");
+                return 1;
+            }
 
             // Add to history - track both successful and failed queries
             if (found) {
@@ -363,8 +680,12 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
         return 1;
     }
 
-   // UPDATE ID= <ID> FIELD =<VALUE>
+   // UPDATE ID= <ID> FIELD =<VALUE> | UPDATE SET <Field>=<value>[, ...] WHERE <condition>
     if (iequals(command, "UPDATE")) {
+
+    if (starts_with_word(local_args, "SET")) {
+        return bulkUpdate(local_args, records, count);
+    }
     
     size_t slen = strlen(local_args);
 
@@ -409,7 +730,7 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
 
     // buffers for extracted values
     char id_buf[32] = {0};
-    char name_buf[128] = {0};
+    char name_buf[256] = {0};
     char prog_buf[64] = {0};
     char mark_buf[32] = {0};
 
@@ -459,7 +780,7 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
 
     // Validate that Mark is not empty, contains only numeric input, is within 0–100, and is rounded to one decimal place.
     if (idx_mark != -1) {
-        float m;
+        int m;
         if (mark_buf[0] == '\0') {
             printf("CMS: Mark field is empty. Use: UPDATE ID=<id> Mark=<mark>\n");
             char msg[HISTORY_DESC_LEN]; 
@@ -468,7 +789,7 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
             return 1;
         }
 
-        if (sscanf(mark_buf, "%f", &m) != 1) {
+        if (!parseMark(mark_buf, &m)) {
             printf("CMS: Invalid Mark type. Mark must be a number\n");
             char msg[HISTORY_DESC_LEN]; 
             snprintf(msg, sizeof(msg), "UPDATE: Failed - invalid mark for ID=%d", id); 
@@ -476,7 +797,7 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
             return 1;
         }
 
-        if (m < 0 || m > 100) {
+        if (m < MARK_MIN || m > MARK_MAX) {
             printf("CMS: Mark must be between 0.0 and 100.0\n");
             char msg[HISTORY_DESC_LEN]; 
             snprintf(msg, sizeof(msg), "UPDATE: Failed - mark out of range for ID=%d", id); 
@@ -484,16 +805,13 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
             return 1;
         }
 
-        // round marks to 1D.P
-        m = round(m * 10) / 10.0;
-        idx_mark = m;
         char msg[HISTORY_DESC_LEN]; 
         snprintf(msg, sizeof(msg), "UPDATE: Updated Mark for ID=%d", id); 
         addHistory(msg);
     }
 
     char fieldType[32];
-    char valueBuf[128];
+    char valueBuf[256];
 
     if (idx_name != -1) {
         strcpy(fieldType, "Name");
@@ -508,14 +826,21 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
         strcpy(valueBuf, mark_buf);
     }
 
-    updateRecord(records, count, id, fieldType, valueBuf);
+    if (!archiveIsOpen()) {
+        updateRecord(records, count, id, fieldType, valueBuf);
+    } else if (archiveUpdate(id, fieldType, valueBuf) < 0) {
+        archive_io_error("UPDATE");
+    }
 
     return 1;
 }
 
 
-    // DELETE ID
+    // DELETE ID | DELETE WHERE <condition>
     if (iequals(command, "DELETE")) {
+            if (starts_with_word(local_args, "WHERE")) {
+                return bulkDelete(local_args, records, count);
+            }
             char buf[256]; 
             strncpy(buf, local_args, sizeof(buf) - 1);
             buf[sizeof(buf) - 1] = '\0';
@@ -537,8 +862,13 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
             }
             int id = atoi(p + 3);
 
-            int idx = findRecordById(records, *count, id);
-            if (idx == -1) {
+            int idx = archiveIsOpen() ? -1 : findRecordById(records, *count, id);
+            int exists = archiveIsOpen() ? archiveContains(id) : idx != -1;
+            if (exists < 0) {
+                archive_io_error("DELETE");
+                return 1;
+            }
+            if (!exists) {
                 printf("CMS: The record with ID=%d does not exist.\n", id);
                 char msg[HISTORY_DESC_LEN]; 
                 snprintf(msg, sizeof(msg), "DELETE: Attempted delete ID=%d (not found)", id); 
@@ -574,8 +904,12 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
                     }
 #else
         // Fallback delete logic if your build doesn't have HAVE_DELETE_RECORD
-            for (int i = idx; i + 1 < *count; ++i) records[i] = records[i + 1];
-            (*count)--;
+            if (!archiveIsOpen()) {
+                removeRow(records, count, idx);
+            } else if (archiveDelete(id) < 0) {
+                archive_io_error("DELETE");
+                return 1;
+            }
             printf("CMS: The record with ID=%d is successfully deleted.\n", id);
             char msg[HISTORY_DESC_LEN];
             snprintf(msg, sizeof(msg), "DELETE: Deleted record ID=%d", id);
@@ -591,7 +925,7 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
     }
 
 
-        // SHOW ALL | SHOW ALL SORT BY ID | SHOW ALL SORT BY MARK | SHOW SUMMARY
+        // SHOW ALL | SHOW ALL SORT BY ID | SHOW ALL SORT BY MARK | SHOW TOP <k> BY ID|MARK | SHOW SUMMARY
         if (iequals(command, "SHOW")) {
             // copy and trim arguments
             char buf[128];
@@ -601,11 +935,34 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
 
             // SHOW or SHOW ALL
             if (buf[0] == '\0' || iequals(buf, "ALL")) {
-                showAllRecords(records, *count);
+                if (!archiveIsOpen()) {
+                    showAllRecords(records, *count);
+                } else if (archiveShowAll() < 0) {
+                    archive_io_error("SHOW ALL");
+                    return 1;
+                }
                 addHistory("SHOW ALL: Displayed all records");
                 return 1;
             }
 
+            // SHOW SETTINGS
+            if (iequals(buf, "SETTINGS")) {
+                showSettings();
+                return 1;
+            }
+
+            // SHOW FILTER: the ID filter in front of the table's index
+            if (iequals(buf, "FILTER")) {
+                showIdFilter();
+                return 1;
+            }
+
+            // SHOW MEMORY: scratch arena and record pool statistics
+            if (iequals(buf, "MEMORY")) {
+                showMemory();
+                return 1;
+            }
+
             // SHOW SUMMARY
             if (iequals(buf, "SUMMARY")) {
                 showSummary(records, *count);
@@ -613,34 +970,102 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
                 return 1;
             }
 
+            // SHOW DISTRIBUTION [file.csv]
+            {
+                char word[16] = { 0 };
+                int used = 0;
+                if (sscanf(buf, "%15s%n", word, &used) == 1 && iequals(word, "DISTRIBUTION")) {
+                    char *file = trim(buf + used);
+                    if (*file == '\0') {
+                        showDistribution(records, *count);
+                        addHistory("SHOW DISTRIBUTION: Displayed distribution");
+                    } else {
+                        csvDistribution(file);
+                        addHistory("SHOW DISTRIBUTION: Displayed CSV distribution");
+                    }
+                    return 1;
+                }
+            }
+
+            // SHOW SUMMARY BY PROGRAMME [SORT BY <column> [ASC|DESC]]
+            {
+                char g[7][16] = { { 0 } };
+                int gn = sscanf(buf, "%15s %15s %15s %15s %15s %15s %15s", g[0], g[1], g[2], g[3], g[4], g[5], g[6]);
+                if (gn >= 3 && iequals(g[0], "SUMMARY") && iequals(g[1], "BY") && iequals(g[2], "PROGRAMME")) {
+                    int col = GROUP_COL_PROGRAMME;
+                    int asc = 1;
+                    if (gn > 3) {
+                        if (gn < 6 || !iequals(g[3], "SORT") || !iequals(g[4], "BY") ||
+                            (col = groupColumnFromName(g[5])) < 0) {
+                            printf("CMS: ERROR: Use SHOW SUMMARY BY PROGRAMME [SORT BY PROGRAMME|COUNT|AVG|MIN|MAX|PASSRATE [ASC|DESC]].\n");
+                            addHistory("SHOW SUMMARY: Failed - invalid BY PROGRAMME options");
+                            return 1;
+                        }
+                        if (gn == 7) {
+                            if (iequals(g[6], "DESC")) asc = 0;
+                            else if (!iequals(g[6], "ASC")) {
+                                printf("CMS: ERROR: Unknown sort order '%s'. Use ASC or DESC.\n", g[6]);
+                                addHistory("SHOW SUMMARY: Failed - invalid sort order");
+                                return 1;
+                            }
+                        }
+                    }
+                    showSummaryByProgramme(records, *count, (GroupColumn)col, asc);
+                    addHistory("SHOW SUMMARY: Displayed summary by programme");
+                    return 1;
+                }
+            }
+
             // parse into up to 5 tokens
             char t1[16] = { 0 }, t2[16] = { 0 }, t3[16] = { 0 }, t4[16] = { 0 }, t5[16] = { 0 };
             int n = sscanf(buf, "%15s %15s %15s %15s %15s", t1, t2, t3, t4, t5);
 
-            // expect: ALL SORT BY <FIELD> [ORDER]
-            if (n >= 4 && iequals(t1, "ALL") && iequals(t2, "SORT") && iequals(t3, "BY")) {
-                char* field = t4;
-                char* order = (n >= 5) ? t5 : NULL;
-
-                if (!iequals(field, "ID") && !iequals(field, "MARK")) {
-                    printf("CMS: ERROR: Invalid SHOW SORT field '%s'. Use ID or MARK.\n", field);
-                    addHistory("SHOW: Failed - invalid sort field");
+            // expect: TOP <K> BY <FIELD> [ORDER]  (order defaults to DESC)
+            if (n >= 4 && iequals(t1, "TOP") && iequals(t3, "BY")) {
+                char *end = NULL;
+                long k = strtol(t2, &end, 10);
+                if (end == t2 || *end != '\0' || k <= 0 || k > MAX_RECORDS) {
+                    printf("CMS: ERROR: Invalid TOP count '%s'. Use a positive whole number.\n", t2);
+                    addHistory("SHOW: Failed - invalid TOP count");
+                    return 1;
+                }
+                if (!iequals(t4, "ID") && !iequals(t4, "MARK")) {
+                    printf("CMS: ERROR: Invalid SHOW TOP field '%s'. Use ID or MARK.\n", t4);
+                    addHistory("SHOW: Failed - invalid TOP field");
                     return 1;
                 }
 
-                int by_id = iequals(field, "ID") ? 1 : 0;
-                int asc = 1; // default ascending
-                if (order) {
-                    if (iequals(order, "DESC")) asc = 0;
-                    else if (iequals(order, "ASC")) asc = 1;
-                    else {
-                        printf("CMS: ERROR: Unknown sort order '%s'. Use ASC or DESC.\n", order);
+                int asc = 0; // "top" means highest first unless ASC is given
+                if (n >= 5) {
+                    if (iequals(t5, "ASC")) asc = 1;
+                    else if (!iequals(t5, "DESC")) {
+                        printf("CMS: ERROR: Unknown sort order '%s'. Use ASC or DESC.\n", t5);
                         addHistory("SHOW: Failed - invalid sort order");
                         return 1;
                     }
                 }
 
-                sort_and_print(records, *count, by_id, asc);
+                top_k_and_print(records, *count, (int)k, iequals(t4, "ID"), asc);
+                char msg[HISTORY_DESC_LEN];
+                snprintf(msg, sizeof(msg), "SHOW TOP: Displayed top %ld records", k);
+                addHistory(msg);
+                return 1;
+            }
+
+            // expect: ALL SORT BY <FIELD> [ORDER] [, <FIELD> [ORDER]]...
+            if (n >= 4 && iequals(t1, "ALL") && iequals(t2, "SORT") && iequals(t3, "BY")) {
+                int keys_at = 0;
+                sscanf(buf, "%*s %*s %*s %n", &keys_at);
+
+                SortSpec spec;
+                char err[96];
+                if (!parseSortSpec(buf + keys_at, &spec, err, sizeof(err))) {
+                    printf("CMS: ERROR: Invalid SHOW SORT: %s.\n", err);
+                    addHistory("SHOW: Failed - invalid sort keys");
+                    return 1;
+                }
+
+                sort_by_spec_and_print(records, *count, &spec);
                 addHistory("SHOW ALL SORT: Displayed sorted records");
                 return 1;
             }
@@ -650,6 +1075,151 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
             return 1;
         }
 
+        // SET <setting> <value>
+        if (iequals(command, "SET")) {
+            if (applySetting(local_args)) {
+                char msg[HISTORY_DESC_LEN];
+                snprintf(msg, sizeof(msg), "SET: %.120s", local_args);
+                addHistory(msg);
+            }
+            return 1;
+        }
+
+        // REPLICATE SERVE <socket> | REPLICATE FOLLOW <socket> | REPLICATE STATUS | REPLICATE STOP
+        if (iequals(command, "REPLICATE")) {
+            char msg[HISTORY_DESC_LEN];
+            int serve = starts_with_word(local_args, "SERVE");
+            int follow = starts_with_word(local_args, "FOLLOW");
+            if (iequals(local_args, "STATUS")) {
+                replStatus();
+                return 1;
+            }
+            if (iequals(local_args, "STOP")) {
+                if (replRole() == REPL_NONE) {
+                    printf("CMS: Replication is off.\n");
+                    return 1;
+                }
+                replStop();
+                printf("CMS: Replication stopped.\n");
+                addHistory("REPLICATE: Stopped");
+                return 1;
+            }
+            char *sock = trim(local_args + (serve ? 5 : follow ? 6 : 0));
+            if (!(serve || follow) || !*sock) {
+                printf("CMS: ERROR: Use REPLICATE SERVE <socket>, REPLICATE FOLLOW <socket>, REPLICATE STATUS or REPLICATE STOP.\n");
+                return 1;
+            }
+            if (replRole() != REPL_NONE) {
+                printf("CMS: Replication is already running. Use REPLICATE STOP first.\n");
+                return 1;
+            }
+            if (serve) {
+                if (!db_opened) {
+                    printf("CMS: No database opened. Use OPEN before REPLICATE SERVE.\n");
+                    return 1;
+                }
+                if (replServe(sock, records, count)) {
+                    printf("CMS: Serving replicas on \"%s\".\n", sock);
+                    snprintf(msg, sizeof(msg), "REPLICATE: Serving on %.100s", sock);
+                    addHistory(msg);
+                }
+                return 1;
+            }
+            if (replFollow(sock, records, count)) {
+                db_opened = 1;  // the primary's table replaces ours
+                if (watchActive()) watchStop();
+                printf("CMS: Following the primary on \"%s\". This session is now read-only.\n", sock);
+                snprintf(msg, sizeof(msg), "REPLICATE: Following %.100s", sock);
+                addHistory(msg);
+            }
+            return 1;
+        }
+
+        // WATCH [ON] | WATCH OFF | WATCH STATUS
+        if (iequals(command, "WATCH")) {
+            const char* file = default_filename && *default_filename ? default_filename : "P5_4-CMS.txt";
+            if (iequals(local_args, "STATUS")) {
+                watchStatus();
+                return 1;
+            }
+            if (iequals(local_args, "OFF")) {
+                if (!watchActive()) {
+                    printf("CMS: WATCH is not on.\n");
+                    return 1;
+                }
+                watchStop();
+                printf("CMS: Stopped watching \"%s\".\n", file);
+                addHistory("WATCH: Stopped");
+                return 1;
+            }
+            if (local_args[0] != '\0' && !iequals(local_args, "ON")) {
+                printf("CMS: ERROR: Use WATCH, WATCH OFF or WATCH STATUS.\n");
+                return 1;
+            }
+            if (shardedAt(file)) {
+                printf("CMS: WATCH follows a single text file; \"%s\" is sharded.\n", file);
+                return 1;
+            }
+            if (!db_opened || loadedBytes() < 0) {
+                printf("CMS: Open the database file with OPEN before WATCH.\n");
+                addHistory("WATCH: Failed - no DB opened");
+                return 1;
+            }
+            if (watchStart(file, loadedBytes())) {
+                printf("CMS: Watching \"%s\"; rows other programs append are loaded before each command.\n", file);
+                addHistory("WATCH: Started");
+            }
+            return 1;
+        }
+
+        // BEGIN / COMMIT / ROLLBACK
+        if (iequals(command, "BEGIN")) {
+            if (!db_opened) {
+                printf("CMS: No database opened. Use OPEN before BEGIN.\n");
+                return 1;
+            }
+            if (!txnBegin()) {
+                printf("CMS: A transaction is already open.\n");
+                return 1;
+            }
+            printf("CMS: Transaction started. Use COMMIT to persist or ROLLBACK to undo.\n");
+            addHistory("BEGIN: Started transaction");
+            return 1;
+        }
+
+        if (iequals(command, "COMMIT")) {
+            if (!txnActive()) {
+                printf("CMS: No transaction is open.\n");
+                return 1;
+            }
+            const char* file = default_filename && *default_filename ? default_filename : "P5_4-CMS.txt";
+            int changes = txnChangeCount();
+            char msg[HISTORY_DESC_LEN];
+            if (txnCommit(file)) {
+                printf("CMS: Transaction committed (%d change(s)).\n", changes);
+                snprintf(msg, sizeof(msg), "COMMIT: Committed %d change(s)", changes);
+            } else {
+                printf("CMS: ERROR: COMMIT failed. The transaction is still open.\n");
+                snprintf(msg, sizeof(msg), "COMMIT: Failed (%d change(s) pending)", changes);
+            }
+            addHistory(msg);
+            return 1;
+        }
+
+        if (iequals(command, "ROLLBACK")) {
+            if (!txnActive()) {
+                printf("CMS: No transaction is open.\n");
+                return 1;
+            }
+            int changes = txnChangeCount();
+            txnRollback(records, count);
+            printf("CMS: Transaction rolled back (%d change(s) undone).\n", changes);
+            char msg[HISTORY_DESC_LEN];
+            snprintf(msg, sizeof(msg), "ROLLBACK: Undid %d change(s)", changes);
+            addHistory(msg);
+            return 1;
+        }
+
         // HISTORY
         // Show last 20 (max)
         if (iequals(command, "HISTORY")) {
@@ -666,6 +1236,7 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
         // EXIT / QUIT
         if (iequals(command, "EXIT") || iequals(command, "QUIT")) {
             printf("DEBUG: Checking EXIT/QUIT. Command is: '%s'\n", command);
+            if (txnActive()) printf("CMS: The open transaction was not committed and is discarded.\n");
             printf("CMS: Program exiting.\n");
             char msg[HISTORY_DESC_LEN]; snprintf(msg, sizeof(msg), "EXIT: Program exited");
             addHistory(msg);
@@ -683,7 +1254,7 @@ int processCommand(const char *command, char *args, StudentRecord records[], int
 
 
 int main(void) {
-    StudentRecord records[MAX_RECORDS];
+    static StudentRecord records[MAX_RECORDS]; // static: far too big for the stack
     int record_count = 0;
     const char *filename = "P5_4-CMS.txt"; // default DB filename
 
@@ -723,10 +1294,34 @@ int main(void) {
         // If user entered empty line, continue
         if (command[0] == '\0') continue;
 
+        // the replication thread (repl.h) waits while a command runs
+        replLock();
+
+        // pick up rows appended to the database file since the last command
+        watchPoll(records, &record_count);
+
         // Dispatch command. processCommand returns 0 to exit, 1 to continue.
         running = processCommand(command, arguments, records, &record_count, filename);
+
+        // Reclaim name arena space once updates/deletes have left it mostly garbage.
+        // Not inside a transaction: its undo log still points at the old names.
+        if (!txnActive() && namesFragmented()) compactNames(records, record_count);
+
+        // send this command's edits to any read replicas
+        replShip();
+
+        // everything the command took from the scratch arena goes back at once
+        arenaReset();
+        replUnlock();
     }
 
+    // write back whatever the buffer pool still holds
+    if (archiveIsOpen()) archiveClose();
+    watchStop();
+    replLock();
+    replStop();
+    replUnlock();
+
     printf("CMS: Program exiting. If you want to save changes run 'SAVE' before exit next time.\n");
 
     saveHistoryToFile();
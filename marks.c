@@ -0,0 +1,52 @@
+// marks.c parses and formats fixed-point marks (integer tenths).
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "marks.h"
+
+// anything beyond this is far out of range anyway; stop before overflowing
+#define PARSE_LIMIT 100000
+
+int parseMark(const char *text, int *tenths) {
+    if (!text || !tenths) return 0;
+
+    const char *s = text;
+    while (isspace((unsigned char)*s)) s++;
+
+    int negative = 0;
+    if (*s == '+' || *s == '-') negative = (*s++ == '-');
+
+    long whole = 0;
+    int digits = 0;
+    while (isdigit((unsigned char)*s)) {
+        if (whole < PARSE_LIMIT) whole = whole * 10 + (*s - '0');
+        s++;
+        digits++;
+    }
+
+    int tenth = 0, round_up = 0;
+    if (*s == '.') {
+        s++;
+        if (isdigit((unsigned char)*s)) {
+            tenth = *s++ - '0';
+            digits++;
+            if (isdigit((unsigned char)*s)) round_up = (*s - '0') >= 5;
+            while (isdigit((unsigned char)*s)) s++;
+        }
+    }
+
+    while (isspace((unsigned char)*s)) s++;
+    if (digits == 0 || *s != '\0') return 0;
+
+    long value = whole * 10 + tenth + round_up;
+    *tenths = (int)(negative ? -value : value);
+    return 1;
+}
+
+const char *formatMark(int16_t tenths, char buf[MARK_BUF_LEN]) {
+    int magnitude = abs(tenths);
+    snprintf(buf, MARK_BUF_LEN, "%s%d.%d", tenths < 0 ? "-" : "", magnitude / 10, magnitude % 10);
+    return buf;
+}
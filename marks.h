@@ -0,0 +1,26 @@
+#ifndef MARKS_H
+#define MARKS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Marks are stored as integer tenths (85.9 -> 859), so every mark is exact
+// and comparisons, sums and ties are plain integer operations.
+
+#define MARK_MIN 0        // 0.0
+#define MARK_MAX 1000     // 100.0
+#define MARK_PASS 500     // 50.0
+
+// Large enough for "-3276.8" plus the terminator
+#define MARK_BUF_LEN 8
+
+// Parse a decimal mark such as "85", "85.9" or " 85.95 " into tenths,
+// rounding half away from zero on the second decimal digit.
+// Returns 1 on success, 0 if text is not a plain decimal number.
+// The result is not range checked; compare against MARK_MIN/MARK_MAX.
+int parseMark(const char *text, int *tenths);
+
+// Format tenths with exactly one decimal place ("85.9"). Returns buf.
+const char *formatMark(int16_t tenths, char buf[MARK_BUF_LEN]);
+
+#endif
@@ -0,0 +1,97 @@
+// names.c is the string arena backing StudentRecord names.
+// Each name is appended once as <text>\0 and addressed by (offset, length).
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "names.h"
+
+// compaction is only worth it once this many bytes are garbage
+#define COMPACT_MIN_GARBAGE 4096
+
+static char *arena = NULL;
+static size_t arena_used = 0;
+static size_t arena_cap = 0;
+static size_t arena_garbage = 0;
+
+// make sure at least extra more bytes fit
+static int reserve(size_t extra) {
+    if (arena_used + extra <= arena_cap) return 1;
+    size_t new_cap = arena_cap ? arena_cap : 4096;
+    while (new_cap < arena_used + extra) new_cap *= 2;
+    if (new_cap > UINT32_MAX) return 0;   // offsets are 32-bit
+    char *grown = realloc(arena, new_cap);
+    if (!grown) return 0;
+    arena = grown;
+    arena_cap = new_cap;
+    return 1;
+}
+
+int storeRecordName(StudentRecord *r, const char *text) {
+    if (!r || !text) return 0;
+    size_t len = strlen(text);
+    if (len > UINT16_MAX) len = UINT16_MAX;
+    if (!reserve(len + 1)) return 0;
+
+    memcpy(arena + arena_used, text, len);
+    arena[arena_used + len] = '\0';
+    r->name_off = (uint32_t)arena_used;
+    r->name_len = (uint16_t)len;
+    arena_used += len + 1;
+    return 1;
+}
+
+void releaseRecordName(const StudentRecord *r) {
+    if (!r) return;
+    arena_garbage += (size_t)r->name_len + 1;
+    if (arena_garbage > arena_used) arena_garbage = arena_used;
+}
+
+const char *recordName(const StudentRecord *r) {
+    if (!r || !arena || r->name_off >= arena_used) return "";
+    return arena + r->name_off;
+}
+
+void resetNames(void) {
+    arena_used = 0;
+    arena_garbage = 0;
+}
+
+int namesFragmented(void) {
+    return arena_garbage >= COMPACT_MIN_GARBAGE && arena_garbage * 2 >= arena_used;
+}
+
+void compactNames(StudentRecord records[], int count) {
+    if (!records || arena_garbage == 0) return;
+
+    size_t live = 0;
+    for (int i = 0; i < count; ++i) live += (size_t)records[i].name_len + 1;
+
+    size_t new_cap = live > 4096 ? live : 4096;
+    char *fresh = malloc(new_cap);
+    if (!fresh) return;   // keep the fragmented arena; it is still valid
+
+    // copy names in row order so a sequential scan reads the arena sequentially
+    size_t pos = 0;
+    for (int i = 0; i < count; ++i) {
+        size_t n = (size_t)records[i].name_len + 1;
+        memcpy(fresh + pos, arena + records[i].name_off, n);
+        records[i].name_off = (uint32_t)pos;
+        pos += n;
+    }
+
+    free(arena);
+    arena = fresh;
+    arena_cap = new_cap;
+    arena_used = pos;
+    arena_garbage = 0;
+}
+
+size_t namesUsedBytes(void) {
+    return arena_used;
+}
+
+size_t namesGarbageBytes(void) {
+    return arena_garbage;
+}
@@ -0,0 +1,39 @@
+#ifndef NAMES_H
+#define NAMES_H
+
+#include <stddef.h>
+
+#include "records.h"
+
+// Student names live in one append-only string arena. A record only keeps the
+// offset and length of its text, so short names cost a few bytes and long
+// names are not truncated. Overwritten or deleted names become garbage until
+// compactNames() rewrites the arena.
+//
+// Pointers returned by recordName() are only valid until the next store,
+// because the arena may move when it grows.
+
+// Copy text into the arena and point r at it. Returns 0 when out of memory.
+// Does not release whatever r pointed at before (see releaseRecordName).
+int storeRecordName(StudentRecord *r, const char *text);
+
+// Mark the bytes used by r's name as garbage.
+void releaseRecordName(const StudentRecord *r);
+
+// NUL-terminated name text for r.
+const char *recordName(const StudentRecord *r);
+
+// Drop every stored name (used before a full reload).
+void resetNames(void);
+
+// Non-zero when enough of the arena is garbage that compaction pays off.
+int namesFragmented(void);
+
+// Rewrite the arena keeping only the names referenced by records[0..count).
+void compactNames(StudentRecord records[], int count);
+
+// Bytes in use (live + garbage) and bytes known to be garbage.
+size_t namesUsedBytes(void);
+size_t namesGarbageBytes(void);
+
+#endif
@@ -0,0 +1,226 @@
+// psort.c - stable merge sort of SortItems, serial or parallel.
+//
+// The parallel path sorts chunks as independent tasks, picks splitters from a
+// sample of the sorted chunks, and merges each splitter range of all chunks
+// as another independent task. Both phases run on the work-stealing pool in
+// threads.c.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "psort.h"
+#include "threads.h"
+#include "arena.h"
+
+#define INSERTION_RUN 32
+#define CHUNKS_PER_WORKER 4
+#define MIN_CHUNK_ROWS 4096
+
+typedef struct {
+    SortTieFn tie;
+    const void *ctx;
+} Order;
+
+static inline int item_less(const SortItem *a, const SortItem *b, const Order *o) {
+    if (a->key != b->key) return a->key < b->key;
+    if (o->tie) {
+        int c = o->tie(a->idx, b->idx, o->ctx);
+        if (c != 0) return c < 0;
+    }
+    return a->idx < b->idx;
+}
+
+static void insertion_sort(SortItem a[], int n, const Order *o) {
+    for (int i = 1; i < n; ++i) {
+        SortItem x = a[i];
+        int j = i;
+        while (j > 0 && item_less(&x, &a[j - 1], o)) {
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = x;
+    }
+}
+
+// merge two sorted runs; on equal items the left run goes first
+static void merge_runs(const SortItem *a, int na, const SortItem *b, int nb, SortItem *out, const Order *o) {
+    int i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (item_less(&b[j], &a[i], o)) out[k++] = b[j++];
+        else out[k++] = a[i++];
+    }
+    memcpy(out + k, a + i, (size_t)(na - i) * sizeof(*a));
+    k += na - i;
+    memcpy(out + k, b + j, (size_t)(nb - j) * sizeof(*b));
+}
+
+// sort a[0..n) using tmp[0..n) as scratch
+static void merge_sort(SortItem a[], SortItem tmp[], int n, const Order *o) {
+    if (n <= INSERTION_RUN) {
+        insertion_sort(a, n, o);
+        return;
+    }
+    int half = n / 2;
+    merge_sort(a, tmp, half, o);
+    merge_sort(a + half, tmp + half, n - half, o);
+    if (!item_less(&a[half], &a[half - 1], o)) return;   // already in order
+    memcpy(tmp, a, (size_t)n * sizeof(*a));
+    merge_runs(tmp, half, tmp + half, n - half, a, o);
+}
+
+// first position in a[0..n) whose item comes after x
+static int upper_bound(const SortItem a[], int n, const SortItem *x, const Order *o) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (item_less(x, &a[mid], o)) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+typedef struct {
+    SortItem *items;
+    SortItem *tmp;
+    int n;
+    int nchunks;
+    int *chunk_start;   // nchunks + 1 entries
+    int *cut;           // (nchunks + 1) x nchunks: start of each range in each chunk
+    int *out_start;     // nchunks + 1 entries: where each range lands in tmp
+    int *heap_space;    // 3 x nchunks ints per range for the k-way merge
+    Order order;
+} ParallelSort;
+
+static void sort_chunk_task(void *p, int c) {
+    ParallelSort *ps = p;
+    int begin = ps->chunk_start[c], end = ps->chunk_start[c + 1];
+    merge_sort(ps->items + begin, ps->tmp + begin, end - begin, &ps->order);
+}
+
+// k-way merge of range r of every chunk into tmp, using a small heap of chunk heads
+static void merge_range_task(void *p, int r) {
+    ParallelSort *ps = p;
+    int k = ps->nchunks;
+    int *pos = ps->heap_space + (size_t)r * 3 * k;
+    int *end = pos + k, *heap = pos + 2 * k;
+    SortItem *out = ps->tmp + ps->out_start[r];
+
+    int size = 0;
+    for (int c = 0; c < k; ++c) {
+        pos[c] = ps->cut[(size_t)r * k + c];
+        end[c] = ps->cut[(size_t)(r + 1) * k + c];
+        if (pos[c] < end[c]) heap[size++] = c;
+    }
+    const SortItem *it = ps->items;
+    const Order *o = &ps->order;
+
+    // heapify on the current head of each chunk
+    for (int i = size / 2 - 1; i >= 0; --i) {
+        for (int j = i;;) {
+            int m = j, l = 2 * j + 1, rr = l + 1;
+            if (l < size && item_less(&it[pos[heap[l]]], &it[pos[heap[m]]], o)) m = l;
+            if (rr < size && item_less(&it[pos[heap[rr]]], &it[pos[heap[m]]], o)) m = rr;
+            if (m == j) break;
+            int t = heap[j]; heap[j] = heap[m]; heap[m] = t;
+            j = m;
+        }
+    }
+
+    int w = 0;
+    while (size > 0) {
+        int c = heap[0];
+        out[w++] = it[pos[c]++];
+        if (pos[c] == end[c]) heap[0] = heap[--size];
+        for (int j = 0;;) {
+            int m = j, l = 2 * j + 1, rr = l + 1;
+            if (l < size && item_less(&it[pos[heap[l]]], &it[pos[heap[m]]], o)) m = l;
+            if (rr < size && item_less(&it[pos[heap[rr]]], &it[pos[heap[m]]], o)) m = rr;
+            if (m == j) break;
+            int t = heap[j]; heap[j] = heap[m]; heap[m] = t;
+            j = m;
+        }
+    }
+}
+
+static void copy_back_task(void *p, int r) {
+    ParallelSort *ps = p;
+    int begin = ps->out_start[r], end = ps->out_start[r + 1];
+    memcpy(ps->items + begin, ps->tmp + begin, (size_t)(end - begin) * sizeof(*ps->items));
+}
+
+static int parallel_sort(SortItem items[], SortItem tmp[], int n, int nworkers, const Order *o) {
+    int nchunks = nworkers * CHUNKS_PER_WORKER;
+    if (nchunks > n / MIN_CHUNK_ROWS) nchunks = n / MIN_CHUNK_ROWS;
+    if (nchunks < 2) {
+        merge_sort(items, tmp, n, o);
+        return 1;
+    }
+
+    ParallelSort ps = { .items = items, .tmp = tmp, .n = n, .nchunks = nchunks, .order = *o };
+    int per_chunk = nchunks - 1;        // samples taken from each sorted chunk
+    int nsamples = nchunks * per_chunk;
+    ArenaMark mark = arenaMark();
+    ps.chunk_start = arenaAlloc((size_t)(nchunks + 1) * sizeof(int));
+    ps.out_start = arenaAlloc((size_t)(nchunks + 1) * sizeof(int));
+    ps.cut = arenaAlloc((size_t)(nchunks + 1) * nchunks * sizeof(int));
+    ps.heap_space = arenaAlloc((size_t)nchunks * nchunks * 3 * sizeof(int));
+    SortItem *samples = arenaAlloc((size_t)nsamples * 2 * sizeof(*samples));
+    if (!ps.chunk_start || !ps.out_start || !ps.cut || !ps.heap_space || !samples) {
+        arenaRelease(mark);
+        return 0;
+    }
+
+    // 1. sort the chunks
+    for (int c = 0; c <= nchunks; ++c) ps.chunk_start[c] = (int)((long)n * c / nchunks);
+    runTasks(nworkers, nchunks, sort_chunk_task, &ps);
+
+    // 2. pick nchunks-1 splitters from an even sample of every chunk
+    int s = 0;
+    for (int c = 0; c < nchunks; ++c) {
+        int begin = ps.chunk_start[c], len = ps.chunk_start[c + 1] - begin;
+        for (int j = 1; j <= per_chunk; ++j) samples[s++] = items[begin + (int)((long)len * j / nchunks)];
+    }
+    merge_sort(samples, samples + nsamples, nsamples, o);
+
+    // 3. cut every chunk at every splitter; range r is everything between
+    //    splitter r-1 and splitter r
+    for (int c = 0; c < nchunks; ++c) {
+        int begin = ps.chunk_start[c], len = ps.chunk_start[c + 1] - begin;
+        ps.cut[c] = begin;
+        ps.cut[(size_t)nchunks * nchunks + c] = begin + len;
+        for (int r = 1; r < nchunks; ++r) {
+            const SortItem *splitter = &samples[r * per_chunk];
+            ps.cut[(size_t)r * nchunks + c] = begin + upper_bound(items + begin, len, splitter, o);
+        }
+    }
+    ps.out_start[0] = 0;
+    for (int r = 0; r < nchunks; ++r) {
+        int size = 0;
+        for (int c = 0; c < nchunks; ++c) {
+            size += ps.cut[(size_t)(r + 1) * nchunks + c] - ps.cut[(size_t)r * nchunks + c];
+        }
+        ps.out_start[r + 1] = ps.out_start[r] + size;
+    }
+
+    // 4. merge each range into tmp, then copy back
+    runTasks(nworkers, nchunks, merge_range_task, &ps);
+    runTasks(nworkers, nchunks, copy_back_task, &ps);
+
+    arenaRelease(mark);
+    return 1;
+}
+
+int sortItems(SortItem items[], int n, SortTieFn tie, const void *ctx, long parallel_rows) {
+    if (n < 2) return 1;
+    ArenaMark mark = arenaMark();
+    SortItem *tmp = arenaAlloc((size_t)n * sizeof(*tmp));
+    if (!tmp) return 0;
+
+    Order o = { tie, ctx };
+    int nworkers = n >= parallel_rows ? workerCount(n, MIN_CHUNK_ROWS) : 1;
+    // the serial sort needs nothing beyond tmp, so it is also the fallback
+    if (nworkers <= 1 || !parallel_sort(items, tmp, n, nworkers, &o)) merge_sort(items, tmp, n, &o);
+
+    arenaRelease(mark);
+    return 1;
+}
@@ -0,0 +1,30 @@
+#ifndef PSORT_H
+#define PSORT_H
+
+#include <stdint.h>
+
+// Stable sort of row references. Each item carries a packed 64-bit key that
+// decides most comparisons on its own; equal keys go to the optional tie
+// function and finally to the row index, so the result is always the same
+// total order whether it was sorted on one thread or many.
+
+typedef struct {
+    uint64_t key;
+    int idx;        // row index in the table
+} SortItem;
+
+// Compare rows a and b whose keys are equal: <0, 0 or >0. May be NULL.
+typedef int (*SortTieFn)(int a, int b, const void *ctx);
+
+// Sort items[0..n). Uses several threads when n >= parallel_rows and there is
+// more than one CPU. Returns 0 if out of memory (items left unchanged).
+int sortItems(SortItem items[], int n, SortTieFn tie, const void *ctx, long parallel_rows);
+
+// Pack a signed sort value into an unsigned key with the same order, reversed
+// for descending sorts.
+static inline uint32_t sortKey32(int32_t v, int asc) {
+    uint32_t k = (uint32_t)v ^ 0x80000000u;
+    return asc ? k : ~k;
+}
+
+#endif
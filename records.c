@@ -4,13 +4,173 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 
 
 #include "records.h"
 #include "history.h"
+#include "dict.h"
+#include "names.h"
+#include "marks.h"
+#include "txn.h"
+#include "btree.h"
+#include "slotmap.h"
+#include "repl.h"
+#include "shard.h"
+#include "bloom.h"
+#include "settings.h"
+#include "arena.h"
 
 
-int findRecordById(const StudentRecord records[], int count, int id) {
+// The ID index (btree.h) is kept in step by the row edit functions below.
+// After a wholesale reload it is stale until the next lookup rebuilds it.
+static int index_stale = 1;
+
+typedef struct {
+    int id;
+    int slot;
+} IdSlot;
+
+static int compare_id_slot(const void *pa, const void *pb) {
+    const IdSlot *a = pa, *b = pb;
+    if (a->id != b->id) return (a->id > b->id) - (a->id < b->id);
+    return (a->slot > b->slot) - (a->slot < b->slot);
+}
+
+// Sort (id, slot) pairs and bulk-load the index. A repeated ID keeps its first
+// row; the slots of the later copies are written to dups (ascending) when it
+// is not NULL. Returns the number of repeats, or -1 when out of memory.
+static int build_index(const StudentRecord records[], int count, int dups[]) {
+    ArenaMark mark = arenaMark();
+    IdSlot *pairs = arenaAlloc((size_t)count * sizeof(*pairs));
+    int *ids = arenaAlloc((size_t)count * sizeof(*ids));
+    int *slots = arenaAlloc((size_t)count * sizeof(*slots));
+    if (!pairs || !ids || !slots) {
+        arenaRelease(mark);
+        index_stale = 1;
+        return -1;
+    }
+    for (int i = 0; i < count; ++i) pairs[i] = (IdSlot){ records[i].id, i };
+    qsort(pairs, (size_t)count, sizeof(*pairs), compare_id_slot);
+
+    int n = 0, ndups = 0;
+    for (int i = 0; i < count; ++i) {
+        if (n > 0 && ids[n - 1] == pairs[i].id) {
+            if (dups) dups[ndups] = pairs[i].slot;
+            ndups++;
+            continue;
+        }
+        ids[n] = pairs[i].id;
+        slots[n] = pairs[i].slot;
+        n++;
+    }
+    int ok = btreeBuild(ids, slots, n);
+    arenaRelease(mark);
+    index_stale = !ok;
+    return ok ? ndups : -1;
+}
+
+static void ensure_index(const StudentRecord records[], int count) {
+    if (index_stale) build_index(records, count, NULL);
+}
+
+// ID filter (bloom.h) in front of the index: most lookups of an absent ID
+// end here without touching the index or the table. Deleted IDs linger in
+// it as false positives, so it is rebuilt after a reload, once deletes make
+// up a quarter of its keys, when the table outgrows the size it was built
+// for, or when bloom_fp_per_million changes.
+static BloomFilter id_filter;
+static int filter_stale = 1;
+static long filter_fp = 0;          // bloom_fp_per_million it was built for
+static long filter_deletes = 0;
+static unsigned long filter_probes, filter_negatives, filter_false_pos, filter_builds;
+
+static void build_filter(const StudentRecord records[], int count) {
+    bloomFree(&id_filter);
+    filter_fp = getSetting(SETTING_BLOOM_FP_PER_MILLION);
+    // room to grow before the next rebuild
+    filter_stale = !bloomInit(&id_filter, (long)count + count / 4 + 1024, filter_fp);
+    if (filter_stale) return;
+    for (int i = 0; i < count; ++i) bloomAdd(&id_filter, records[i].id);
+    filter_deletes = 0;
+    filter_builds++;
+}
+
+static void filter_added(int id) {
+    if (filter_stale) return;
+    bloomAdd(&id_filter, id);
+    if (id_filter.keys > id_filter.capacity) filter_stale = 1;
+}
+
+static void filter_removed(void) {
+    if (!filter_stale && ++filter_deletes * 4 > id_filter.keys) filter_stale = 1;
+}
+
+int idMayExist(const StudentRecord records[], int count, int id) {
+    if (filter_stale || filter_fp != getSetting(SETTING_BLOOM_FP_PER_MILLION)) build_filter(records, count);
+    if (filter_stale) return 1;     // out of memory: no filter
+    filter_probes++;
+    if (bloomMayContain(&id_filter, id)) return 1;
+    filter_negatives++;
+    return 0;
+}
+
+void showIdFilter(void) {
+    if (filter_stale) {
+        printf("CMS: The ID filter is built at the next ID lookup.\n");
+        return;
+    }
+    long live = id_filter.keys - filter_deletes;
+    printf("CMS: ID filter (blocked Bloom filter over the table's IDs).\n");
+    printf("%-20s %ld (capacity %ld, %ld deleted since the last build)\n", "Keys", live, id_filter.capacity, filter_deletes);
+    printf("%-20s %lu KB, %d bits set per ID\n", "Size",
+           (unsigned long)id_filter.blocks * BLOOM_BLOCK_BYTES / 1024, id_filter.k);
+    printf("%-20s %ld per million (bloom_fp_per_million)\n", "Target FP", filter_fp);
+    printf("%-20s %.0f per million\n", "Expected FP", bloomExpectedFp(&id_filter, id_filter.keys));
+    printf("%-20s %lu\n", "Lookups", filter_probes);
+    printf("%-20s %lu (%.1f%%)\n", "Ruled out", filter_negatives,
+           filter_probes ? 100.0 * (double)filter_negatives / (double)filter_probes : 0.0);
+    printf("%-20s %lu\n", "False positives", filter_false_pos);
+    printf("%-20s %lu\n", "Builds", filter_builds);
+}
+
+static int compare_int(const void *pa, const void *pb) {
+    int a = *(const int *)pa, b = *(const int *)pb;
+    return (a > b) - (a < b);
+}
+
+int rebuildIdIndex(StudentRecord records[], int *count) {
+    ArenaMark mark = arenaMark();
+    int *dups = arenaAlloc((size_t)*count * sizeof(*dups));
+    int ndups = build_index(records, *count, dups);
+    if (ndups > 0) {
+        // load path: drop the repeats without logging them as edits
+        qsort(dups, (size_t)ndups, sizeof(*dups), compare_int);
+        int out = 0, d = 0;
+        for (int i = 0; i < *count; ++i) {
+            if (d < ndups && dups[d] == i) {
+                releaseRecordName(&records[i]);
+                d++;
+                continue;
+            }
+            records[out++] = records[i];
+        }
+        *count = out;
+        btreeCompactSlots(dups, ndups);
+    }
+    arenaRelease(mark);
+    build_filter(records, *count);
+    return ndups;
+}
+
+static int find_slot(const StudentRecord records[], int count, int id) {
+    ensure_index(records, count);
+    if (!index_stale) {
+        int slot = btreeFind(id);
+        if (slot < 0) return -1;
+        if (slot < count && records[slot].id == id) return slot;
+        index_stale = 1;    // out of step; fall back to a scan and rebuild later
+    }
 
     // FOR loop from i = 0 up to (count - 1):
         // IF records[i].id is equal to the input id, THEN:
@@ -26,6 +186,19 @@ int findRecordById(const StudentRecord records[], int count, int id) {
     return -1; 
 }
 
+int findRecordById(const StudentRecord records[], int count, int id) {
+    if (!idMayExist(records, count, id)) return -1;
+    int i = find_slot(records, count, id);
+    if (i < 0 && !filter_stale) filter_false_pos++;
+    return i;
+}
+
+// Print one record in the table column layout, decoding the programme code
+void printRecordRow(const StudentRecord *r) {
+    char mark[MARK_BUF_LEN];
+    printf("%-8d %-20s %-24s %s\n", r->id, recordName(r), programmeName(r->prog), formatMark(r->mark, mark));
+}
+
 int queryRecord(const StudentRecord records[], int count, int id) {
     // Validate input
     if (!records) {
@@ -34,18 +207,13 @@ int queryRecord(const StudentRecord records[], int count, int id) {
     }
 
     // Search for the record with matching ID
-    for (int i = 0; i < count; i++) {
-        if (records[i].id == id) {
-            // Record found - display it
-            printf("CMS: The record with ID=%d is found in the data table.\n", id);
-            printf("%-8s %-20s %-24s %s\n", "ID", "Name", "Programme", "Mark");
-            printf("%-8d %-20s %-24s %.1f\n",
-                records[i].id,
-                records[i].name,
-                records[i].programme,
-                records[i].mark);
-            return 1;
-        }
+    int i = findRecordById(records, count, id);
+    if (i != -1) {
+        // Record found - display it
+        printf("CMS: The record with ID=%d is found in the data table.\n", id);
+        printf("%-8s %-20s %-24s %s\n", "ID", "Name", "Programme", "Mark");
+        printRecordRow(&records[i]);
+        return 1;
     }
 
     // Record not found
@@ -54,6 +222,129 @@ int queryRecord(const StudentRecord records[], int count, int id) {
 }
 
 
+#define CHANGE_LOG_SIZE 1024
+
+static unsigned long table_version = 0;
+static unsigned long reload_version = 0;     // no change log before this version
+static RowChange change_log[CHANGE_LOG_SIZE]; // entry for version v at (v - 1) % size
+
+static void note_change(RowChangeKind kind, int index) {
+    change_log[table_version % CHANGE_LOG_SIZE] = (RowChange){ kind, index };
+    table_version++;
+}
+
+unsigned long tableVersion(void) {
+    return table_version;
+}
+
+void tableReloaded(void) {
+    table_version++;
+    reload_version = table_version;
+    index_stale = 1;
+    filter_stale = 1;
+    slotMapForget();    // rows no longer match the file's lines
+    replNoteReload();
+    shardNoteReload();
+}
+
+int rowChangesSince(unsigned long since, RowChange out[], int max) {
+    if (since < reload_version || since > table_version) return -1;
+    unsigned long n = table_version - since;
+    if (n > CHANGE_LOG_SIZE || n > (unsigned long)max) return -1;
+    for (unsigned long v = since; v < table_version; ++v) {
+        out[v - since] = change_log[v % CHANGE_LOG_SIZE];
+    }
+    return (int)n;
+}
+
+void appendRow(StudentRecord records[], int *count, const StudentRecord *r) {
+    insertRowAt(records, count, *count, r);
+}
+
+void insertRowAt(StudentRecord records[], int *count, int index, const StudentRecord *r) {
+    // open a gap at index (no-op for an append)
+    memmove(&records[index + 1], &records[index], (size_t)(*count - index) * sizeof(*records));
+    records[index] = *r;
+    (*count)++;
+    if (!index_stale) {
+        if (index < *count - 1) btreeShiftSlots(index, 1);
+        if (btreeInsert(r->id, index) != 1) index_stale = 1;
+    }
+    filter_added(r->id);
+    note_change(ROW_INSERTED, index);
+    slotMapInserted(index, *count);
+    txnNoteInsert(index, r);
+    replNoteUpsert(r);
+    shardNoteEdit(r->id);
+}
+
+void replaceRow(StudentRecord records[], int index, const StudentRecord *r) {
+    StudentRecord before = records[index];
+    records[index] = *r;
+    // a new name leaves the old text as arena garbage
+    if (before.name_off != r->name_off) releaseRecordName(&before);
+    if (!index_stale && before.id != r->id) {
+        btreeRemove(before.id);
+        if (btreeInsert(r->id, index) != 1) index_stale = 1;
+    }
+    if (before.id != r->id) {
+        filter_removed();
+        filter_added(r->id);
+    }
+    note_change(ROW_UPDATED, index);
+    slotMapUpdated(index);
+    txnNoteUpdate(index, &before, r);
+    if (before.id != r->id) replNoteDelete(before.id);
+    replNoteUpsert(r);
+    shardNoteEdit(before.id);
+    shardNoteEdit(r->id);
+}
+
+void removeRow(StudentRecord records[], int *count, int index) {
+    StudentRecord before = records[index];
+    releaseRecordName(&before);
+    memmove(&records[index], &records[index + 1], (size_t)(*count - index - 1) * sizeof(*records));
+    (*count)--;
+    if (!index_stale) {
+        btreeRemove(before.id);
+        if (index < *count) btreeShiftSlots(index + 1, -1);
+    }
+    filter_removed();
+    note_change(ROW_DELETED, index);
+    slotMapRemoved(index, *count);
+    txnNoteDelete(index, &before);
+    replNoteDelete(before.id);
+    shardNoteEdit(before.id);
+}
+
+void removeRows(StudentRecord records[], int *count, const int rows[], int n) {
+    if (n <= 0) return;
+
+    // log from the highest index down, the order single removeRow calls would
+    // use, so a rollback re-inserts every row at its original position
+    for (int k = n - 1; k >= 0; --k) {
+        releaseRecordName(&records[rows[k]]);
+        if (!index_stale) btreeRemove(records[rows[k]].id);
+        filter_removed();
+        note_change(ROW_DELETED, rows[k]);
+        txnNoteDelete(rows[k], &records[rows[k]]);
+        replNoteDelete(records[rows[k]].id);
+        shardNoteEdit(records[rows[k]].id);
+    }
+
+    int out = rows[0], k = 0;
+    for (int i = rows[0]; i < *count; ++i) {
+        if (k < n && rows[k] == i) {
+            k++;
+            continue;
+        }
+        records[out++] = records[i];
+    }
+    *count = out;
+    if (!index_stale) btreeCompactSlots(rows, n);
+    slotMapRemovedRows(rows, n, out);
+}
+
 int insertRecord(StudentRecord records[], int *count, const StudentRecord *newRecord) {
     // Validate input pointers
     if (!records || !count || !newRecord) {
@@ -73,16 +364,8 @@ int insertRecord(StudentRecord records[], int *count, const StudentRecord *newRe
         return 0;
     }
 
-    // Insert record
-    records[*count].id = newRecord->id;
-    strncpy(records[*count].name, newRecord->name, STRING_LEN - 1);
-    records[*count].name[STRING_LEN - 1] = '\0';
-    strncpy(records[*count].programme, newRecord->programme, STRING_LEN - 1);
-    records[*count].programme[STRING_LEN - 1] = '\0';
-    records[*count].mark = newRecord->mark;
-
-    // Increment stored count
-    (*count)++;
+    // Insert record (the row takes over newRecord's name in the arena)
+    appendRow(records, count, newRecord);
 
     return 1;
 }
@@ -96,15 +379,30 @@ int updateRecord(StudentRecord records[], int *count, int id, char *field, char
     {
 
     // 3.Update the name field with newValue when user typed "Name" only
+        StudentRecord next = records[index];
        if (strcmp(field, "Name") == 0) {
-        strncpy(records[index].name, newValue, STRING_LEN - 1);
+            if (!storeRecordName(&next, newValue)) {
+                printf("CMS: Out of memory. Update not applied.\n");
+                return 0;
+            }
         }
         else if (strcmp(field, "Programme") == 0) {
-            strncpy(records[index].programme, newValue, STRING_LEN - 1);
+            int code = internProgramme(newValue);
+            if (code < 0) {
+                printf("CMS: Too many distinct programmes. Update not applied.\n");
+                return 0;
+            }
+            next.prog = (uint16_t)code;
         }
         else if (strcmp(field, "Mark") == 0) {
-            records[index].mark = atof(newValue);
+            int tenths = 0;
+            if (!parseMark(newValue, &tenths) || tenths < MARK_MIN || tenths > MARK_MAX) {
+                printf("CMS: Mark must be a number between 0.0 and 100.0. Update not applied.\n");
+                return 0;
+            }
+            next.mark = (int16_t)tenths;
         }
+        replaceRow(records, index, &next);
         printf("CMS: The record with ID=%d is successfully updated.\n", id);
     }
     
@@ -138,20 +436,11 @@ int deleteRecord(StudentRecord records[], int *count, int id) {
     }
 
     for (int i = 0; i < *count; ++i) {
-        printf("%-8d %-20s %-24s %.1f\n",
-               records[i].id,
-               records[i].name,
-               records[i].programme,
-               records[i].mark);
+        printRecordRow(&records[i]);
     }
     
     // Shift all subsequent records left to overwrite the deleted record
-    for (int i = index; i < *count - 1; i++) {
-        records[i] = records[i + 1];
-    }
-    
-    // Decrement the count
-    (*count)--;
+    removeRow(records, count, index);
     
     printf("CMS:  The record with ID=%d is successfully deleted. \n", id);
     return 1;
@@ -174,11 +463,44 @@ void showAllRecords(const StudentRecord records[], int count)
         return;
     }
 
-    for (int i = 0; i < count; ++i) {
-        printf("%-8d %-20s %-24s %.1f\n",
-               records[i].id,
-               records[i].name,
-               records[i].programme,
-               records[i].mark);
+    // walk the ID index so rows come out in ID order without sorting
+    ensure_index(records, count);
+    if (index_stale) {
+        for (int i = 0; i < count; ++i) {
+            printRecordRow(&records[i]);
+        }
+        return;
+    }
+    BTreeCursor cur;
+    int id, slot;
+    btreeSeek(&cur, INT_MIN);
+    while (btreeNext(&cur, &id, &slot)) {
+        printRecordRow(&records[slot]);
+    }
+}
+
+int showRecordsInRange(const StudentRecord records[], int count, int lo, int hi)
+{
+    printf("CMS: Here are the records with ID between %d and %d.\n", lo, hi);
+    printf("%-8s %-20s %-24s %s\n", "ID", "Name", "Programme", "Mark");
+
+    int shown = 0;
+    ensure_index(records, count);
+    if (!index_stale) {
+        BTreeCursor cur;
+        int id, slot;
+        btreeSeek(&cur, lo);
+        while (btreeNext(&cur, &id, &slot) && id <= hi) {
+            printRecordRow(&records[slot]);
+            shown++;
+        }
+    } else {
+        for (int i = 0; i < count; ++i) {
+            if (records[i].id < lo || records[i].id > hi) continue;
+            printRecordRow(&records[i]);
+            shown++;
+        }
     }
+    if (shown == 0) printf("No records.\n");
+    return shown;
 }
\ No newline at end of file
@@ -1,21 +1,73 @@
 #ifndef RECORDS_H
 #define RECORDS_H
 
-#define MAX_RECORDS 1024
+#include <stdint.h>
+
+// Table capacity. A row is 16 bytes (names live in the arena), so the default
+// million-row table is 16 MB. Build with -DMAX_RECORDS=<n> for larger tables.
+#ifndef MAX_RECORDS
+#define MAX_RECORDS (1 << 20)
+#endif
 #define STRING_LEN 64
 
 typedef struct {
     int id;
-    char name[STRING_LEN];
-    char programme[STRING_LEN];
-    float mark;
+    uint32_t name_off;  // name text lives in the string arena, see recordName() (names.h)
+    uint16_t name_len;
+    uint16_t prog;      // programme code, decode with programmeName() (dict.h)
+    int16_t mark;       // tenths of a mark (85.9 -> 859), see marks.h
 } StudentRecord;
 
 int findRecordById(const StudentRecord records[], int count, int id);
+
+// 0 when id is certainly not in the table, answered by the ID filter
+// (bloom.h) without touching the table or its index; 1 when it may be.
+int idMayExist(const StudentRecord records[], int count, int id);
+void showIdFilter(void);
 int insertRecord(StudentRecord records[], int *count, const StudentRecord *newRecord);
 int updateRecord(StudentRecord records[], int *count, int id, char *field, char *newValue);
 int deleteRecord(StudentRecord records[], int *count, int id);
 void showAllRecords(const StudentRecord records[], int count);
+// Print the rows with lo <= ID <= hi in ID order; returns how many.
+int showRecordsInRange(const StudentRecord records[], int count, int lo, int hi);
 int queryRecord(const StudentRecord records[], int count, int id);
+void printRecordRow(const StudentRecord *r);
+
+// Row-level edits. Every change to the table goes through these so that an
+// open transaction (txn.h) can record it. Callers check capacity first.
+void appendRow(StudentRecord records[], int *count, const StudentRecord *r);
+void insertRowAt(StudentRecord records[], int *count, int index, const StudentRecord *r);
+void replaceRow(StudentRecord records[], int index, const StudentRecord *r);
+void removeRow(StudentRecord records[], int *count, int index);
+
+// Remove the rows at rows[0..n) (ascending indices) in one compaction pass.
+void removeRows(StudentRecord records[], int *count, const int rows[], int n);
+
+// Table version. Every row edit above bumps it and is kept in a short change
+// log, so cached orderings (views.h) can tell whether they are stale and
+// repair themselves from the few rows that changed.
+typedef enum { ROW_INSERTED, ROW_UPDATED, ROW_DELETED } RowChangeKind;
+
+typedef struct {
+    RowChangeKind kind;
+    int index;      // row position at the time of the change
+} RowChange;
+
+unsigned long tableVersion(void);
+
+// Rebuild the ID index (btree.h) after the table was loaded directly. IDs
+// must be unique, so later rows repeating an ID are dropped. Returns the
+// number dropped, or -1 when out of memory (lookups then scan the table).
+int rebuildIdIndex(StudentRecord records[], int *count);
+
+// Bump the version without a change log entry, for code that rewrites the
+// whole table directly (loadDB, journal replay). Older versions can no longer
+// be repaired.
+void tableReloaded(void);
+
+// Copy the changes made after version since into out, oldest first. Returns
+// how many there were, or -1 when they are not all in the log any more or
+// there are more than max.
+int rowChangesSince(unsigned long since, RowChange out[], int max);
 
 #endif /* RECORDS_H */
\ No newline at end of file
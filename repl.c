@@ -0,0 +1,678 @@
+// repl.c - log-shipping replication over a Unix socket
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "repl.h"
+#include "dict.h"
+#include "names.h"
+#include "txn.h"
+
+#define MAX_FOLLOWERS 8
+#define BATCH_RING 4096             // shipped batches remembered for lag figures
+#define HEARTBEAT_MS 1000
+#define MAX_BACKLOG (256u << 20)    // a follower further behind than this is dropped
+
+// Frames, in host byte order (both ends run on one machine):
+//   'U' id:i32 mark:i16 name_len:u16 prog_len:u16 name prog   upsert a row
+//   'D' id:i32                                                 delete a row
+//   'R'                                                        empty the table
+//   'C' seq:u64 ops:u64 sent_ms:i64      end of batch seq; ops = changes shipped so far
+//   'H' seq:u64 ops:u64 sent_ms:i64      heartbeat with the primary's position
+//   'A' seq:u64 ops:u64                  follower -> primary: batch applied
+enum { F_UPSERT = 'U', F_DELETE = 'D', F_RESET = 'R', F_COMMIT = 'C', F_HEARTBEAT = 'H', F_ACK = 'A' };
+#define UPSERT_HEAD 11
+#define POSITION_LEN 25
+#define ACK_LEN 17
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t off;     // bytes already sent or parsed
+    size_t cap;
+} Buf;
+
+typedef struct {
+    int fd;
+    int needs_snapshot;
+    Buf out;
+    Buf in;
+    uint64_t acked_seq;
+    uint64_t acked_ops;
+} Follower;
+
+typedef struct {
+    uint64_t ops;
+    long long sent_ms;
+} BatchInfo;
+
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+    int role;
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    int fd;                 // listening socket (primary) or connection (follower)
+    int wake[2];            // written to wake the I/O thread
+    pthread_t thread;
+    int stopping;
+    StudentRecord *records;
+    int *count;
+
+    // primary
+    Follower fol[MAX_FOLLOWERS];
+    int nfol;
+    Buf pending;            // edits since the last batch
+    uint64_t pending_ops;
+    size_t begin_len;       // pending.len and pending_ops at BEGIN
+    uint64_t begin_ops;
+    int reset;              // the table was reloaded: ship it whole
+    uint64_t seq;           // batches shipped
+    uint64_t ops;           // row changes shipped
+    BatchInfo ring[BATCH_RING];
+    long long last_heartbeat;
+
+    // follower
+    Buf in;
+    int connected;
+    uint64_t applied_seq;
+    uint64_t applied_ops;
+    uint64_t head_ops;      // the primary's position at the last frame
+    long long last_delay;   // ms from ship to apply of the last batch
+    long long last_heard;
+    long batches;
+} rp = { .fd = -1, .wake = { -1, -1 } };
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int buf_put(Buf *b, const void *p, size_t n) {
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + n) cap *= 2;
+        char *grown = realloc(b->data, cap);
+        if (!grown) return 0;
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+    return 1;
+}
+
+// Drop the consumed prefix once it is most of the buffer.
+static void buf_compact(Buf *b) {
+    if (b->off == b->len) {
+        b->off = b->len = 0;
+    } else if (b->off > b->len / 2) {
+        memmove(b->data, b->data + b->off, b->len - b->off);
+        b->len -= b->off;
+        b->off = 0;
+    }
+}
+
+static void buf_free(Buf *b) {
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+static int put_upsert(Buf *b, const StudentRecord *r) {
+    const char *prog = programmeName(r->prog);
+    size_t plen = strlen(prog);
+    uint16_t nlen16 = r->name_len, plen16 = (uint16_t)(plen > UINT16_MAX ? UINT16_MAX : plen);
+    char head[UPSERT_HEAD];
+    head[0] = F_UPSERT;
+    memcpy(head + 1, &r->id, 4);
+    memcpy(head + 5, &r->mark, 2);
+    memcpy(head + 7, &nlen16, 2);
+    memcpy(head + 9, &plen16, 2);
+    return buf_put(b, head, sizeof(head)) && buf_put(b, recordName(r), nlen16) && buf_put(b, prog, plen16);
+}
+
+static int put_position(Buf *b, char type, uint64_t seq, uint64_t ops, long long sent) {
+    char f[POSITION_LEN];
+    int64_t sent64 = sent;
+    f[0] = type;
+    memcpy(f + 1, &seq, 8);
+    memcpy(f + 9, &ops, 8);
+    memcpy(f + 17, &sent64, 8);
+    return buf_put(b, f, sizeof(f));
+}
+
+// The whole table as one batch ending at the current position.
+static int put_snapshot(Buf *b) {
+    char reset = F_RESET;
+    if (!buf_put(b, &reset, 1)) return 0;
+    for (int i = 0; i < *rp.count; ++i) {
+        if (!put_upsert(b, &rp.records[i])) return 0;
+    }
+    return put_position(b, F_COMMIT, rp.seq, rp.ops, now_ms());
+}
+
+static void wake_thread(void) {
+    char c = 0;
+    if (rp.wake[1] >= 0 && write(rp.wake[1], &c, 1) < 0) {
+        // the pipe is full, so the thread is awake anyway
+    }
+}
+
+static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+int replRole(void) {
+    return rp.role;
+}
+
+void replLock(void) {
+    pthread_mutex_lock(&table_lock);
+}
+
+void replUnlock(void) {
+    pthread_mutex_unlock(&table_lock);
+}
+
+/* ---------------- primary ---------------- */
+
+void replNoteUpsert(const StudentRecord *r) {
+    if (rp.role != REPL_PRIMARY || rp.reset) return;
+    if (!put_upsert(&rp.pending, r)) rp.reset = 1;  // out of memory: send the table instead
+    rp.pending_ops++;
+}
+
+void replNoteDelete(int id) {
+    if (rp.role != REPL_PRIMARY || rp.reset) return;
+    char f[5] = { F_DELETE };
+    memcpy(f + 1, &id, 4);
+    if (!buf_put(&rp.pending, f, sizeof(f))) rp.reset = 1;
+    rp.pending_ops++;
+}
+
+void replNoteReload(void) {
+    if (rp.role != REPL_PRIMARY) return;
+    rp.reset = 1;
+    rp.pending.len = 0;
+    rp.pending_ops = 0;
+}
+
+void replNoteBegin(void) {
+    rp.begin_len = rp.pending.len;
+    rp.begin_ops = rp.pending_ops;
+}
+
+void replNoteRollback(void) {
+    // a reload ships the whole table anyway; serving may have started mid-transaction
+    if (rp.role != REPL_PRIMARY || rp.reset || rp.begin_len > rp.pending.len) return;
+    rp.pending.len = rp.begin_len;
+    rp.pending_ops = rp.begin_ops;
+}
+
+static void drop_follower(int i) {
+    close(rp.fol[i].fd);
+    buf_free(&rp.fol[i].out);
+    buf_free(&rp.fol[i].in);
+    rp.fol[i] = rp.fol[--rp.nfol];
+}
+
+// Send what the socket takes now. Returns 0 when the follower is gone.
+static int flush_follower(Follower *f) {
+    while (f->out.off < f->out.len) {
+        ssize_t n = send(f->fd, f->out.data + f->out.off, f->out.len - f->out.off, 0);
+        if (n > 0) {
+            f->out.off += (size_t)n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            break;
+        } else {
+            return 0;
+        }
+    }
+    buf_compact(&f->out);
+    return 1;
+}
+
+// Queue bytes for every follower that already has the table.
+static void broadcast(const char *data, size_t len) {
+    for (int i = rp.nfol - 1; i >= 0; --i) {
+        Follower *f = &rp.fol[i];
+        if (f->needs_snapshot) continue;
+        if (f->out.len - f->out.off + len > MAX_BACKLOG || !buf_put(&f->out, data, len)) drop_follower(i);
+    }
+}
+
+// Followers that connected during a transaction get the table once it closes.
+static void send_snapshots(void) {
+    if (txnActive()) return;
+    for (int i = rp.nfol - 1; i >= 0; --i) {
+        Follower *f = &rp.fol[i];
+        if (!f->needs_snapshot) continue;
+        f->needs_snapshot = 0;
+        f->acked_seq = rp.seq;
+        f->acked_ops = rp.ops;
+        if (!put_snapshot(&f->out)) drop_follower(i);
+    }
+}
+
+void replShip(void) {
+    if (rp.role != REPL_PRIMARY || txnActive()) return;
+    send_snapshots();
+    if (!rp.reset && rp.pending.len == 0) return;
+
+    rp.seq++;
+    BatchInfo *b = &rp.ring[rp.seq % BATCH_RING];
+    b->sent_ms = now_ms();
+    if (rp.reset) {
+        Buf snap = { 0 };
+        rp.ops += (uint64_t)*rp.count;
+        b->ops = rp.ops;
+        if (put_snapshot(&snap)) {
+            broadcast(snap.data, snap.len);
+        } else {
+            while (rp.nfol > 0) drop_follower(rp.nfol - 1);     // out of memory: they must reconnect
+        }
+        buf_free(&snap);
+    } else {
+        rp.ops += rp.pending_ops;
+        b->ops = rp.ops;
+        if (put_position(&rp.pending, F_COMMIT, rp.seq, rp.ops, b->sent_ms)) {
+            broadcast(rp.pending.data, rp.pending.len);
+        } else {
+            while (rp.nfol > 0) drop_follower(rp.nfol - 1);
+        }
+    }
+    rp.reset = 0;
+    rp.pending.len = 0;
+    rp.pending_ops = 0;
+    wake_thread();
+}
+
+// Take in the follower's acknowledgements. Returns 0 once it hung up.
+static int read_acks(Follower *f) {
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(f->fd, buf, sizeof(buf), 0)) > 0) {
+        if (!buf_put(&f->in, buf, (size_t)n)) return 0;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) return 0;
+    while (f->in.len - f->in.off >= ACK_LEN) {
+        const char *a = f->in.data + f->in.off;
+        if (a[0] == F_ACK) {
+            memcpy(&f->acked_seq, a + 1, 8);
+            memcpy(&f->acked_ops, a + 9, 8);
+        }
+        f->in.off += ACK_LEN;
+    }
+    buf_compact(&f->in);
+    return 1;
+}
+
+static void primary_io(const struct pollfd *listen_pfd, const struct pollfd *pfd, int n) {
+    // followers first: the pollfd order matches the list until one is dropped
+    for (int i = n - 1; i >= 0; --i) {
+        if ((pfd[i].revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL)) && !read_acks(&rp.fol[i])) drop_follower(i);
+    }
+
+    if (listen_pfd->revents & POLLIN) {
+        int fd;
+        while ((fd = accept(rp.fd, NULL, NULL)) >= 0) {
+            if (rp.nfol == MAX_FOLLOWERS) {
+                close(fd);
+                continue;
+            }
+            set_nonblocking(fd);
+            rp.fol[rp.nfol++] = (Follower){ .fd = fd, .needs_snapshot = 1 };
+        }
+    }
+    send_snapshots();
+
+    long long now = now_ms();
+    if (now - rp.last_heartbeat >= HEARTBEAT_MS) {
+        Buf hb = { 0 };
+        if (put_position(&hb, F_HEARTBEAT, rp.seq, rp.ops, now)) broadcast(hb.data, hb.len);
+        buf_free(&hb);
+        rp.last_heartbeat = now;
+    }
+    for (int i = rp.nfol - 1; i >= 0; --i) {
+        if (!flush_follower(&rp.fol[i])) drop_follower(i);
+    }
+}
+
+/* ---------------- follower ---------------- */
+
+// Length of the frame at p, 0 if it is not complete yet, or -1 if malformed.
+static long frame_len(const char *p, size_t avail) {
+    if (avail == 0) return 0;
+    switch (p[0]) {
+    case F_RESET:
+        return 1;
+    case F_DELETE:
+        return avail >= 5 ? 5 : 0;
+    case F_COMMIT:
+    case F_HEARTBEAT:
+        return avail >= POSITION_LEN ? POSITION_LEN : 0;
+    case F_UPSERT: {
+        if (avail < UPSERT_HEAD) return 0;
+        uint16_t nlen, plen;
+        memcpy(&nlen, p + 7, 2);
+        memcpy(&plen, p + 9, 2);
+        size_t len = UPSERT_HEAD + (size_t)nlen + plen;
+        return avail >= len ? (long)len : 0;
+    }
+    default:
+        return -1;
+    }
+}
+
+static void read_position(const char *p, uint64_t *seq, uint64_t *ops, long long *sent) {
+    int64_t sent64;
+    memcpy(seq, p + 1, 8);
+    memcpy(ops, p + 9, 8);
+    memcpy(&sent64, p + 17, 8);
+    *sent = sent64;
+}
+
+// Decode an upsert into r (name stored in the arena). Returns 0 if the row
+// cannot be stored.
+static int decode_upsert(const char *p, StudentRecord *r) {
+    static char name[UINT16_MAX + 1], prog[UINT16_MAX + 1];
+    uint16_t nlen, plen;
+    memcpy(&r->id, p + 1, 4);
+    memcpy(&r->mark, p + 5, 2);
+    memcpy(&nlen, p + 7, 2);
+    memcpy(&plen, p + 9, 2);
+    memcpy(name, p + UPSERT_HEAD, nlen);
+    name[nlen] = '\0';
+    memcpy(prog, p + UPSERT_HEAD + nlen, plen);
+    prog[plen] = '\0';
+    int code = internProgramme(prog);
+    if (code < 0) return 0;
+    r->prog = (uint16_t)code;
+    return storeRecordName(r, name);
+}
+
+// Apply the frames in [from, to), which end with a commit marker.
+static void apply_batch(size_t from, size_t to) {
+    StudentRecord *records = rp.records;
+    int *count = rp.count;
+    int bulk = 0;   // after a reset rows are written directly and indexed at the end
+    size_t pos = from;
+    while (pos < to) {
+        const char *p = rp.in.data + pos;
+        pos += (size_t)frame_len(p, to - pos);
+        if (p[0] == F_RESET) {
+            *count = 0;
+            resetNames();
+            tableReloaded();
+            bulk = 1;
+        } else if (p[0] == F_UPSERT) {
+            StudentRecord r;
+            if (bulk) {
+                if (*count < MAX_RECORDS && decode_upsert(p, &records[*count])) (*count)++;
+                continue;
+            }
+            if (!decode_upsert(p, &r)) continue;
+            int idx = findRecordById(records, *count, r.id);
+            if (idx >= 0) replaceRow(records, idx, &r);
+            else if (*count < MAX_RECORDS) appendRow(records, count, &r);
+            else releaseRecordName(&r);
+        } else if (p[0] == F_DELETE) {
+            int id;
+            memcpy(&id, p + 1, 4);
+            int idx = findRecordById(records, *count, id);
+            if (idx >= 0) removeRow(records, count, idx);
+        } else if (p[0] == F_COMMIT) {
+            long long sent;
+            if (bulk) rebuildIdIndex(records, count);
+            read_position(p, &rp.applied_seq, &rp.applied_ops, &sent);
+            if (rp.applied_ops > rp.head_ops) rp.head_ops = rp.applied_ops;
+            rp.last_delay = now_ms() - sent;
+            rp.batches++;
+
+            char ack[ACK_LEN] = { F_ACK };
+            memcpy(ack + 1, &rp.applied_seq, 8);
+            memcpy(ack + 9, &rp.applied_ops, 8);
+            if (send(rp.fd, ack, sizeof(ack), 0) != (ssize_t)sizeof(ack)) {
+                // the primary is gone or slow to read; lag figures there lag too
+            }
+        }
+    }
+}
+
+static void disconnect(void) {
+    if (rp.fd >= 0) close(rp.fd);
+    rp.fd = -1;
+    rp.connected = 0;
+}
+
+static void follower_io(short revents) {
+    if (rp.fd < 0 || !(revents & (POLLIN | POLLERR | POLLHUP))) return;
+    char buf[1 << 16];
+    ssize_t n;
+    int closed = 0;
+    while ((n = recv(rp.fd, buf, sizeof(buf), 0)) > 0) {
+        if (!buf_put(&rp.in, buf, (size_t)n)) {
+            closed = 1;
+            break;
+        }
+        rp.last_heard = now_ms();
+    }
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) closed = 1;
+
+    // apply every complete batch; heartbeats between batches only move the head
+    while (rp.in.off < rp.in.len) {
+        size_t pos = rp.in.off;
+        long len;
+        while ((len = frame_len(rp.in.data + pos, rp.in.len - pos)) > 0 && rp.in.data[pos] == F_HEARTBEAT) {
+            uint64_t seq, ops;
+            long long sent;
+            read_position(rp.in.data + pos, &seq, &ops, &sent);
+            if (ops > rp.head_ops) rp.head_ops = ops;
+            pos += (size_t)len;
+        }
+        rp.in.off = pos;
+
+        int complete = 0;
+        while ((len = frame_len(rp.in.data + pos, rp.in.len - pos)) > 0) {
+            char type = rp.in.data[pos];
+            pos += (size_t)len;
+            if (type == F_COMMIT) {
+                complete = 1;
+                break;
+            }
+        }
+        if (len < 0) closed = 1;    // not a stream we understand
+        if (!complete) break;
+        apply_batch(rp.in.off, pos);
+        rp.in.off = pos;
+    }
+    buf_compact(&rp.in);
+    if (closed) disconnect();
+}
+
+/* ---------------- both ---------------- */
+
+static void *io_thread(void *arg) {
+    (void)arg;
+    for (;;) {
+        struct pollfd p[2 + MAX_FOLLOWERS];
+        int n = 0;
+        pthread_mutex_lock(&table_lock);
+        if (rp.stopping) {
+            pthread_mutex_unlock(&table_lock);
+            break;
+        }
+        p[n++] = (struct pollfd){ rp.wake[0], POLLIN, 0 };
+        p[n++] = (struct pollfd){ rp.fd, POLLIN, 0 };   // fd -1 is ignored by poll
+        int nfol = rp.role == REPL_PRIMARY ? rp.nfol : 0;
+        for (int i = 0; i < nfol; ++i) {
+            short events = POLLIN | (rp.fol[i].out.off < rp.fol[i].out.len ? POLLOUT : 0);
+            p[n++] = (struct pollfd){ rp.fol[i].fd, events, 0 };
+        }
+        pthread_mutex_unlock(&table_lock);
+
+        poll(p, (nfds_t)n, HEARTBEAT_MS);
+
+        pthread_mutex_lock(&table_lock);
+        if (p[0].revents & POLLIN) {
+            char drain[64];
+            while (read(rp.wake[0], drain, sizeof(drain)) > 0) {}
+        }
+        if (!rp.stopping) {
+            if (rp.role == REPL_PRIMARY) primary_io(&p[1], &p[2], nfol);
+            else follower_io(p[1].revents);
+        }
+        pthread_mutex_unlock(&table_lock);
+    }
+    return NULL;
+}
+
+static int start(int role, const char *path, int fd, StudentRecord records[], int *count) {
+    if (pipe(rp.wake) != 0) {
+        close(fd);
+        printf("CMS: ERROR: Cannot start replication.\n");
+        return 0;
+    }
+    set_nonblocking(rp.wake[0]);
+    set_nonblocking(rp.wake[1]);
+    set_nonblocking(fd);
+    signal(SIGPIPE, SIG_IGN);   // a follower that went away shows up as a send error
+
+    rp.role = role;
+    strncpy(rp.path, path, sizeof(rp.path) - 1);
+    rp.fd = fd;
+    rp.records = records;
+    rp.count = count;
+    rp.stopping = 0;
+    rp.last_heard = now_ms();
+    if (pthread_create(&rp.thread, NULL, io_thread, NULL) != 0) {
+        close(rp.wake[0]);
+        close(rp.wake[1]);
+        close(fd);
+        memset(&rp, 0, sizeof(rp));
+        rp.fd = rp.wake[0] = rp.wake[1] = -1;
+        printf("CMS: ERROR: Cannot start replication.\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int make_address(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        printf("CMS: ERROR: The socket path \"%s\" is too long.\n", path);
+        return 0;
+    }
+    strcpy(addr->sun_path, path);
+    return 1;
+}
+
+int replServe(const char *path, StudentRecord records[], int *count) {
+    struct sockaddr_un addr;
+    struct stat st;
+    if (!make_address(path, &addr)) return 0;
+    if (stat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            printf("CMS: ERROR: \"%s\" exists and is not a socket.\n", path);
+            return 0;
+        }
+        unlink(path);   // left over from an earlier primary
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, MAX_FOLLOWERS) != 0) {
+        printf("CMS: ERROR: Cannot listen on \"%s\".\n", path);
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    rp.seq = rp.ops = 0;
+    rp.ring[0] = (BatchInfo){ 0, now_ms() };
+    rp.reset = 0;
+    rp.nfol = 0;
+    return start(REPL_PRIMARY, path, fd, records, count);
+}
+
+int replFollow(const char *path, StudentRecord records[], int *count) {
+    struct sockaddr_un addr;
+    if (!make_address(path, &addr)) return 0;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        printf("CMS: ERROR: No primary is listening on \"%s\".\n", path);
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    rp.connected = 1;
+    rp.applied_seq = rp.applied_ops = rp.head_ops = 0;
+    rp.batches = 0;
+    rp.last_delay = 0;
+    return start(REPL_FOLLOWER, path, fd, records, count);
+}
+
+void replStop(void) {
+    if (rp.role == REPL_NONE) return;
+    rp.stopping = 1;
+    wake_thread();
+    pthread_mutex_unlock(&table_lock);
+    pthread_join(rp.thread, NULL);
+    pthread_mutex_lock(&table_lock);
+
+    while (rp.nfol > 0) drop_follower(rp.nfol - 1);
+    if (rp.fd >= 0) close(rp.fd);
+    if (rp.role == REPL_PRIMARY) unlink(rp.path);
+    close(rp.wake[0]);
+    close(rp.wake[1]);
+    buf_free(&rp.pending);
+    buf_free(&rp.in);
+    memset(&rp, 0, sizeof(rp));
+    rp.fd = rp.wake[0] = rp.wake[1] = -1;
+}
+
+void replStatus(void) {
+    long long now = now_ms();
+    if (rp.role == REPL_NONE) {
+        printf("CMS: Replication is off.\n");
+        return;
+    }
+    if (rp.role == REPL_PRIMARY) {
+        printf("CMS: REPLICATION STATUS (primary on \"%s\")\n", rp.path);
+        printf("  Shipped       : %llu batch(es), %llu row change(s)\n", (unsigned long long)rp.seq,
+               (unsigned long long)rp.ops);
+        if (rp.nfol == 0) printf("  Followers     : none\n");
+        for (int i = 0; i < rp.nfol; ++i) {
+            const Follower *f = &rp.fol[i];
+            if (f->needs_snapshot) {
+                printf("  Follower %d    : waiting for the open transaction to close\n", i + 1);
+                continue;
+            }
+            long long lag = 0;
+            if (f->acked_seq < rp.seq) {
+                uint64_t next = f->acked_seq + 1;
+                if (rp.seq - next >= BATCH_RING) next = rp.seq - BATCH_RING + 1;   // older than we remember
+                lag = now - rp.ring[next % BATCH_RING].sent_ms;
+            }
+            printf("  Follower %d    : applied batch %llu, behind %llu row change(s), lag %lld ms\n", i + 1,
+                   (unsigned long long)f->acked_seq, (unsigned long long)(rp.ops - f->acked_ops), lag);
+        }
+        return;
+    }
+    printf("CMS: REPLICATION STATUS (follower of \"%s\", %s)\n", rp.path, rp.connected ? "connected" : "disconnected");
+    printf("  Applied       : batch %llu (%llu row change(s); %ld batch(es) this session)\n",
+           (unsigned long long)rp.applied_seq, (unsigned long long)rp.applied_ops, rp.batches);
+    printf("  Behind        : %llu row change(s)\n", (unsigned long long)(rp.head_ops - rp.applied_ops));
+    printf("  Lag           : last batch applied %lld ms after the primary shipped it\n", rp.last_delay);
+    printf("  Last heard    : %lld ms ago\n", now - rp.last_heard);
+}
@@ -0,0 +1,52 @@
+#ifndef REPL_H
+#define REPL_H
+
+#include "records.h"
+
+// Log-shipping replication between CMS processes on one machine.
+//
+// REPLICATE SERVE <socket> makes this session a primary: it listens on a
+// Unix socket, and every row edit (records.c) is logged by ID as an upsert
+// or delete. After each command, outside transactions, the edits it made are
+// shipped to every follower as one batch. A follower that connects, and
+// every follower after the table is reloaded, first receives the whole table.
+//
+// REPLICATE FOLLOW <socket> makes this session a read replica. A background
+// thread applies complete batches as they arrive and acknowledges them; the
+// session itself serves QUERY and SHOW and refuses edits. Both sides report
+// the lag in row changes and milliseconds (REPLICATE STATUS).
+//
+// Commands and the I/O thread share the table under one lock: the main
+// loop holds it while a command runs.
+
+enum { REPL_NONE, REPL_PRIMARY, REPL_FOLLOWER };
+
+int replRole(void);
+
+// Start serving or following on the socket at path; records/count is the
+// session's table. Return 1 on success, 0 with a message on error.
+int replServe(const char *path, StudentRecord records[], int *count);
+int replFollow(const char *path, StudentRecord records[], int *count);
+
+// Stop replicating. Call with the table lock held.
+void replStop(void);
+void replStatus(void);
+
+void replLock(void);
+void replUnlock(void);
+
+// Row edit hooks (records.c) and whole-table reloads (tableReloaded).
+void replNoteUpsert(const StudentRecord *r);
+void replNoteDelete(int id);
+void replNoteReload(void);
+
+// Transaction hooks (txn.c): a ROLLBACK drops the edits made since BEGIN,
+// and the undo edits that reverted them, so the followers never see them.
+void replNoteBegin(void);
+void replNoteRollback(void);
+
+// Primary: send the edits of the last command to the followers. Does
+// nothing while a transaction is open; its edits go out once it closes.
+void replShip(void);
+
+#endif
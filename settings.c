@@ -0,0 +1,83 @@
+// settings.c - named runtime settings for SET / SHOW SETTINGS
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "settings.h"
+
+typedef struct {
+    const char *name;
+    long value;
+    long min;
+    long max;
+    const char *help;
+} Setting;
+
+static Setting settings[SETTING_COUNT] = {
+    [SETTING_SORT_PARALLEL_ROWS] = { "sort_parallel_rows", 200000, 1024, 2000000000L,
+                                     "rows before SHOW ALL SORT BY sorts on several threads" },
+    [SETTING_BUFFER_POOL_PAGES] = { "buffer_pool_pages", 256, 8, 1L << 20,
+                                    "4 KB pages cached for an archive (applies at ARCHIVE OPEN)" },
+    [SETTING_BLOOM_FP_PER_MILLION] = { "bloom_fp_per_million", 10000, 1, 500000,
+                                       "ID filter false positives per million absent IDs (archives: at ARCHIVE CREATE)" },
+    [SETTING_ARENA_KEEP_KB] = { "arena_keep_kb", 65536, 0, 1L << 24,
+                                "KB of command scratch memory kept for the next command" },
+    [SETTING_RECORD_POOL_BLOCKS] = { "record_pool_blocks", 32, 0, 1L << 16,
+                                     "free 128 KB record blocks kept for the next command" },
+};
+
+static int iequals(const char *a, const char *b) {
+    while (*a && *b) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return 0;
+        a++; b++;
+    }
+    return *a == *b;
+}
+
+long getSetting(SettingId id) {
+    return settings[id].value;
+}
+
+int applySetting(const char *text) {
+    char name[64] = { 0 };
+    char value[32] = { 0 };
+
+    // accept "name value" and "name=value"
+    char buf[128];
+    strncpy(buf, text ? text : "", sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    char *eq = strchr(buf, '=');
+    if (eq) *eq = ' ';
+    if (sscanf(buf, "%63s %31s", name, value) != 2) {
+        printf("CMS: Use: SET <name> <value>. SHOW SETTINGS lists the names.\n");
+        return 0;
+    }
+
+    for (int i = 0; i < SETTING_COUNT; ++i) {
+        Setting *s = &settings[i];
+        if (!iequals(name, s->name)) continue;
+
+        char *end = NULL;
+        long v = strtol(value, &end, 10);
+        if (end == value || *end != '\0' || v < s->min || v > s->max) {
+            printf("CMS: %s must be a whole number from %ld to %ld.\n", s->name, s->min, s->max);
+            return 0;
+        }
+        s->value = v;
+        printf("CMS: %s set to %ld.\n", s->name, v);
+        return 1;
+    }
+
+    printf("CMS: Unknown setting '%s'. SHOW SETTINGS lists the names.\n", name);
+    return 0;
+}
+
+void showSettings(void) {
+    printf("CMS: Current settings.\n");
+    printf("%-24s %-12s %s\n", "Setting", "Value", "Meaning");
+    for (int i = 0; i < SETTING_COUNT; ++i) {
+        printf("%-24s %-12ld %s\n", settings[i].name, settings[i].value, settings[i].help);
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+// Runtime tuning knobs, changed with "SET <name> <value>" and listed with
+// "SHOW SETTINGS". Values are whole numbers checked against a fixed range.
+
+typedef enum {
+    SETTING_SORT_PARALLEL_ROWS,     // SHOW ALL SORT BY uses threads from this many rows
+    SETTING_BUFFER_POOL_PAGES,      // 4 KB pages cached for an open archive (archive.h)
+    SETTING_BLOOM_FP_PER_MILLION,   // false positive target of the ID filters (bloom.h)
+    SETTING_ARENA_KEEP_KB,          // scratch arena memory kept between commands (arena.h)
+    SETTING_RECORD_POOL_BLOCKS,     // free record blocks kept between commands (arena.h)
+    SETTING_COUNT
+} SettingId;
+
+long getSetting(SettingId id);
+
+// Parse "name value" or "name=value". Returns 1 on success; otherwise prints
+// the reason and returns 0.
+int applySetting(const char *text);
+
+void showSettings(void);
+
+#endif
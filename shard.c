@@ -0,0 +1,434 @@
+// shard.c - ID-range sharded database files with parallel load
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "shard.h"
+#include "database.h"
+#include "dict.h"
+#include "marks.h"
+#include "names.h"
+#include "slotmap.h"
+#include "threads.h"
+
+#define SHARD_MAGIC "CMS-SHARDS 1"
+#define SHARD_SPAN 100000       // IDs per shard: one 2-digit prefix of a 7-digit ID
+
+static struct {
+    int active;
+    char path[260];                     // the manifest
+    unsigned char present[SHARD_KEYS];  // the manifest lists a file for this key
+    unsigned char dirty[SHARD_KEYS];    // rows of this key changed since their file was written
+    int written;
+} layout;
+
+// A row split in place in a shard file's text. name is NULL for a line not in
+// SAVE's exact shape; it is parsed from line..end on the loading thread.
+typedef struct {
+    int id;
+    int mark;
+    char *name, *prog;
+    char *line, *end;
+} RawRow;
+
+typedef struct {
+    int key;
+    char path[512];
+    char *buf;          // the whole file; rows point into it
+    RawRow *rows;
+    int n, cap;
+    int failed;         // 1: unreadable, 2: out of memory
+} ShardFile;
+
+typedef struct {
+    const char *manifest;
+    const StudentRecord *records;
+    const int *order;   // row indices grouped by key, in table order within a key
+    const int *first;   // key k's rows are order[first[k] .. first[k + 1])
+    const int *keys;    // the shards to write
+    int *failed;
+} SaveJob;
+
+int shardKey(int id) {
+    if (id < 0) return 0;
+    int key = id / SHARD_SPAN;
+    return key < SHARD_KEYS ? key : SHARD_KEYS - 1;
+}
+
+// Length of the directory part of path, including the last separator.
+static size_t dir_len(const char *path) {
+    size_t n = strlen(path);
+    while (n > 0 && path[n - 1] != '/' && path[n - 1] != '\\') n--;
+    return n;
+}
+
+// File name of key's shard: "P5_4-CMS.txt" -> "P5_4-CMS.shard-27.txt".
+static void shard_name(const char *manifest, int key, char *out, size_t size) {
+    const char *base = manifest + dir_len(manifest);
+    size_t n = strlen(base);
+    if (n > 4 && strcmp(base + n - 4, ".txt") == 0) n -= 4;
+    snprintf(out, size, "%.*s.shard-%02d.txt", (int)n, base, key);
+}
+
+// Shard files are named relative to the manifest's directory.
+static void shard_path(const char *manifest, const char *name, char *out, size_t size) {
+    snprintf(out, size, "%.*s%s", (int)dir_len(manifest), manifest, name);
+}
+
+static int replace_file(const char *tmp, const char *path) {
+#ifdef _WIN32
+    remove(path);   // rename does not replace an existing file there
+#endif
+    return rename(tmp, path) == 0;
+}
+
+int isShardManifest(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+    char head[sizeof(SHARD_MAGIC) + 1] = { 0 };
+    size_t got = fread(head, 1, sizeof(head) - 1, fp);
+    fclose(fp);
+    size_t n = strlen(SHARD_MAGIC);
+    return got > n && memcmp(head, SHARD_MAGIC, n) == 0 && (head[n] == '\n' || head[n] == '\r');
+}
+
+// ---- loading ----
+
+// The manifest's shard list: "<key> <rows> <file name>" per line.
+static int read_manifest(const char *manifest, ShardFile **out, int *n) {
+    FILE *fp = fopen(manifest, "r");
+    if (!fp) {
+        printf("CMS: Unable to open file '%s'\n", manifest);
+        return 0;
+    }
+    ShardFile *files = calloc(SHARD_KEYS, sizeof(*files));
+    if (!files) {
+        printf("CMS: Out of memory while reading '%s'.\n", manifest);
+        fclose(fp);
+        return 0;
+    }
+
+    unsigned char seen[SHARD_KEYS] = { 0 };
+    char line[1024];
+    int count = 0, ok = fgets(line, sizeof(line), fp) != NULL;    // the magic line
+    while (ok && fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *s = line;
+        while (isspace((unsigned char)*s)) s++;
+        if (*s == '\0' || *s == '#') continue;
+        int key, rows, off = 0;
+        if (sscanf(s, "%d %d %n", &key, &rows, &off) != 2 || off == 0 || s[off] == '\0' ||
+            key < 0 || key >= SHARD_KEYS || seen[key]) {
+            ok = 0;
+            break;
+        }
+        seen[key] = 1;
+        files[count].key = key;
+        files[count].cap = rows > 0 && rows <= MAX_RECORDS ? rows : 0;    // a sizing hint only
+        shard_path(manifest, s + off, files[count].path, sizeof(files[count].path));
+        count++;
+    }
+    fclose(fp);
+    if (!ok) {
+        printf("CMS: The shard manifest '%s' is damaged.\n", manifest);
+        free(files);
+        return 0;
+    }
+    *out = files;
+    *n = count;
+    return 1;
+}
+
+static int push_row(ShardFile *sf, const RawRow *r) {
+    if (sf->n == sf->cap) {
+        int cap = sf->cap ? sf->cap * 2 : 1024;
+        RawRow *grown = realloc(sf->rows, (size_t)cap * sizeof(*grown));
+        if (!grown) return 0;
+        sf->rows = grown;
+        sf->cap = cap;
+    }
+    sf->rows[sf->n++] = *r;
+    return 1;
+}
+
+// Task: read one shard file whole and split its rows in place. Interning
+// programmes and storing names touch shared tables, so that is left to the
+// loading thread.
+static void read_shard(void *ctx, int task) {
+    ShardFile *sf = &((ShardFile *)ctx)[task];
+    FILE *fp = fopen(sf->path, "rb");
+    if (!fp) {
+        sf->failed = 1;
+        return;
+    }
+    long size = fseek(fp, 0, SEEK_END) == 0 ? ftell(fp) : -1;
+    if (size < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        sf->failed = 1;
+        return;
+    }
+    sf->buf = malloc((size_t)size + 1);
+    if (sf->cap > 0) sf->rows = malloc((size_t)sf->cap * sizeof(*sf->rows));
+    if (!sf->buf || (sf->cap > 0 && !sf->rows)) {
+        fclose(fp);
+        sf->cap = 0;
+        sf->failed = 2;
+        return;
+    }
+    size_t got = fread(sf->buf, 1, (size_t)size, fp);
+    fclose(fp);
+    if (got != (size_t)size) {
+        sf->failed = 1;
+        return;
+    }
+
+    char *p = sf->buf, *stop = sf->buf + size;
+    while (p < stop) {
+        char *nl = memchr(p, '\n', (size_t)(stop - p));
+        char *end = nl ? nl : stop;
+        char *s = p;
+        p = nl ? nl + 1 : stop;
+        while (end > s && end[-1] == '\r') end--;
+        *end = '\0';
+        while (s < end && isspace((unsigned char)*s)) s++;
+        if (s == end || !isdigit((unsigned char)*s)) continue;
+
+        RawRow r = { 0 };
+        char *mark_text;
+        if (splitRow(s, end, &r.id, &r.name, &r.prog, &mark_text)) {
+            if (!parseMark(mark_text, &r.mark) || r.mark < MARK_MIN || r.mark > MARK_MAX) continue;
+        } else {
+            r.line = s;
+            r.end = end;
+        }
+        if (!push_row(sf, &r)) {
+            sf->failed = 2;
+            return;
+        }
+    }
+}
+
+static void free_files(ShardFile *files, int n) {
+    for (int t = 0; t < n; ++t) {
+        free(files[t].buf);
+        free(files[t].rows);
+    }
+    free(files);
+}
+
+int loadShards(const char *manifest, StudentRecord records[], int *count) {
+    ShardFile *files;
+    int n;
+    if (!read_manifest(manifest, &files, &n)) return 0;
+
+    // read and split every file in parallel before the table is touched
+    if (n > 0) runTasks(workerCount(n, 1), n, read_shard, files);
+    for (int t = 0; t < n; ++t) {
+        if (files[t].failed == 1) printf("CMS: Unable to read shard file '%s'\n", files[t].path);
+        if (files[t].failed == 2) printf("CMS: Out of memory while reading '%s'.\n", files[t].path);
+        if (files[t].failed) {
+            free_files(files, n);
+            return 0;
+        }
+    }
+
+    *count = 0;
+    resetNames(); // the previous table's names are dropped with it
+    tableReloaded();
+
+    // a row filed under the wrong key moves to its own shard at the next SAVE
+    unsigned char misplaced[SHARD_KEYS] = { 0 };
+    int ok = 1, truncated = 0;
+    for (int t = 0; t < n && ok; ++t) {
+        ShardFile *sf = &files[t];
+        for (int i = 0; i < sf->n; ++i) {
+            if (*count == MAX_RECORDS) {
+                truncated++;
+                continue;
+            }
+            RawRow *r = &sf->rows[i];
+            StudentRecord *out = &records[*count];
+            int rc = r->name ? storeRow(sf->path, r->id, r->name, r->prog, r->mark, out)
+                             : parseRow(sf->path, r->line, r->end, out);
+            if (rc < 0) {
+                ok = 0;
+                break;
+            }
+            if (rc == 0) continue;
+            int key = shardKey(out->id);
+            if (key != sf->key) misplaced[key] = misplaced[sf->key] = 1;
+            (*count)++;
+        }
+    }
+    memset(layout.present, 0, sizeof(layout.present));
+    for (int t = 0; t < n; ++t) layout.present[files[t].key] = 1;
+    free_files(files, n);
+    if (!ok) {
+        layout.active = 0;
+        return 0;
+    }
+
+    if (truncated > 0) {
+        printf("CMS: WARNING: The table holds %d rows; %d more row(s) in the shards were not loaded.\n", MAX_RECORDS, truncated);
+    }
+    // IDs are the primary key: index them and keep the first row of any repeat
+    int dropped = rebuildIdIndex(records, count);
+    if (dropped > 0) {
+        printf("CMS: WARNING: %d row(s) in the shards of '%s' repeat an earlier ID and were skipped.\n", dropped, manifest);
+        memset(misplaced, 1, sizeof(misplaced));
+    }
+
+    layout.active = 1;
+    strncpy(layout.path, manifest, sizeof(layout.path) - 1);
+    layout.path[sizeof(layout.path) - 1] = '\0';
+    memcpy(layout.dirty, misplaced, sizeof(layout.dirty));
+    layout.written = 0;
+    return 1;
+}
+
+// ---- saving ----
+
+// Task: write one shard to a temporary file and move it over the old one.
+static void write_shard(void *ctx, int task) {
+    SaveJob *job = ctx;
+    int key = job->keys[task];
+    char name[300], path[600], tmp[610], mark[MARK_BUF_LEN];
+    shard_name(job->manifest, key, name, sizeof(name));
+    shard_path(job->manifest, name, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) {
+        job->failed[task] = 1;
+        return;
+    }
+    int ok = 1;
+    for (int i = job->first[key]; i < job->first[key + 1] && ok; ++i) {
+        const StudentRecord *r = &job->records[job->order[i]];
+        ok = fprintf(fp, "%d\t%s\t%s\t%s\n", r->id, recordName(r), programmeName(r->prog), formatMark(r->mark, mark)) > 0;
+    }
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || !replace_file(tmp, path)) {
+        remove(tmp);
+        job->failed[task] = 1;
+    }
+}
+
+static int write_manifest(const char *manifest, const int first[]) {
+    char tmp[300], name[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", manifest);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return 0;
+    int ok = fprintf(fp, "%s\n# key = ID / %d; key rows file\n", SHARD_MAGIC, SHARD_SPAN) > 0;
+    for (int k = 0; k < SHARD_KEYS && ok; ++k) {
+        if (first[k + 1] == first[k]) continue;
+        shard_name(manifest, k, name, sizeof(name));
+        ok = fprintf(fp, "%02d %d %s\n", k, first[k + 1] - first[k], name) > 0;
+    }
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || !replace_file(tmp, manifest)) {
+        remove(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+int saveShards(const char *manifest, const StudentRecord records[], int count) {
+    // group the rows by key with one counting pass
+    int first[SHARD_KEYS + 1] = { 0 }, next[SHARD_KEYS];
+    int *order = malloc((size_t)(count > 0 ? count : 1) * sizeof(*order));
+    if (!order) {
+        printf("CMS: Out of memory while saving '%s'.\n", manifest);
+        return 0;
+    }
+    for (int i = 0; i < count; ++i) first[shardKey(records[i].id) + 1]++;
+    for (int k = 0; k < SHARD_KEYS; ++k) first[k + 1] += first[k];
+    memcpy(next, first, sizeof(next));
+    for (int i = 0; i < count; ++i) order[next[shardKey(records[i].id)]++] = i;
+
+    // only shards with changed rows, or none on disk yet, are written
+    int keys[SHARD_KEYS], failed[SHARD_KEYS] = { 0 }, nkeys = 0;
+    for (int k = 0; k < SHARD_KEYS; ++k) {
+        if (first[k + 1] > first[k] && (layout.dirty[k] || !layout.present[k])) keys[nkeys++] = k;
+    }
+    SaveJob job = { manifest, records, order, first, keys, failed };
+    if (nkeys > 0) runTasks(workerCount(nkeys, 1), nkeys, write_shard, &job);
+    free(order);
+
+    int ok = 1;
+    for (int t = 0; t < nkeys; ++t) {
+        if (failed[t]) {
+            printf("CMS: Write error occurred while saving shard %02d of '%s'.\n", keys[t], manifest);
+            ok = 0;
+        } else {
+            layout.dirty[keys[t]] = 0;
+        }
+    }
+    if (!ok) return 0;
+
+    // the manifest goes last: it switches readers over to the new shards
+    if (!write_manifest(manifest, first)) {
+        printf("CMS: Unable to write to file: %s\n", manifest);
+        return 0;
+    }
+    char name[300], path[600];
+    for (int k = 0; k < SHARD_KEYS; ++k) {
+        int has_rows = first[k + 1] > first[k];
+        if (layout.present[k] && !has_rows) {
+            shard_name(manifest, k, name, sizeof(name));
+            shard_path(manifest, name, path, sizeof(path));
+            remove(path);
+        }
+        layout.present[k] = (unsigned char)has_rows;
+    }
+    layout.written = nkeys;
+    return 1;
+}
+
+// ---- layout state ----
+
+int shardedAt(const char *path) {
+    return layout.active && strcmp(layout.path, path) == 0;
+}
+
+void shardAttach(const char *manifest) {
+    layout.active = 1;
+    strncpy(layout.path, manifest, sizeof(layout.path) - 1);
+    layout.path[sizeof(layout.path) - 1] = '\0';
+    memset(layout.present, 0, sizeof(layout.present));
+    memset(layout.dirty, 1, sizeof(layout.dirty));
+    layout.written = 0;
+    slotMapForget();    // the file is about to become a manifest
+}
+
+void shardDetach(void) {
+    layout.active = 0;
+}
+
+void removeShardFiles(const char *manifest) {
+    char name[300], path[600];
+    for (int k = 0; k < SHARD_KEYS; ++k) {
+        shard_name(manifest, k, name, sizeof(name));
+        shard_path(manifest, name, path, sizeof(path));
+        remove(path);
+    }
+}
+
+int shardCount(void) {
+    int n = 0;
+    for (int k = 0; k < SHARD_KEYS; ++k) n += layout.present[k];
+    return n;
+}
+
+int shardsWritten(void) {
+    return layout.written;
+}
+
+void shardNoteEdit(int id) {
+    if (layout.active) layout.dirty[shardKey(id)] = 1;
+}
+
+void shardNoteReload(void) {
+    if (layout.active) memset(layout.dirty, 1, sizeof(layout.dirty));
+}
@@ -0,0 +1,47 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "records.h"
+
+// Sharded database layout. SAVE SHARDED turns the database file into a
+// manifest that lists one text file per ID range. The range is the ID
+// divided by 100000, which is the intake-year prefix of a 7-digit ID.
+// OPEN reads the shard files in parallel. SAVE rewrites only the shards
+// whose rows changed, and the manifest last.
+
+// Key of the shard that owns id (0..SHARD_KEYS-1).
+#define SHARD_KEYS 100
+int shardKey(int id);
+
+// Whether path starts like a manifest SAVE SHARDED wrote.
+int isShardManifest(const char *path);
+
+// Load every shard listed in the manifest into the table; loadDB calls this
+// for manifests. Returns 1 on success, 0 (message printed) on failure.
+int loadShards(const char *manifest, StudentRecord records[], int *count);
+
+// Write the changed shards and the manifest; saveDB calls this while the
+// table is sharded at manifest. Returns 1 on success, 0 on failure.
+int saveShards(const char *manifest, const StudentRecord records[], int count);
+
+// Whether the table is kept as shards under the manifest at path.
+int shardedAt(const char *path);
+
+// Keep the table as shards under manifest from the next SAVE on, with every
+// shard written then; shardDetach goes back to a single file.
+void shardAttach(const char *manifest);
+void shardDetach(void);
+
+// Delete the shard files of the manifest at path, after it was rewritten as
+// a single file.
+void removeShardFiles(const char *manifest);
+
+// Shard files in the layout, and how many the last save rewrote.
+int shardCount(void);
+int shardsWritten(void);
+
+// Row edit hooks (records.c) and whole-table reloads (tableReloaded).
+void shardNoteEdit(int id);
+void shardNoteReload(void);
+
+#endif
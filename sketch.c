@@ -0,0 +1,156 @@
+// sketch.c - KLL quantile sketch (Karnin, Lang, Liberty) used for streaming
+// distribution statistics.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sketch.h"
+#include "arena.h"
+
+typedef struct {
+    int value;
+    long weight;
+} WeightedItem;
+
+static int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_weighted(const void *a, const void *b) {
+    int x = ((const WeightedItem *)a)->value, y = ((const WeightedItem *)b)->value;
+    return (x > y) - (x < y);
+}
+
+// capacity of level h: k at the top, shrinking by 2/3 per level below it
+static int level_capacity(const QuantileSketch *sk, int h) {
+    double cap = sk->k;
+    for (int depth = sk->levels - 1 - h; depth > 0; --depth) cap *= 2.0 / 3.0;
+    return cap < 2.0 ? 2 : (int)cap;
+}
+
+static int push_item(QuantileSketch *sk, int h, int value) {
+    if (sk->size[h] == sk->alloc[h]) {
+        int grown_alloc = sk->alloc[h] ? sk->alloc[h] * 2 : 16;
+        int *grown = realloc(sk->items[h], (size_t)grown_alloc * sizeof(*grown));
+        if (!grown) return 0;
+        sk->items[h] = grown;
+        sk->alloc[h] = grown_alloc;
+    }
+    sk->items[h][sk->size[h]++] = value;
+    return 1;
+}
+
+// xorshift32 coin flip
+static int coin(QuantileSketch *sk) {
+    unsigned x = sk->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sk->rng = x;
+    return (int)(x & 1u);
+}
+
+// Sort level h and promote every other item to level h+1, halving its size.
+static int compact_level(QuantileSketch *sk, int h) {
+    if (h + 1 >= SKETCH_MAX_LEVELS) return 1;   // cannot grow further; keep items
+    if (h + 1 == sk->levels) sk->levels++;
+
+    int *items = sk->items[h];
+    int n = sk->size[h];
+    qsort(items, (size_t)n, sizeof(*items), compare_int);
+
+    // with an odd count the smallest item stays behind at this level
+    int start = n & 1;
+    for (int i = start + coin(sk); i < n; i += 2) {
+        if (!push_item(sk, h + 1, items[i])) return 0;
+    }
+    sk->size[h] = start;
+    return 1;
+}
+
+// compact the lowest full level until the sketch fits its budget again
+static int compress(QuantileSketch *sk) {
+    for (;;) {
+        long total = 0, budget = 0;
+        for (int h = 0; h < sk->levels; ++h) {
+            total += sk->size[h];
+            budget += level_capacity(sk, h);
+        }
+        if (total < budget) return 1;
+
+        int h = 0;
+        while (h < sk->levels && sk->size[h] < level_capacity(sk, h)) h++;
+        if (h == sk->levels) return 1;
+        if (h + 1 >= SKETCH_MAX_LEVELS) return 1;
+        if (!compact_level(sk, h)) return 0;
+    }
+}
+
+void sketchInit(QuantileSketch *sk, int k) {
+    memset(sk, 0, sizeof(*sk));
+    sk->k = k >= 8 ? k : SKETCH_DEFAULT_K;
+    sk->levels = 1;
+    sk->rng = 0x9E3779B9u;
+}
+
+void sketchFree(QuantileSketch *sk) {
+    for (int h = 0; h < SKETCH_MAX_LEVELS; ++h) free(sk->items[h]);
+    memset(sk, 0, sizeof(*sk));
+}
+
+int sketchAdd(QuantileSketch *sk, int value) {
+    if (!push_item(sk, 0, value)) return 0;
+    sk->n++;
+    if (sk->size[0] >= level_capacity(sk, 0)) return compress(sk);
+    return 1;
+}
+
+int sketchMerge(QuantileSketch *dst, const QuantileSketch *src) {
+    while (dst->levels < src->levels) dst->levels++;
+    for (int h = 0; h < src->levels; ++h) {
+        for (int i = 0; i < src->size[h]; ++i) {
+            if (!push_item(dst, h, src->items[h][i])) return 0;
+        }
+    }
+    dst->n += src->n;
+    return compress(dst);
+}
+
+int sketchQuantiles(const QuantileSketch *sk, const double q[], int nq, int out[]) {
+    if (!sk || sk->n == 0) return 0;
+
+    long total = 0;
+    for (int h = 0; h < sk->levels; ++h) total += sk->size[h];
+    ArenaMark mark = arenaMark();
+    WeightedItem *all = arenaAlloc((size_t)total * sizeof(*all));
+    if (!all) return 0;
+
+    long pos = 0, weight_sum = 0;
+    for (int h = 0; h < sk->levels; ++h) {
+        for (int i = 0; i < sk->size[h]; ++i) {
+            all[pos].value = sk->items[h][i];
+            all[pos].weight = 1L << h;
+            weight_sum += all[pos].weight;
+            pos++;
+        }
+    }
+    qsort(all, (size_t)total, sizeof(*all), compare_weighted);
+
+    for (int j = 0; j < nq; ++j) {
+        // nearest rank, scaled to the retained weight
+        double target = q[j] * (double)weight_sum;
+        long cumulative = 0;
+        out[j] = all[total - 1].value;
+        for (long i = 0; i < total; ++i) {
+            cumulative += all[i].weight;
+            if ((double)cumulative >= target) {
+                out[j] = all[i].value;
+                break;
+            }
+        }
+    }
+
+    arenaRelease(mark);
+    return 1;
+}
@@ -0,0 +1,35 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+// KLL quantile sketch over integer values (marks in tenths).
+// Memory stays at O(k log(n/k)) items however many values are added, and
+// two sketches can be merged, so a CSV can be summarised while it streams
+// past without keeping its rows. Rank error is roughly 1.7/k of n.
+
+#define SKETCH_MAX_LEVELS 32
+#define SKETCH_DEFAULT_K 200
+
+typedef struct {
+    int k;
+    int levels;                          // levels in use (level 0 is the input buffer)
+    int *items[SKETCH_MAX_LEVELS];       // items at level h each stand for 2^h inputs
+    int size[SKETCH_MAX_LEVELS];
+    int alloc[SKETCH_MAX_LEVELS];
+    long n;                              // number of values added
+    unsigned rng;                        // coin flips for compaction
+} QuantileSketch;
+
+void sketchInit(QuantileSketch *sk, int k);
+void sketchFree(QuantileSketch *sk);
+
+// Add one value. Returns 0 when out of memory.
+int sketchAdd(QuantileSketch *sk, int value);
+
+// Fold src into dst (src is left unchanged). Returns 0 when out of memory.
+int sketchMerge(QuantileSketch *dst, const QuantileSketch *src);
+
+// Approximate values at nearest ranks ceil(q[i] * n), q[i] in [0, 1],
+// written to out[i]. Returns 0 when the sketch is empty or out of memory.
+int sketchQuantiles(const QuantileSketch *sk, const double q[], int nq, int out[]);
+
+#endif
@@ -0,0 +1,209 @@
+// slotmap.c - row -> file line bookkeeping for in-place SAVE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "slotmap.h"
+#include "records.h"
+
+static int active = 0;
+static char file_name[256];
+static int slot_width = 0;
+static int slot_count = 0;      // lines in the file
+
+static int row_slot[MAX_RECORDS];
+static int pending = 0;         // rows with NO_SLOT
+
+static uint64_t *dirty = NULL;  // one bit per slot
+static int dirty_words = 0;
+static int dirty_count = 0;
+
+static int *free_slots = NULL;  // blanked lines a new row may take
+static int free_count = 0;
+static int free_cap = 0;
+
+void slotMapForget(void) {
+    active = 0;
+    free(dirty);
+    free(free_slots);
+    dirty = NULL;
+    free_slots = NULL;
+    dirty_words = dirty_count = 0;
+    free_count = free_cap = 0;
+    pending = 0;
+    slot_count = 0;
+}
+
+static int grow_dirty(int slots) {
+    int words = (slots + 63) / 64;
+    if (words <= dirty_words) return 1;
+    int cap = dirty_words ? dirty_words : 64;
+    while (cap < words) cap *= 2;
+    uint64_t *grown = realloc(dirty, (size_t)cap * sizeof(*grown));
+    if (!grown) return 0;
+    memset(grown + dirty_words, 0, (size_t)(cap - dirty_words) * sizeof(*grown));
+    dirty = grown;
+    dirty_words = cap;
+    return 1;
+}
+
+static void mark_dirty(int slot) {
+    uint64_t bit = (uint64_t)1 << (slot & 63);
+    if (!(dirty[slot >> 6] & bit)) {
+        dirty[slot >> 6] |= bit;
+        dirty_count++;
+    }
+}
+
+static int push_free(int slot) {
+    if (free_count == free_cap) {
+        int cap = free_cap ? free_cap * 2 : 64;
+        int *grown = realloc(free_slots, (size_t)cap * sizeof(*grown));
+        if (!grown) {
+            slotMapForget();
+            return 0;
+        }
+        free_slots = grown;
+        free_cap = cap;
+    }
+    free_slots[free_count++] = slot;
+    return 1;
+}
+
+// the old row's line becomes blank and reusable
+static void release_slot(int slot) {
+    if (slot == NO_SLOT) {
+        pending--;
+        return;
+    }
+    if (push_free(slot)) mark_dirty(slot);
+}
+
+int slotMapStart(const char *filename) {
+    slotMapForget();
+    strncpy(file_name, filename, sizeof(file_name) - 1);
+    file_name[sizeof(file_name) - 1] = '\0';
+    return 1;
+}
+
+void slotMapPlace(int row, int slot) {
+    row_slot[row] = slot;
+}
+
+int slotMapAddFree(int slot) {
+    // a blank line needs no rewrite, so it is free but not dirty
+    return push_free(slot);
+}
+
+int slotMapFinish(int slots, int width) {
+    slot_count = slots;
+    slot_width = width;
+    if (!grow_dirty(slots > 0 ? slots : 1)) {
+        slotMapForget();
+        return 0;
+    }
+    active = 1;
+    return 1;
+}
+
+int slotMapAdopt(const char *filename, int width, int count) {
+    slotMapStart(filename);
+    for (int i = 0; i < count; ++i) row_slot[i] = i;
+    return slotMapFinish(count, width);
+}
+
+void slotMapInserted(int index, int count) {
+    if (!active) return;
+    memmove(&row_slot[index + 1], &row_slot[index], (size_t)(count - 1 - index) * sizeof(*row_slot));
+    row_slot[index] = NO_SLOT;
+    pending++;
+}
+
+void slotMapUpdated(int index) {
+    if (active && row_slot[index] != NO_SLOT) mark_dirty(row_slot[index]);
+}
+
+void slotMapRemoved(int index, int count) {
+    if (!active) return;
+    release_slot(row_slot[index]);
+    if (!active) return;
+    memmove(&row_slot[index], &row_slot[index + 1], (size_t)(count - index) * sizeof(*row_slot));
+}
+
+void slotMapRemovedRows(const int rows[], int n, int count) {
+    if (!active || n <= 0) return;
+    for (int k = 0; k < n && active; ++k) release_slot(row_slot[rows[k]]);
+    if (!active) return;
+    // same compaction as the table; count is the size after it
+    int out = rows[0], k = 0;
+    for (int i = rows[0]; out < count; ++i) {
+        if (k < n && rows[k] == i) {
+            k++;
+            continue;
+        }
+        row_slot[out++] = row_slot[i];
+    }
+}
+
+int slotMapReady(const char *filename) {
+    return active && strcmp(filename, file_name) == 0;
+}
+
+int slotMapWidth(void) {
+    return slot_width;
+}
+
+int slotMapSlots(void) {
+    return slot_count;
+}
+
+int slotMapAssign(int count) {
+    if (pending == 0) return 1;
+    for (int i = 0; i < count && pending > 0; ++i) {
+        if (row_slot[i] != NO_SLOT) continue;
+        int slot = free_count > 0 ? free_slots[--free_count] : slot_count++;
+        if (!grow_dirty(slot_count)) {
+            slotMapForget();
+            return 0;
+        }
+        row_slot[i] = slot;
+        mark_dirty(slot);
+        pending--;
+    }
+    return 1;
+}
+
+int slotOfRow(int row) {
+    return row_slot[row];
+}
+
+int slotIsDirty(int slot) {
+    return (dirty[slot >> 6] >> (slot & 63)) & 1;
+}
+
+int slotMapDirtyCount(void) {
+    return dirty_count;
+}
+
+int slotMapNextDirty(int from) {
+    if (dirty_count == 0 || from >= slot_count) return NO_SLOT;
+    int w = from >> 6;
+    uint64_t bits = dirty[w] & (~(uint64_t)0 << (from & 63));
+    for (;;) {
+        if (bits) {
+            int slot = w << 6;
+            while (!(bits & 1)) {
+                bits >>= 1;
+                slot++;
+            }
+            return slot < slot_count ? slot : NO_SLOT;
+        }
+        if (++w >= (slot_count + 63) / 64) return NO_SLOT;
+        bits = dirty[w];
+    }
+}
+
+void slotMapClean(void) {
+    if (dirty) memset(dirty, 0, (size_t)dirty_words * sizeof(*dirty));
+    dirty_count = 0;
+}
@@ -0,0 +1,54 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+// Which line ("slot") of the database file holds each table row, so SAVE can
+// rewrite only what changed. SAVE writes every row padded to one fixed line
+// width; from then on the row edits in records.c mark the slots they touch
+// dirty. A deleted row's slot is blanked and later reused by a new row, and
+// new rows beyond the free slots go at the end of the file.
+//
+// While no layout is known (a file with variable-width lines, or a table
+// rewritten directly) the hooks do nothing and SAVE rewrites the whole file.
+
+#define NO_SLOT (-1)
+
+// Drop the layout: the next SAVE rewrites the whole file.
+void slotMapForget(void);
+
+// Describe a file of lines that are all width bytes long (newline included):
+// start, place every row and free slot, then finish with the number of lines.
+// Returns 0 when out of memory (the layout is then forgotten).
+int slotMapStart(const char *filename);
+void slotMapPlace(int row, int slot);
+int slotMapAddFree(int slot);
+int slotMapFinish(int slots, int width);
+
+// The file was just written with row i on line i, all clean.
+int slotMapAdopt(const char *filename, int width, int count);
+
+// Row edit hooks, called by records.c with the index the edit used.
+void slotMapInserted(int index, int count);
+void slotMapUpdated(int index);
+void slotMapRemoved(int index, int count);
+void slotMapRemovedRows(const int rows[], int n, int count);
+
+// True when filename is the file the layout describes.
+int slotMapReady(const char *filename);
+int slotMapWidth(void);
+int slotMapSlots(void);
+
+// Give every row not yet in the file a slot: freed slots first, then new
+// slots at the end. Returns 0 when out of memory (layout forgotten).
+int slotMapAssign(int count);
+
+int slotOfRow(int row);
+int slotIsDirty(int slot);
+int slotMapDirtyCount(void);
+
+// First dirty slot >= from, or NO_SLOT.
+int slotMapNextDirty(int from);
+
+// Everything dirty has been written.
+void slotMapClean(void);
+
+#endif
@@ -0,0 +1,362 @@
+// snapshot.c - compressed binary snapshot of the table
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "arena.h"
+#include "dict.h"
+#include "lz.h"
+#include "marks.h"
+#include "names.h"
+#include "psort.h"
+#include "settings.h"
+
+#define SNAPSHOT_MAGIC "CMSSNAP1"
+#define MAGIC_LEN 8
+#define BLOCK_ROWS 4096
+#define MAX_PAYLOAD (64u << 20)     // sanity limit when reading a block
+#define MARK_BITS 10                // 0..1000 tenths fit in 10 bits
+
+// ---- encoding helpers ----
+
+static uint8_t *put_varint(uint8_t *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static int get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v) {
+    uint64_t out = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p >= end) return 0;
+        uint8_t b = *(*p)++;
+        out |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = out;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int read_varint(FILE *fp, uint64_t *v) {
+    uint64_t out = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = getc(fp);
+        if (c == EOF) return 0;
+        out |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *v = out;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// signed deltas: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// FNV-1a, enough to notice a damaged block
+static uint32_t checksum(const uint8_t *p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+int isSnapshotFile(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+    char magic[MAGIC_LEN];
+    int is = fread(magic, 1, MAGIC_LEN, fp) == MAGIC_LEN && memcmp(magic, SNAPSHOT_MAGIC, MAGIC_LEN) == 0;
+    fclose(fp);
+    return is;
+}
+
+// ---- writing ----
+
+// Encode rows items[0..n) into payload; returns its length.
+static size_t encode_block(const StudentRecord records[], const SortItem items[], int n, int32_t *prev_id,
+                           uint8_t *payload, uint8_t *names) {
+    uint8_t *p = payload;
+
+    // IDs as deltas from the previous row (the first from the previous block)
+    for (int k = 0; k < n; ++k) {
+        int32_t id = records[items[k].idx].id;
+        p = put_varint(p, zigzag((int64_t)id - *prev_id));
+        *prev_id = id;
+    }
+
+    // marks, MARK_BITS each, packed low bits first
+    uint32_t acc = 0;
+    int bits = 0;
+    for (int k = 0; k < n; ++k) {
+        acc |= (uint32_t)records[items[k].idx].mark << bits;
+        bits += MARK_BITS;
+        while (bits >= 8) {
+            *p++ = (uint8_t)acc;
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    if (bits > 0) *p++ = (uint8_t)acc;
+
+    for (int k = 0; k < n; ++k) p = put_varint(p, records[items[k].idx].prog);
+
+    // name lengths, then all the name text as one compressed run
+    size_t raw = 0;
+    for (int k = 0; k < n; ++k) {
+        const StudentRecord *r = &records[items[k].idx];
+        p = put_varint(p, r->name_len);
+        memcpy(names + raw, recordName(r), r->name_len);
+        raw += r->name_len;
+    }
+    p = put_varint(p, raw);
+
+    // compressed size as 4 fixed bytes, 0 when the text did not shrink and
+    // is stored as is
+    uint8_t *size_at = p;
+    p += 4;
+    size_t packed = lzCompress(names, raw, p, LZ_BOUND(raw));
+    if (packed == 0 || packed >= raw) {
+        memcpy(p, names, raw);
+        p += raw;
+        packed = 0;
+    } else {
+        p += packed;
+    }
+    for (int b = 0; b < 4; ++b) size_at[b] = (uint8_t)(packed >> (8 * b));
+    return (size_t)(p - payload);
+}
+
+int saveSnapshot(const char *path, const StudentRecord records[], int count, long *bytes) {
+    ArenaMark mark = arenaMark();
+    SortItem *items = arenaAlloc((size_t)(count > 0 ? count : 1) * sizeof(*items));
+    if (!items) {
+        printf("CMS: ERROR: Out of memory.\n");
+        return 0;
+    }
+    for (int i = 0; i < count; ++i) {
+        items[i].key = sortKey32(records[i].id, 1);
+        items[i].idx = i;
+    }
+    sortItems(items, count, NULL, NULL, getSetting(SETTING_SORT_PARALLEL_ROWS));
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        printf("CMS: ERROR: Cannot write snapshot \"%s\".\n", path);
+        arenaRelease(mark);
+        return 0;
+    }
+
+    // header and programme dictionary (file codes are the in-memory codes)
+    int progs = programmeCount();
+    uint8_t head[32];
+    int ok = fwrite(SNAPSHOT_MAGIC, 1, MAGIC_LEN, fp) == MAGIC_LEN;
+    size_t hl = (size_t)(put_varint(put_varint(head, (uint64_t)count), (uint64_t)progs) - head);
+    ok = ok && fwrite(head, 1, hl, fp) == hl;
+    for (int c = 0; c < progs && ok; ++c) {
+        const char *name = programmeName((uint16_t)c);
+        size_t len = strlen(name);
+        hl = (size_t)(put_varint(head, len) - head);
+        ok = fwrite(head, 1, hl, fp) == hl && fwrite(name, 1, len, fp) == len;
+    }
+
+    ArenaMark block_mark = arenaMark();     // each block's buffers go back here
+    int32_t prev_id = 0;
+    for (int start = 0; start < count && ok; start += BLOCK_ROWS) {
+        arenaRelease(block_mark);
+        int n = count - start < BLOCK_ROWS ? count - start : BLOCK_ROWS;
+        size_t raw = 0;
+        for (int k = 0; k < n; ++k) raw += records[items[start + k].idx].name_len;
+
+        // worst case: 5-byte IDs, 3-byte codes and lengths, incompressible names
+        size_t need = (size_t)n * 11 + (size_t)n * MARK_BITS / 8 + 32 + LZ_BOUND(raw);
+        uint8_t *payload = arenaAlloc(need);
+        uint8_t *names = arenaAlloc(raw + 1);
+        if (!payload || !names) {
+            printf("CMS: ERROR: Out of memory.\n");
+            ok = 0;
+            break;
+        }
+
+        size_t len = encode_block(records, items + start, n, &prev_id, payload, names);
+        uint32_t sum = checksum(payload, len);
+        uint8_t *h = put_varint(put_varint(head, (uint64_t)n), len);
+        for (int b = 0; b < 4; ++b) *h++ = (uint8_t)(sum >> (8 * b));
+        hl = (size_t)(h - head);
+        ok = fwrite(head, 1, hl, fp) == hl && fwrite(payload, 1, len, fp) == len;
+    }
+    arenaRelease(mark);
+
+    long size = ok ? ftell(fp) : -1;
+    if (fclose(fp) == EOF) ok = 0;
+    if (!ok) {
+        printf("CMS: ERROR: Writing snapshot \"%s\" failed.\n", path);
+        return 0;
+    }
+    if (bytes) *bytes = size;
+    return 1;
+}
+
+// ---- reading ----
+
+// Decode one block into the table. Returns 0 when the block is malformed.
+static int decode_block(const uint8_t *p, const uint8_t *end, int n, int32_t *prev_id,
+                        const int prog_map[], int progs, StudentRecord records[], int *count) {
+    int first = *count;
+    for (int k = 0; k < n; ++k) {
+        uint64_t v;
+        if (!get_varint(&p, end, &v)) return 0;
+        int64_t id = (int64_t)*prev_id + unzigzag(v);
+        if (id < INT32_MIN || id > INT32_MAX) return 0;
+        *prev_id = (int32_t)id;
+        records[first + k].id = (int32_t)id;
+    }
+
+    if ((size_t)(end - p) < ((size_t)n * MARK_BITS + 7) / 8) return 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (int k = 0; k < n; ++k) {
+        while (bits < MARK_BITS) {
+            acc |= (uint32_t)*p++ << bits;
+            bits += 8;
+        }
+        int mark = (int)(acc & ((1u << MARK_BITS) - 1));
+        acc >>= MARK_BITS;
+        bits -= MARK_BITS;
+        if (mark > MARK_MAX) return 0;
+        records[first + k].mark = (int16_t)mark;
+    }
+
+    for (int k = 0; k < n; ++k) {
+        uint64_t code;
+        if (!get_varint(&p, end, &code) || code >= (uint64_t)progs) return 0;
+        records[first + k].prog = (uint16_t)prog_map[code];
+    }
+
+    // name lengths go into name_len for now; the text is attached below
+    uint64_t total = 0;
+    for (int k = 0; k < n; ++k) {
+        uint64_t len;
+        if (!get_varint(&p, end, &len) || len > UINT16_MAX) return 0;
+        records[first + k].name_len = (uint16_t)len;
+        total += len;
+    }
+    uint64_t raw;
+    if (!get_varint(&p, end, &raw) || raw != total || end - p < 4) return 0;
+    size_t packed = (size_t)p[0] | (size_t)p[1] << 8 | (size_t)p[2] << 16 | (size_t)p[3] << 24;
+    p += 4;
+    size_t stored = packed ? packed : (size_t)raw;  // 0: the text was kept as is
+    if (stored != (size_t)(end - p)) return 0;
+
+    ArenaMark mark = arenaMark();
+    uint8_t *text = arenaAlloc((size_t)raw + 1);
+    if (!text) return 0;
+    int ok = 1;
+    if (packed) ok = lzDecompress(p, packed, text, (size_t)raw);
+    else memcpy(text, p, (size_t)raw);
+    size_t off = 0;
+    for (int k = 0; k < n && ok; ++k) {
+        StudentRecord *r = &records[first + k];
+        size_t len = r->name_len;
+        uint8_t keep = text[off + len];
+        text[off + len] = '\0';
+        ok = storeRecordName(r, (const char *)text + off);
+        text[off + len] = keep;
+        off += len;
+    }
+    arenaRelease(mark);
+    if (ok) *count += n;
+    return ok;
+}
+
+int loadSnapshot(const char *path, StudentRecord records[], int *count) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        printf("CMS: Unable to open file '%s'\n", path);
+        return 0;
+    }
+
+    *count = 0;
+    resetNames();
+    tableReloaded();
+
+    char magic[MAGIC_LEN];
+    uint64_t rows = 0, progs = 0;
+    if (fread(magic, 1, MAGIC_LEN, fp) != MAGIC_LEN || memcmp(magic, SNAPSHOT_MAGIC, MAGIC_LEN) != 0 ||
+        !read_varint(fp, &rows) || !read_varint(fp, &progs) || progs > MAX_PROGRAMMES) {
+        printf("CMS: '%s' is not a snapshot file.\n", path);
+        fclose(fp);
+        return 0;
+    }
+    if (rows > MAX_RECORDS) {
+        printf("CMS: Snapshot '%s' has %llu rows; this build holds %d.\n", path, (unsigned long long)rows, MAX_RECORDS);
+        fclose(fp);
+        return 0;
+    }
+
+    // file programme codes -> codes in this run's dictionary
+    ArenaMark mark = arenaMark();
+    int *prog_map = arenaAlloc((size_t)(progs > 0 ? progs : 1) * sizeof(*prog_map));
+    int ok = prog_map != NULL;
+    for (uint64_t c = 0; c < progs && ok; ++c) {
+        uint64_t len;
+        char name[512];
+        ok = read_varint(fp, &len) && len < sizeof(name) && fread(name, 1, (size_t)len, fp) == len;
+        if (ok) {
+            name[len] = '\0';
+            prog_map[c] = internProgramme(name);
+            ok = prog_map[c] >= 0;
+        }
+    }
+
+    ArenaMark block_mark = arenaMark();     // each block's payload goes back here
+    uint8_t *payload = NULL;
+    int32_t prev_id = 0;
+    int block = 0;
+    while (ok && (uint64_t)*count < rows) {
+        arenaRelease(block_mark);
+        uint64_t n, len;
+        uint8_t sum_bytes[4];
+        ok = read_varint(fp, &n) && read_varint(fp, &len) && fread(sum_bytes, 1, 4, fp) == 4 &&
+             n > 0 && n <= BLOCK_ROWS && (uint64_t)*count + n <= rows && len <= MAX_PAYLOAD;
+        if (ok) {
+            payload = arenaAlloc((size_t)len);
+            ok = payload != NULL;
+        }
+        ok = ok && fread(payload, 1, (size_t)len, fp) == len;
+        if (ok) {
+            uint32_t sum = (uint32_t)sum_bytes[0] | (uint32_t)sum_bytes[1] << 8 |
+                           (uint32_t)sum_bytes[2] << 16 | (uint32_t)sum_bytes[3] << 24;
+            ok = checksum(payload, (size_t)len) == sum &&
+                 decode_block(payload, payload + len, (int)n, &prev_id, prog_map, (int)progs, records, count);
+        }
+        block++;
+    }
+    arenaRelease(mark);
+    fclose(fp);
+
+    if (!ok) {
+        printf("CMS: Snapshot '%s' is damaged or truncated (block %d).\n", path, block);
+        *count = 0;
+        resetNames();
+        return 0;
+    }
+
+    // IDs are the primary key: index them and keep the first row of any repeat
+    int dropped = rebuildIdIndex(records, count);
+    if (dropped > 0) {
+        printf("CMS: WARNING: %d row(s) in '%s' repeat an earlier ID and were skipped.\n", dropped, path);
+    }
+    return 1;
+}
@@ -0,0 +1,23 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "records.h"
+
+// Compressed binary snapshot of the table. Rows are stored in ID order in
+// blocks of up to 4096 rows. Within a block, IDs are delta and varint
+// encoded, marks packed as 10-bit tenths, programmes stored as dictionary
+// codes, and the names compressed together with lz.h. Each block carries a
+// checksum. Files start with "CMSSNAP1".
+
+// True when the file at path starts with the snapshot magic.
+int isSnapshotFile(const char *path);
+
+// Returns 1 on success; otherwise prints the reason and returns 0. On
+// success *bytes (if not NULL) gets the file size.
+int saveSnapshot(const char *path, const StudentRecord records[], int count, long *bytes);
+
+// Replace the table with the snapshot's rows. Returns 1 on success;
+// otherwise prints the reason and returns 0.
+int loadSnapshot(const char *path, StudentRecord records[], int *count);
+
+#endif
@@ -1,13 +1,256 @@
-// sort.c - bubble sort algo for show all command 
+// sort.c - stable multi-key (optionally parallel) sort for SHOW ALL SORT BY,
+// bounded heap for SHOW TOP
 
+#include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "records.h"
 #include "sort.h"
+#include "psort.h"
+#include "settings.h"
+#include "names.h"
+#include "dict.h"
+#include "views.h"
+#include "arena.h"
 
 
-void sort_and_print(const StudentRecord records[], int count, int by_id, int asc)
+// Width in bytes of each field's slot in the packed row key. Names only keep
+// a prefix; the other fields are exact.
+#define NAME_PREFIX 8
+
+static int iequals(const char *a, const char *b)
+{
+    while (*a && *b) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return 0;
+        a++; b++;
+    }
+    return *a == *b;
+}
+
+static int key_width(SortField f)
+{
+    switch (f) {
+    case SORT_ID:        return 4;
+    case SORT_NAME:      return NAME_PREFIX;
+    case SORT_PROGRAMME: return 2;
+    case SORT_MARK:      return 2;
+    }
+    return 0;
+}
+
+int parseSortSpec(const char *text, SortSpec *spec, char *err, size_t err_size)
+{
+    char buf[128];
+    strncpy(buf, text ? text : "", sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    spec->n = 0;
+
+    for (char *part = strtok(buf, ","); part; part = strtok(NULL, ",")) {
+        char word[16] = { 0 }, order[16] = { 0 }, extra[2] = { 0 };
+        int got = sscanf(part, "%15s %15s %1s", word, order, extra);
+        if (got < 1) {
+            snprintf(err, err_size, "empty sort key");
+            return 0;
+        }
+        if (got == 3) {
+            snprintf(err, err_size, "unexpected text after '%s %s'", word, order);
+            return 0;
+        }
+        if (spec->n == MAX_SORT_KEYS) {
+            snprintf(err, err_size, "at most %d sort keys", MAX_SORT_KEYS);
+            return 0;
+        }
+
+        SortField f;
+        if (iequals(word, "ID")) f = SORT_ID;
+        else if (iequals(word, "NAME")) f = SORT_NAME;
+        else if (iequals(word, "PROGRAMME")) f = SORT_PROGRAMME;
+        else if (iequals(word, "MARK")) f = SORT_MARK;
+        else {
+            snprintf(err, err_size, "invalid sort field '%s'. Use ID, NAME, PROGRAMME or MARK", word);
+            return 0;
+        }
+
+        int asc = 1;
+        if (got == 2) {
+            if (iequals(order, "DESC")) asc = 0;
+            else if (!iequals(order, "ASC")) {
+                snprintf(err, err_size, "unknown sort order '%s'. Use ASC or DESC", order);
+                return 0;
+            }
+        }
+        spec->field[spec->n] = f;
+        spec->asc[spec->n] = asc;
+        spec->n++;
+    }
+
+    if (spec->n == 0) {
+        snprintf(err, err_size, "no sort field given");
+        return 0;
+    }
+    return 1;
+}
+
+// compare two strings ignoring ASCII case, byte values as unsigned
+static int fold_compare(const char *a, const char *b)
+{
+    for (;; ++a, ++b) {
+        int ca = tolower((unsigned char)*a), cb = tolower((unsigned char)*b);
+        if (ca != cb || ca == 0) return ca - cb;
+    }
+}
+
+typedef struct {
+    const StudentRecord *records;
+    const SortSpec *spec;
+    const unsigned char *keys;  // width bytes per row
+    int width;
+} RowKeys;
+
+// Tie-break for rows whose first 8 key bytes match: walk the packed key field
+// by field, and when two name prefixes match compare the full names before
+// moving on to the next field.
+static int compare_rows(int a, int b, const void *ctx)
+{
+    const RowKeys *rk = ctx;
+    const unsigned char *ka = rk->keys + (size_t)a * rk->width;
+    const unsigned char *kb = rk->keys + (size_t)b * rk->width;
+    for (int k = 0; k < rk->spec->n; ++k) {
+        int w = key_width(rk->spec->field[k]);
+        int c = memcmp(ka, kb, (size_t)w);
+        if (c != 0) return c;
+        if (rk->spec->field[k] == SORT_NAME) {
+            c = fold_compare(recordName(&rk->records[a]), recordName(&rk->records[b]));
+            if (c != 0) return rk->spec->asc[k] ? c : -c;
+        }
+        ka += w;
+        kb += w;
+    }
+    return 0;
+}
+
+static int compare_programme_codes(const void *pa, const void *pb)
+{
+    return fold_compare(programmeName(*(const uint16_t *)pa), programmeName(*(const uint16_t *)pb));
+}
+
+// Collation rank of every programme code: programmes that differ only in
+// case share a rank. The table is arena memory (arena.h). Returns NULL when
+// out of memory.
+static uint16_t *programme_ranks(void)
+{
+    int n = programmeCount();
+    uint16_t *codes = arenaAlloc((size_t)n * sizeof(*codes));
+    uint16_t *rank = arenaAlloc((size_t)n * sizeof(*rank));
+    if (!codes || !rank) return NULL;
+    for (int i = 0; i < n; ++i) codes[i] = (uint16_t)i;
+    qsort(codes, (size_t)n, sizeof(*codes), compare_programme_codes);
+    uint16_t r = 0;
+    for (int i = 0; i < n; ++i) {
+        if (i > 0 && compare_programme_codes(&codes[i - 1], &codes[i]) != 0) r++;
+        rank[codes[i]] = r;
+    }
+    return rank;
+}
+
+// Write the big-endian low `bytes` bytes of v, inverted for a descending key.
+static void put_key(unsigned char *p, uint32_t v, int bytes, int asc)
+{
+    if (!asc) v = ~v;
+    for (int i = bytes - 1; i >= 0; --i) {
+        p[i] = (unsigned char)v;
+        v >>= 8;
+    }
+}
+
+int buildSortedOrder(const StudentRecord records[], int count, const SortSpec *spec, int perm[])
+{
+    // Build each row's packed, case-folded key once. Byte order of the key is
+    // the sort order, so its first 8 bytes settle most comparisons.
+    int width = 0;
+    int uses_programme = 0;
+    for (int k = 0; k < spec->n; ++k) {
+        width += key_width(spec->field[k]);
+        uses_programme |= spec->field[k] == SORT_PROGRAMME;
+    }
+    int row_width = width < 8 ? 8 : width;
+
+    ArenaMark mark = arenaMark();
+    SortItem *order = arenaAlloc((size_t)count * sizeof(*order));
+    unsigned char *keys = arenaCalloc((size_t)count, (size_t)row_width);
+    uint16_t *ranks = uses_programme ? programme_ranks() : NULL;
+    if (!order || !keys || (uses_programme && !ranks)) {
+        arenaRelease(mark);
+        return 0;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const StudentRecord *r = &records[i];
+        unsigned char *p = keys + (size_t)i * row_width;
+        for (int k = 0; k < spec->n; ++k) {
+            int asc = spec->asc[k];
+            switch (spec->field[k]) {
+            case SORT_ID:
+                put_key(p, (uint32_t)r->id ^ 0x80000000u, 4, asc);
+                break;
+            case SORT_MARK:
+                put_key(p, (uint32_t)(r->mark + 32768), 2, asc);
+                break;
+            case SORT_PROGRAMME:
+                put_key(p, ranks[r->prog], 2, asc);
+                break;
+            case SORT_NAME: {
+                // short names pad with 0, which sorts them before longer ones
+                const char *name = recordName(r);
+                int j = 0;
+                for (; j < NAME_PREFIX && name[j]; ++j) p[j] = (unsigned char)tolower((unsigned char)name[j]);
+                for (; j < NAME_PREFIX; ++j) p[j] = 0;
+                if (!asc) for (j = 0; j < NAME_PREFIX; ++j) p[j] = (unsigned char)~p[j];
+                break;
+            }
+            }
+            p += key_width(spec->field[k]);
+        }
+
+        uint64_t head = 0;
+        const unsigned char *q = keys + (size_t)i * row_width;
+        for (int j = 0; j < 8; ++j) head = head << 8 | q[j];
+        order[i].key = head;
+        order[i].idx = i;
+    }
+
+    // rows that fit entirely in the 8-byte head need no tie-break beyond the index
+    int needs_tie = width > 8;
+    for (int k = 0; k < spec->n; ++k) needs_tie |= spec->field[k] == SORT_NAME;
+
+    RowKeys rk = { records, spec, keys, row_width };
+    int ok = sortItems(order, count, needs_tie ? compare_rows : NULL, &rk, getSetting(SETTING_SORT_PARALLEL_ROWS));
+    if (ok) {
+        for (int i = 0; i < count; ++i) perm[i] = order[i].idx;
+    }
+    arenaRelease(mark);
+    return ok;
+}
+
+int compareRowsBySpec(const StudentRecord records[], const SortSpec *spec, int a, int b)
+{
+    const StudentRecord *ra = &records[a], *rb = &records[b];
+    for (int k = 0; k < spec->n; ++k) {
+        int c = 0;
+        switch (spec->field[k]) {
+        case SORT_ID:        c = (ra->id > rb->id) - (ra->id < rb->id); break;
+        case SORT_MARK:      c = (ra->mark > rb->mark) - (ra->mark < rb->mark); break;
+        case SORT_PROGRAMME: c = fold_compare(programmeName(ra->prog), programmeName(rb->prog)); break;
+        case SORT_NAME:      c = fold_compare(recordName(ra), recordName(rb)); break;
+        }
+        if (c != 0) return spec->asc[k] ? c : -c;
+    }
+    return (a > b) - (a < b);
+}
+
+void sort_by_spec_and_print(const StudentRecord records[], int count, const SortSpec *spec)
 {
     if (!records) {
         printf("CMS: ERROR: Internal error (no records buffer).\n");
@@ -20,54 +263,113 @@ void sort_and_print(const StudentRecord records[], int count, int by_id, int asc
         return;
     }
 
-    // Make a local copy so we don't change the original array.
-    StudentRecord records_copy[MAX_RECORDS];
+    // reuses the last ordering for this spec when the table has not moved on
+    const int *perm = sortedView(records, count, spec);
+    if (!perm) {
+        printf("CMS: ERROR: Out of memory.\n");
+        return;
+    }
+
+    // Print header and sorted rows (same format as showAllRecords)
+    printf("CMS: Here are all the records found in the table \"StudentRecords\".\n");
+    printf("%-8s %-20s %-24s %s\n", "ID", "Name", "Programme", "Mark");
     for (int i = 0; i < count; ++i) {
-        records_copy[i] = records[i];
+        printRecordRow(&records[perm[i]]);
     }
+}
 
-    // Bubble sort: repeatedly pass through the array and swap adjacent out-of-order items. We stop early if a pass makes no swaps.
+void sort_and_print(const StudentRecord records[], int count, int by_id, int asc)
+{
+    SortSpec spec = { 1, { by_id ? SORT_ID : SORT_MARK }, { asc } };
+    sort_by_spec_and_print(records, count, &spec);
+}
 
-    for (int pass_index = 0; pass_index < count - 1; ++pass_index) {
-        int did_swap = 0; // track whether this pass performed any swaps
+// True when row a is printed before row b. Ties keep table order, so the
+// result matches the first k rows of the (stable) SHOW ALL SORT BY output.
+static int precedes(const StudentRecord records[], int a, int b, int by_id, int asc)
+{
+    int ka = by_id ? records[a].id : records[a].mark;
+    int kb = by_id ? records[b].id : records[b].mark;
+    if (ka != kb) return asc ? (ka < kb) : (ka > kb);
+    return a < b;
+}
 
-        // after pass_index passes, the last pass_index elements are in final position
-        for (int pair_index = 0; pair_index < count - 1 - pass_index; ++pair_index) {
-            StudentRecord *left = &records_copy[pair_index];
-            StudentRecord *right = &records_copy[pair_index + 1];
+// Restore the heap below slot i. The root holds the row that would be printed
+// last, so it is the one evicted when a better row turns up.
+static void sift_down(int heap[], int size, int i, const StudentRecord records[], int by_id, int asc)
+{
+    for (;;) {
+        int last = i;
+        int left = 2 * i + 1, right = left + 1;
+        if (left < size && precedes(records, heap[last], heap[left], by_id, asc)) last = left;
+        if (right < size && precedes(records, heap[last], heap[right], by_id, asc)) last = right;
+        if (last == i) return;
+        int tmp = heap[i]; heap[i] = heap[last]; heap[last] = tmp;
+        i = last;
+    }
+}
 
-            int out_of_order = 0;
-            if (by_id) {
-                // compare by ID
-                if (asc) out_of_order = (left->id > right->id);
-                else     out_of_order = (left->id < right->id);
-            } else {
-                // compare by mark
-                if (asc) out_of_order = (left->mark > right->mark);
-                else     out_of_order = (left->mark < right->mark);
-            }
+static void print_top(const StudentRecord records[], const int rows[], int k, int by_id, int asc)
+{
+    printf("CMS: Here are the top %d records by %s (%s) in the table \"StudentRecords\".\n",
+           k, by_id ? "ID" : "MARK", asc ? "ASC" : "DESC");
+    printf("%-8s %-20s %-24s %s\n", "ID", "Name", "Programme", "Mark");
+    for (int i = 0; i < k; ++i) {
+        printRecordRow(&records[rows[i]]);
+    }
+}
 
-            if (out_of_order) {
-                // swap adjacent elements
-                StudentRecord tmp = *left;
-                *left = *right;
-                *right = tmp;
-                did_swap = 1;
-            }
-        }
+void top_k_and_print(const StudentRecord records[], int count, int k, int by_id, int asc)
+{
+    if (!records) {
+        printf("CMS: ERROR: Internal error (no records buffer).\n");
+        return;
+    }
 
-        // no swaps => array is already sorted
-        if (!did_swap) break;
+    if (k > count) k = count;
+    if (k <= 0) {
+        showAllRecords(records, 0);
+        return;
     }
 
-    // Print header and sorted rows (same format as showAllRecords)
-    printf("CMS: Here are all the records found in the table \"StudentRecords\".\n");
-    printf("%-8s %-20s %-24s %s\n", "ID", "Name", "Programme", "Mark");
+    // A cached sorted view already holds the answer in its first k rows
+    SortSpec spec = { 1, { by_id ? SORT_ID : SORT_MARK }, { asc } };
+    const int *view = cachedView(records, count, &spec);
+    if (view) {
+        print_top(records, view, k, by_id, asc);
+        return;
+    }
+
+    int *heap = arenaAlloc((size_t)k * sizeof(*heap));
+    if (!heap) {
+        printf("CMS: ERROR: Out of memory.\n");
+        return;
+    }
+
+    // Keep the best k rows seen so far in a heap: O(n log k) overall
+    int size = 0;
     for (int i = 0; i < count; ++i) {
-        printf("%-8d %-20s %-24s %.1f\n",
-               records_copy[i].id,
-               records_copy[i].name,
-               records_copy[i].programme,
-               records_copy[i].mark);
+        if (size < k) {
+            // sift up the new row
+            int pos = size++;
+            heap[pos] = i;
+            while (pos > 0) {
+                int parent = (pos - 1) / 2;
+                if (!precedes(records, heap[parent], heap[pos], by_id, asc)) break;
+                int tmp = heap[parent]; heap[parent] = heap[pos]; heap[pos] = tmp;
+                pos = parent;
+            }
+        } else if (precedes(records, i, heap[0], by_id, asc)) {
+            heap[0] = i;
+            sift_down(heap, size, 0, records, by_id, asc);
+        }
     }
-}
\ No newline at end of file
+
+    // Pop the worst row to the back each time, leaving heap[] in print order
+    for (int end = size - 1; end > 0; --end) {
+        int tmp = heap[0]; heap[0] = heap[end]; heap[end] = tmp;
+        sift_down(heap, end, 0, records, by_id, asc);
+    }
+
+    print_top(records, heap, size, by_id, asc);
+}
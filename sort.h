@@ -4,6 +4,39 @@
 
 #include "records.h"
 
+#include <stddef.h>
+
+// Sort keys for SHOW ALL SORT BY, e.g. "PROGRAMME, MARK DESC, NAME".
+#define MAX_SORT_KEYS 4
+
+typedef enum { SORT_ID, SORT_NAME, SORT_PROGRAMME, SORT_MARK } SortField;
+
+typedef struct {
+    int n;
+    SortField field[MAX_SORT_KEYS];
+    int asc[MAX_SORT_KEYS];
+} SortSpec;
+
+// Parse a comma-separated key list. Returns 1 on success, otherwise 0 with a
+// message in err.
+int parseSortSpec(const char *text, SortSpec *spec, char *err, size_t err_size);
+
 void sort_and_print(const StudentRecord records[], int count, int by_id, int asc);
 
+// Print the table ordered by every key of spec in turn; rows equal on all
+// keys keep table order.
+void sort_by_spec_and_print(const StudentRecord records[], int count, const SortSpec *spec);
+
+// Write the row indices of records[0..count) in spec order to perm. Returns 0
+// when out of memory.
+int buildSortedOrder(const StudentRecord records[], int count, const SortSpec *spec, int perm[]);
+
+// Order of rows a and b under spec (<0, >0; never 0 for a != b, the row
+// index breaks ties). Slower than buildSortedOrder's keys; meant for placing
+// a handful of rows.
+int compareRowsBySpec(const StudentRecord records[], const SortSpec *spec, int a, int b);
+
+// Print only the first k rows of the requested order without sorting the table.
+void top_k_and_print(const StudentRecord records[], int count, int k, int by_id, int asc);
+
 #endif
\ No newline at end of file
@@ -1,18 +1,25 @@
 // summary.c contains functions for to show overall statistics
+#include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "records.h"
+#include "names.h"
+#include "marks.h"
+#include "dict.h"
+#include "summary.h"
+#include "threads.h"
+#include "arena.h"
+
+// rows each aggregation thread should get before another thread is worth it
+#define ROWS_PER_WORKER 65536
 
 // compute average mark (returns 0.0 for empty input)
-static float calculateAverageMark(const StudentRecord records[], int count) {
-    if (!records || count <= 0) return 0.0f;
-    double sum = 0.0;                 // use double to reduce rounding error
+static double calculateAverageMark(const StudentRecord records[], int count) {
+    if (!records || count <= 0) return 0.0;
+    long long sum = 0;                // exact: marks are integer tenths
     for (int i = 0; i < count; ++i) sum += records[i].mark;
-    return (float)(sum / count);
-}
-
-// round positive mark to hundredths as an integer (e.g. 85.127 -> 8513)
-static int round_to_hundredths(float m) {
-    return (int)(m * 100.0f + 0.5f);
+    return (double)sum / count / 10.0;
 }
 
 void showSummary(const StudentRecord records[], int count) {
@@ -27,47 +34,45 @@ void showSummary(const StudentRecord records[], int count) {
 
     // find max/min and count pass/fail in one pass
     int passed = 0, failed = 0;
-    float max_mark = records[0].mark; // initialize from first entry (simpler)
-    float min_mark = records[0].mark;
+    int max_mark = records[0].mark; // initialize from first entry (simpler)
+    int min_mark = records[0].mark;
     for (int i = 0; i < count; ++i) {
-        float m = records[i].mark;
+        int m = records[i].mark;
         if (m > max_mark) max_mark = m;
         if (m < min_mark) min_mark = m;
-        if (m >= 50.0f) ++passed;
+        if (m >= MARK_PASS) ++passed;
         else ++failed;
     }
 
-    float avg = calculateAverageMark(records, count);
+    double avg = calculateAverageMark(records, count);
 
     // print basic info
     printf("CMS: SUMMARY: %d record(s)\n", count);
     printf("  Total students: %d\n", count);
-    printf("  Average mark : %.2f\n", (double)avg);
+    printf("  Average mark : %.2f\n", avg);
 
-    // print highest mark and all names tied at two decimal places
+    // print highest mark and all names tied with it
     {
-        int target = round_to_hundredths(max_mark);
-        printf("  Highest mark  : %.2f (", (double)max_mark);
+        printf("  Highest mark  : %.2f (", max_mark / 10.0);
         int first = 1;
         for (int i = 0; i < count; ++i) {
-            if (round_to_hundredths(records[i].mark) == target) {
+            if (records[i].mark == max_mark) {
                 if (!first) printf(", ");
-                printf("%s", records[i].name);
+                printf("%s", recordName(&records[i]));
                 first = 0;
             }
         }
         printf(")\n");
     }
 
-    // print lowest mark and all names tied at two decimal places
+    // print lowest mark and all names tied with it
     {
-        int target = round_to_hundredths(min_mark);
-        printf("  Lowest mark   : %.2f (", (double)min_mark);
+        printf("  Lowest mark   : %.2f (", min_mark / 10.0);
         int first = 1;
         for (int i = 0; i < count; ++i) {
-            if (round_to_hundredths(records[i].mark) == target) {
+            if (records[i].mark == min_mark) {
                 if (!first) printf(", ");
-                printf("%s", records[i].name);
+                printf("%s", recordName(&records[i]));
                 first = 0;
             }
         }
@@ -77,4 +82,253 @@ void showSummary(const StudentRecord records[], int count) {
     // pass/fail counts
     printf("  Passed        : %d\n", passed);
     printf("  Failed        : %d\n", failed);
-}
\ No newline at end of file
+}
+
+// Running aggregate for one programme
+typedef struct {
+    long count;
+    long long sum;      // tenths
+    long passed;
+    int min;
+    int max;
+} GroupAgg;
+
+typedef struct {
+    const StudentRecord *records;
+    long count;
+    int groups;          // number of programme codes
+    GroupAgg *partials;  // groups entries per worker
+} GroupScan;
+
+// Each worker aggregates its slice of the table into its own partial table.
+// Programme codes are dense, so the "hash" is the code itself.
+static void aggregate_slice(void *ctx, int worker, int nworkers) {
+    GroupScan *scan = ctx;
+    GroupAgg *agg = scan->partials + (size_t)worker * scan->groups;
+    long begin, end;
+    workerRange(scan->count, worker, nworkers, &begin, &end);
+
+    for (long i = begin; i < end; ++i) {
+        const StudentRecord *r = &scan->records[i];
+        GroupAgg *g = &agg[r->prog];
+        if (g->count == 0 || r->mark < g->min) g->min = r->mark;
+        if (g->count == 0 || r->mark > g->max) g->max = r->mark;
+        g->count++;
+        g->sum += r->mark;
+        if (r->mark >= MARK_PASS) g->passed++;
+    }
+}
+
+// One output line
+typedef struct {
+    uint16_t prog;
+    GroupAgg agg;
+} GroupRow;
+
+static GroupColumn sort_column;
+static int sort_asc;
+
+static double group_avg(const GroupAgg *g) { return (double)g->sum / g->count; }
+static double group_pass_rate(const GroupAgg *g) { return (double)g->passed / g->count; }
+
+static int compare_groups(const void *pa, const void *pb) {
+    const GroupRow *a = pa, *b = pb;
+    int cmp = 0;
+    switch (sort_column) {
+    case GROUP_COL_COUNT:    cmp = (a->agg.count > b->agg.count) - (a->agg.count < b->agg.count); break;
+    case GROUP_COL_MIN:      cmp = (a->agg.min > b->agg.min) - (a->agg.min < b->agg.min); break;
+    case GROUP_COL_MAX:      cmp = (a->agg.max > b->agg.max) - (a->agg.max < b->agg.max); break;
+    case GROUP_COL_AVG: {
+        double x = group_avg(&a->agg), y = group_avg(&b->agg);
+        cmp = (x > y) - (x < y);
+        break;
+    }
+    case GROUP_COL_PASSRATE: {
+        double x = group_pass_rate(&a->agg), y = group_pass_rate(&b->agg);
+        cmp = (x > y) - (x < y);
+        break;
+    }
+    case GROUP_COL_PROGRAMME:
+        break;
+    }
+    if (!sort_asc) cmp = -cmp;
+    // programme name breaks ties (and is the whole key for GROUP_COL_PROGRAMME)
+    if (cmp == 0) {
+        cmp = strcmp(programmeName(a->prog), programmeName(b->prog));
+        if (sort_column == GROUP_COL_PROGRAMME && !sort_asc) cmp = -cmp;
+    }
+    return cmp;
+}
+
+int groupColumnFromName(const char *name) {
+    static const struct { const char *name; GroupColumn col; } columns[] = {
+        { "PROGRAMME", GROUP_COL_PROGRAMME },
+        { "COUNT",     GROUP_COL_COUNT },
+        { "AVG",       GROUP_COL_AVG },
+        { "AVERAGE",   GROUP_COL_AVG },
+        { "MIN",       GROUP_COL_MIN },
+        { "MAX",       GROUP_COL_MAX },
+        { "PASSRATE",  GROUP_COL_PASSRATE },
+    };
+    if (!name) return -1;
+    for (size_t c = 0; c < sizeof(columns) / sizeof(columns[0]); ++c) {
+        const char *a = name, *b = columns[c].name;
+        while (*a && *b && toupper((unsigned char)*a) == *b) { a++; b++; }
+        if (*a == '\0' && *b == '\0') return (int)columns[c].col;
+    }
+    return -1;
+}
+
+void showSummaryByProgramme(const StudentRecord records[], int count, GroupColumn sort_col, int asc) {
+    if (!records) {
+        printf("CMS: ERROR: Internal error (null records pointer).\n");
+        return;
+    }
+    if (count <= 0) {
+        printf("CMS: The database is empty. No summary available.\n");
+        return;
+    }
+
+    int groups = programmeCount();
+    int nworkers = workerCount(count, ROWS_PER_WORKER);
+    GroupAgg *partials = arenaCalloc((size_t)nworkers * groups, sizeof(*partials));
+    GroupRow *rows = arenaAlloc((size_t)groups * sizeof(*rows));
+    if (!partials || !rows) {
+        printf("CMS: ERROR: Out of memory.\n");
+        return;
+    }
+
+    // single pass over the table, split across workers
+    GroupScan scan = { records, count, groups, partials };
+    runWorkers(nworkers, aggregate_slice, &scan);
+
+    // merge the per-worker partials into worker 0's table
+    for (int w = 1; w < nworkers; ++w) {
+        const GroupAgg *part = partials + (size_t)w * groups;
+        for (int p = 0; p < groups; ++p) {
+            GroupAgg *g = &partials[p];
+            if (part[p].count == 0) continue;
+            if (g->count == 0 || part[p].min < g->min) g->min = part[p].min;
+            if (g->count == 0 || part[p].max > g->max) g->max = part[p].max;
+            g->count += part[p].count;
+            g->sum += part[p].sum;
+            g->passed += part[p].passed;
+        }
+    }
+
+    int nrows = 0;
+    for (int p = 0; p < groups; ++p) {
+        if (partials[p].count == 0) continue;
+        rows[nrows].prog = (uint16_t)p;
+        rows[nrows].agg = partials[p];
+        nrows++;
+    }
+
+    sort_column = sort_col;
+    sort_asc = asc;
+    qsort(rows, (size_t)nrows, sizeof(*rows), compare_groups);
+
+    printf("CMS: SUMMARY BY PROGRAMME: %d programme(s), %d record(s)\n", nrows, count);
+    printf("%-24s %7s %8s %6s %6s %7s\n", "Programme", "Count", "Average", "Min", "Max", "Pass%");
+    for (int i = 0; i < nrows; ++i) {
+        const GroupAgg *g = &rows[i].agg;
+        char min_buf[MARK_BUF_LEN], max_buf[MARK_BUF_LEN];
+        printf("%-24s %7ld %8.2f %6s %6s %7.1f\n",
+               programmeName(rows[i].prog),
+               g->count,
+               group_avg(g) / 10.0,
+               formatMark((int16_t)g->min, min_buf),
+               formatMark((int16_t)g->max, max_buf),
+               group_pass_rate(g) * 100.0);
+    }
+}
+
+
+const int distPercentiles[DIST_PERCENTILES] = { 10, 25, 50, 75, 90 };
+
+int distBucket(int tenths) {
+    int b = tenths / 100;
+    if (b < 0) b = 0;
+    if (b >= DIST_BUCKETS) b = DIST_BUCKETS - 1;
+    return b;
+}
+
+// Hoare quickselect: afterwards a[k] holds the value of rank k and the slice
+// is partitioned around it. Expected linear time.
+static void select_rank(int16_t a[], long lo, long hi, long k) {
+    while (lo < hi) {
+        // median of three as the pivot keeps sorted input linear
+        long mid = lo + (hi - lo) / 2;
+        int16_t x = a[lo], y = a[mid], z = a[hi];
+        int16_t pivot = (x < y) ? ((y < z) ? y : (x < z ? z : x))
+                                : ((x < z) ? x : (y < z ? z : y));
+        long i = lo, j = hi;
+        while (i <= j) {
+            while (a[i] < pivot) i++;
+            while (a[j] > pivot) j--;
+            if (i <= j) {
+                int16_t tmp = a[i]; a[i] = a[j]; a[j] = tmp;
+                i++; j--;
+            }
+        }
+        if (k <= j) hi = j;
+        else if (k >= i) lo = i;
+        else return;   // a[j+1..i-1] all equal the pivot
+    }
+}
+
+void printDistribution(const char *title, long n, const int values[DIST_PERCENTILES],
+                       const long hist[DIST_BUCKETS], const char *note) {
+    printf("CMS: %s: %ld record(s)%s%s\n", title, n, note ? " " : "", note ? note : "");
+    for (int p = 0; p < DIST_PERCENTILES; ++p) {
+        char buf[MARK_BUF_LEN];
+        if (distPercentiles[p] == 50) printf("  Median        : %s\n", formatMark((int16_t)values[p], buf));
+        else printf("  p%-13d: %s\n", distPercentiles[p], formatMark((int16_t)values[p], buf));
+    }
+
+    long widest = 1;
+    for (int b = 0; b < DIST_BUCKETS; ++b) if (hist[b] > widest) widest = hist[b];
+    printf("  Histogram     :\n");
+    for (int b = 0; b < DIST_BUCKETS; ++b) {
+        int bar = (int)(hist[b] * 40 / widest);
+        printf("  %5.1f - %5.1f | %-40.*s %ld\n", b * 10.0, b == DIST_BUCKETS - 1 ? 100.0 : b * 10.0 + 9.9,
+               bar, "########################################", hist[b]);
+    }
+}
+
+void showDistribution(const StudentRecord records[], int count) {
+    if (!records) {
+        printf("CMS: ERROR: Internal error (null records pointer).\n");
+        return;
+    }
+    if (count <= 0) {
+        printf("CMS: The database is empty. No distribution available.\n");
+        return;
+    }
+
+    int16_t *marks = arenaAlloc((size_t)count * sizeof(*marks));
+    if (!marks) {
+        printf("CMS: ERROR: Out of memory.\n");
+        return;
+    }
+
+    long hist[DIST_BUCKETS] = { 0 };
+    for (int i = 0; i < count; ++i) {
+        marks[i] = records[i].mark;
+        hist[distBucket(records[i].mark)]++;
+    }
+
+    // Percentiles use the nearest rank ceil(p/100 * n). Ranks are increasing,
+    // so each selection only has to look right of the previous one.
+    int values[DIST_PERCENTILES];
+    long lo = 0;
+    for (int p = 0; p < DIST_PERCENTILES; ++p) {
+        long rank = ((long)distPercentiles[p] * count + 99) / 100 - 1;
+        if (rank < lo) rank = lo;
+        select_rank(marks, lo, count - 1, rank);
+        values[p] = marks[rank];
+        lo = rank;
+    }
+
+    printDistribution("DISTRIBUTION", count, values, hist, NULL);
+}
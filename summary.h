@@ -6,4 +6,38 @@
 
 void showSummary(const StudentRecord records[], int count);
 
+// Columns SHOW SUMMARY BY PROGRAMME can be ordered by
+typedef enum {
+    GROUP_COL_PROGRAMME,
+    GROUP_COL_COUNT,
+    GROUP_COL_AVG,
+    GROUP_COL_MIN,
+    GROUP_COL_MAX,
+    GROUP_COL_PASSRATE
+} GroupColumn;
+
+// Map a column name (PROGRAMME, COUNT, AVG, MIN, MAX, PASSRATE) to its
+// GroupColumn, case-insensitively. Returns -1 for an unknown name.
+int groupColumnFromName(const char *name);
+
+// Per-programme count, average, min, max and pass rate, ordered by sort_col.
+void showSummaryByProgramme(const StudentRecord records[], int count, GroupColumn sort_col, int asc);
+
+// Percentiles reported by SHOW DISTRIBUTION, and the width of a histogram bucket
+#define DIST_PERCENTILES 5
+#define DIST_BUCKETS 10
+extern const int distPercentiles[DIST_PERCENTILES];   // 10, 25, 50, 75, 90
+
+// p10/p25/median/p75/p90 (by linear-time selection) and a mark histogram.
+void showDistribution(const StudentRecord records[], int count);
+
+// Print already computed distribution figures. values[] are marks in tenths
+// at distPercentiles[]; hist[b] counts marks in [10b, 10b+10) (100.0 goes in
+// the last bucket). note is printed after the title when not NULL.
+void printDistribution(const char *title, long n, const int values[DIST_PERCENTILES],
+                       const long hist[DIST_BUCKETS], const char *note);
+
+// Bucket index for a mark in tenths
+int distBucket(int tenths);
+
 #endif
\ No newline at end of file
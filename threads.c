@@ -0,0 +1,143 @@
+// threads.c - thin pthread wrapper used by the parallel table scans.
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "threads.h"
+
+#define MAX_WORKERS 64
+
+typedef struct {
+    WorkerFn fn;
+    void *ctx;
+    int worker;
+    int nworkers;
+} WorkerArg;
+
+static void *worker_main(void *p) {
+    WorkerArg *arg = p;
+    arg->fn(arg->ctx, arg->worker, arg->nworkers);
+    return NULL;
+}
+
+int cpuCount(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) return 1;
+    if (n > MAX_WORKERS) return MAX_WORKERS;
+    return (int)n;
+}
+
+int workerCount(long items, long min_per_worker) {
+    if (min_per_worker < 1) min_per_worker = 1;
+    long n = items / min_per_worker;
+    int cpus = cpuCount();
+    if (n > cpus) n = cpus;
+    return n < 1 ? 1 : (int)n;
+}
+
+void runWorkers(int nworkers, WorkerFn fn, void *ctx) {
+    if (nworkers < 1) nworkers = 1;
+    if (nworkers > MAX_WORKERS) nworkers = MAX_WORKERS;
+
+    pthread_t tids[MAX_WORKERS];
+    WorkerArg args[MAX_WORKERS];
+    int started[MAX_WORKERS] = { 0 };
+
+    for (int w = 0; w < nworkers; ++w) {
+        args[w].fn = fn;
+        args[w].ctx = ctx;
+        args[w].worker = w;
+        args[w].nworkers = nworkers;
+    }
+
+    for (int w = 1; w < nworkers; ++w) {
+        started[w] = pthread_create(&tids[w], NULL, worker_main, &args[w]) == 0;
+    }
+
+    // worker 0 on this thread, plus any worker whose thread failed to start
+    fn(ctx, 0, nworkers);
+    for (int w = 1; w < nworkers; ++w) {
+        if (started[w]) pthread_join(tids[w], NULL);
+        else fn(ctx, w, nworkers);
+    }
+}
+
+// One worker's block of task numbers. The owner takes from the front, thieves
+// from the back.
+typedef struct {
+    pthread_mutex_t lock;
+    int head;
+    int tail;
+} TaskDeque;
+
+typedef struct {
+    TaskFn fn;
+    void *ctx;
+    TaskDeque deques[MAX_WORKERS];
+} TaskPool;
+
+static int take_front(TaskDeque *d) {
+    int task = -1;
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail) task = d->head++;
+    pthread_mutex_unlock(&d->lock);
+    return task;
+}
+
+static int take_back(TaskDeque *d) {
+    int task = -1;
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail) task = --d->tail;
+    pthread_mutex_unlock(&d->lock);
+    return task;
+}
+
+static void task_worker(void *p, int worker, int nworkers) {
+    TaskPool *pool = p;
+    for (;;) {
+        int task = take_front(&pool->deques[worker]);
+        // own block empty: steal, starting with the next worker along
+        for (int v = 1; task < 0 && v < nworkers; ++v) {
+            task = take_back(&pool->deques[(worker + v) % nworkers]);
+        }
+        if (task < 0) return;   // tasks never spawn tasks, so this is final
+        pool->fn(pool->ctx, task);
+    }
+}
+
+void runTasks(int nworkers, int ntasks, TaskFn fn, void *ctx) {
+    if (ntasks <= 0) return;
+    if (nworkers > ntasks) nworkers = ntasks;
+    if (nworkers > MAX_WORKERS) nworkers = MAX_WORKERS;
+    if (nworkers <= 1) {
+        for (int t = 0; t < ntasks; ++t) fn(ctx, t);
+        return;
+    }
+
+    TaskPool *pool = malloc(sizeof(*pool));
+    if (!pool) {
+        for (int t = 0; t < ntasks; ++t) fn(ctx, t);
+        return;
+    }
+    pool->fn = fn;
+    pool->ctx = ctx;
+    for (int w = 0; w < nworkers; ++w) {
+        long begin, end;
+        workerRange(ntasks, w, nworkers, &begin, &end);
+        pthread_mutex_init(&pool->deques[w].lock, NULL);
+        pool->deques[w].head = (int)begin;
+        pool->deques[w].tail = (int)end;
+    }
+
+    runWorkers(nworkers, task_worker, pool);
+
+    for (int w = 0; w < nworkers; ++w) pthread_mutex_destroy(&pool->deques[w].lock);
+    free(pool);
+}
+
+void workerRange(long n, int worker, int nworkers, long *begin, long *end) {
+    *begin = n * worker / nworkers;
+    *end = n * (worker + 1) / nworkers;
+}
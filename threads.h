@@ -0,0 +1,29 @@
+#ifndef THREADS_H
+#define THREADS_H
+
+// Helpers for splitting a table scan across worker threads.
+
+typedef void (*WorkerFn)(void *ctx, int worker, int nworkers);
+
+// Number of online CPUs (at least 1).
+int cpuCount(void);
+
+// How many workers to use for items rows when each worker should get at
+// least min_per_worker rows. Always at least 1, at most cpuCount().
+int workerCount(long items, long min_per_worker);
+
+// Run fn(ctx, w, nworkers) for w = 0..nworkers-1 and wait for all of them.
+// Worker 0 runs on the calling thread.
+void runWorkers(int nworkers, WorkerFn fn, void *ctx);
+
+// Run fn(ctx, t) for every task t = 0..ntasks-1 on nworkers threads and wait
+// for all of them. Tasks are dealt out in blocks; a worker that runs out takes
+// tasks from the far end of another worker's block (work stealing), so uneven
+// task costs still keep every thread busy.
+typedef void (*TaskFn)(void *ctx, int task);
+void runTasks(int nworkers, int ntasks, TaskFn fn, void *ctx);
+
+// The half-open slice [*begin, *end) of [0, n) owned by worker w.
+void workerRange(long n, int worker, int nworkers, long *begin, long *end);
+
+#endif
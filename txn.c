@@ -0,0 +1,351 @@
+// txn.c - undo log for BEGIN/COMMIT/ROLLBACK and the commit journal.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "txn.h"
+#include "arena.h"
+#include "names.h"
+#include "dict.h"
+#include "marks.h"
+#include "repl.h"
+
+typedef enum { UNDO_INSERT, UNDO_UPDATE, UNDO_DELETE } UndoKind;
+
+typedef struct {
+    UndoKind kind;
+    int index;              // row position when the change was made
+    StudentRecord before;   // UPDATE / DELETE
+    StudentRecord after;    // INSERT / UPDATE
+} UndoEntry;
+
+static int active = 0;
+static int rolling_back = 0;    // rollback edits must not log themselves
+static UndoEntry *undo_log = NULL;
+static int undo_count = 0;
+static int undo_cap = 0;
+
+// One committed journal operation, used while replaying
+typedef struct {
+    int id;
+    int seq;                // journal order, so the last change per ID wins
+    int is_delete;
+    StudentRecord image;    // PUT after-image (name already in the arena)
+} JournalOp;
+
+static void journal_path(const char *dbfile, char *out, size_t out_size) {
+    snprintf(out, out_size, "%s.journal", dbfile);
+}
+
+static void log_change(UndoKind kind, int index, const StudentRecord *before, const StudentRecord *after) {
+    if (!active || rolling_back) return;
+    if (undo_count == undo_cap) {
+        int new_cap = undo_cap ? undo_cap * 2 : 64;
+        UndoEntry *grown = realloc(undo_log, (size_t)new_cap * sizeof(*grown));
+        if (!grown) {
+            // cannot record the change any more; refuse to pretend we can undo it
+            printf("CMS: ERROR: Out of memory for the transaction log. ROLLBACK is no longer possible.\n");
+            return;
+        }
+        undo_log = grown;
+        undo_cap = new_cap;
+    }
+    UndoEntry *e = &undo_log[undo_count++];
+    memset(e, 0, sizeof(*e));
+    e->kind = kind;
+    e->index = index;
+    if (before) e->before = *before;
+    if (after) e->after = *after;
+}
+
+int txnActive(void) {
+    return active;
+}
+
+int txnBegin(void) {
+    if (active) return 0;
+    active = 1;
+    undo_count = 0;
+    replNoteBegin();
+    return 1;
+}
+
+int txnChangeCount(void) {
+    return undo_count;
+}
+
+void txnNoteInsert(int index, const StudentRecord *after) {
+    log_change(UNDO_INSERT, index, NULL, after);
+}
+
+void txnNoteUpdate(int index, const StudentRecord *before, const StudentRecord *after) {
+    log_change(UNDO_UPDATE, index, before, after);
+}
+
+void txnNoteDelete(int index, const StudentRecord *before) {
+    log_change(UNDO_DELETE, index, before, NULL);
+}
+
+// append printf-style text to a growable arena buffer; the outgrown copy
+// stays in the arena until the caller releases it
+static int buf_printf(char **buf, size_t *len, size_t *cap, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(*buf + *len, *cap - *len, fmt, ap);
+        va_end(ap);
+        if (n < 0) return 0;
+        if (*len + (size_t)n < *cap) {
+            *len += (size_t)n;
+            return 1;
+        }
+        size_t new_cap = *cap * 2 + (size_t)n;
+        char *grown = arenaAlloc(new_cap);
+        if (!grown) return 0;
+        memcpy(grown, *buf, *len);
+        *buf = grown;
+        *cap = new_cap;
+    }
+}
+
+int txnCommit(const char *dbfile) {
+    if (!active) return 0;
+
+    if (undo_count == 0) {
+        active = 0;
+        return 1;
+    }
+
+    // Build the whole transaction in memory so it reaches the journal in one write
+    ArenaMark arena_mark = arenaMark();
+    size_t len = 0, cap = 4096;
+    char *buf = arenaAlloc(cap);
+    int ok = buf != NULL && buf_printf(&buf, &len, &cap, "BEGIN\t%d\n", undo_count);
+    for (int i = 0; ok && i < undo_count; ++i) {
+        const UndoEntry *e = &undo_log[i];
+        if (e->kind == UNDO_DELETE) {
+            ok = buf_printf(&buf, &len, &cap, "DEL\t%d\n", e->before.id);
+        } else {
+            char mark[MARK_BUF_LEN];
+            ok = buf_printf(&buf, &len, &cap, "PUT\t%d\t%s\t%s\t%s\n",
+                            e->after.id, recordName(&e->after), programmeName(e->after.prog),
+                            formatMark(e->after.mark, mark));
+        }
+    }
+    if (ok) ok = buf_printf(&buf, &len, &cap, "COMMIT\t%d\n", undo_count);
+    if (!ok) {
+        printf("CMS: ERROR: Out of memory while preparing COMMIT.\n");
+        arenaRelease(arena_mark);
+        return 0;
+    }
+
+    char path[300];
+    journal_path(dbfile, path, sizeof(path));
+    FILE *fp = fopen(path, "ab");
+    if (!fp) {
+        printf("CMS: ERROR: Unable to open journal '%s'.\n", path);
+        arenaRelease(arena_mark);
+        return 0;
+    }
+
+    ok = fwrite(buf, 1, len, fp) == len && fflush(fp) == 0;
+#ifdef _WIN32
+    if (ok) ok = _commit(_fileno(fp)) == 0;
+#else
+    if (ok) ok = fsync(fileno(fp)) == 0;
+#endif
+    if (fclose(fp) == EOF) ok = 0;
+    arenaRelease(arena_mark);
+
+    if (!ok) {
+        printf("CMS: ERROR: Write to journal '%s' failed.\n", path);
+        return 0;
+    }
+
+    active = 0;
+    undo_count = 0;
+    return 1;
+}
+
+void txnRollback(StudentRecord records[], int *count) {
+    if (!active) return;
+
+    // walk the log backwards; each step restores the exact state before it
+    rolling_back = 1;
+    for (int i = undo_count - 1; i >= 0; --i) {
+        const UndoEntry *e = &undo_log[i];
+        switch (e->kind) {
+        case UNDO_INSERT: removeRow(records, count, e->index); break;
+        case UNDO_UPDATE: replaceRow(records, e->index, &e->before); break;
+        case UNDO_DELETE: insertRowAt(records, count, e->index, &e->before); break;
+        }
+    }
+    rolling_back = 0;
+    replNoteRollback();
+
+    active = 0;
+    undo_count = 0;
+}
+
+static int compare_ops_by_id(const void *pa, const void *pb) {
+    const JournalOp *a = pa, *b = pb;
+    return (a->id > b->id) - (a->id < b->id);
+}
+
+static int compare_ops(const void *pa, const void *pb) {
+    int cmp = compare_ops_by_id(pa, pb);
+    if (cmp != 0) return cmp;
+    const JournalOp *a = pa, *b = pb;
+    return (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+// parse one "PUT\t..." or "DEL\t..." line; PUT names go straight into the arena
+static int parse_op(char *line, JournalOp *op) {
+    memset(op, 0, sizeof(*op));
+    char *fields[5];
+    int n = 0;
+    char *p = line;
+    fields[n++] = p;
+    while (n < 5 && (p = strchr(p, '\t')) != NULL) {
+        *p++ = '\0';
+        fields[n++] = p;
+    }
+
+    if (strcmp(fields[0], "DEL") == 0 && n >= 2) {
+        op->id = atoi(fields[1]);
+        op->is_delete = 1;
+        return 1;
+    }
+    if (strcmp(fields[0], "PUT") != 0 || n != 5) return 0;
+
+    int mark = 0;
+    int prog = internProgramme(fields[3]);
+    if (prog < 0 || !parseMark(fields[4], &mark)) return 0;
+    op->id = atoi(fields[1]);
+    op->image.id = op->id;
+    op->image.prog = (uint16_t)prog;
+    op->image.mark = (int16_t)mark;
+    return storeRecordName(&op->image, fields[2]);
+}
+
+int replayJournal(const char *dbfile, StudentRecord records[], int *count) {
+    char path[300];
+    journal_path(dbfile, path, sizeof(path));
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;   // no journal, nothing to do
+
+    ArenaMark mark = arenaMark();
+    JournalOp *ops = NULL;
+    int committed = 0, staged = 0, cap = 0;
+    int in_block = 0, expected = 0;
+    char line[1024];
+
+    // Collect operations; a block only counts once its COMMIT line is seen,
+    // so a transaction torn by a crash is ignored.
+    while (fgets(line, sizeof(line), fp)) {
+        size_t L = strlen(line);
+        while (L > 0 && (line[L - 1] == '\n' || line[L - 1] == '\r')) line[--L] = '\0';
+
+        if (strncmp(line, "BEGIN\t", 6) == 0) {
+            for (int i = committed; i < committed + staged; ++i) releaseRecordName(&ops[i].image);
+            staged = 0;
+            in_block = 1;
+            expected = atoi(line + 6);
+        } else if (strncmp(line, "COMMIT\t", 7) == 0) {
+            if (in_block && atoi(line + 7) == expected && staged == expected) committed += staged;
+            else for (int i = committed; i < committed + staged; ++i) releaseRecordName(&ops[i].image);
+            staged = 0;
+            in_block = 0;
+        } else if (in_block) {
+            if (committed + staged == cap) {
+                int new_cap = cap ? cap * 2 : 256;
+                JournalOp *grown = arenaAlloc((size_t)new_cap * sizeof(*grown));
+                if (!grown) {
+                    arenaRelease(mark);
+                    fclose(fp);
+                    return -1;
+                }
+                if (cap) memcpy(grown, ops, (size_t)cap * sizeof(*grown));
+                ops = grown;
+                cap = new_cap;
+            }
+            JournalOp *op = &ops[committed + staged];
+            if (parse_op(line, op)) {
+                op->seq = committed + staged;
+                staged++;
+            } else {
+                in_block = 0;   // corrupt block: drop it
+                for (int i = committed; i < committed + staged; ++i) releaseRecordName(&ops[i].image);
+                staged = 0;
+            }
+        }
+    }
+    for (int i = committed; i < committed + staged; ++i) releaseRecordName(&ops[i].image);
+    fclose(fp);
+
+    if (committed == 0) {
+        arenaRelease(mark);
+        return 0;
+    }
+
+    // Keep only the last operation per ID
+    qsort(ops, (size_t)committed, sizeof(*ops), compare_ops);
+    int unique = 0;
+    for (int i = 0; i < committed; ++i) {
+        if (i + 1 < committed && ops[i + 1].id == ops[i].id) {
+            if (!ops[i].is_delete) releaseRecordName(&ops[i].image);
+            continue;
+        }
+        ops[unique++] = ops[i];
+    }
+
+    // One pass over the table: replace or drop rows that have an operation
+    tableReloaded();
+    char *used = arenaCalloc((size_t)unique, 1);
+    if (!used) {
+        arenaRelease(mark);
+        return -1;
+    }
+    int applied = 0, out = 0;
+    for (int i = 0; i < *count; ++i) {
+        JournalOp key = { .id = records[i].id };
+        JournalOp *op = bsearch(&key, ops, (size_t)unique, sizeof(*ops), compare_ops_by_id);
+        if (op) {
+            used[op - ops] = 1;
+            applied++;
+            releaseRecordName(&records[i]);
+            if (op->is_delete) continue;
+            records[i] = op->image;
+        }
+        records[out++] = records[i];
+    }
+    *count = out;
+
+    // IDs the file did not have yet are appended
+    for (int u = 0; u < unique; ++u) {
+        if (used[u] || ops[u].is_delete) continue;
+        if (*count >= MAX_RECORDS) {
+            releaseRecordName(&ops[u].image);
+            continue;
+        }
+        records[(*count)++] = ops[u].image;
+        applied++;
+    }
+
+    arenaRelease(mark);
+    return applied;
+}
+
+void clearJournal(const char *dbfile) {
+    char path[300];
+    journal_path(dbfile, path, sizeof(path));
+    remove(path);
+}
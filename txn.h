@@ -0,0 +1,40 @@
+#ifndef TXN_H
+#define TXN_H
+
+#include "records.h"
+
+// Multi-statement transactions (BEGIN / COMMIT / ROLLBACK).
+//
+// While a transaction is open every row edit is recorded in an in-memory undo
+// log. ROLLBACK replays that log backwards. COMMIT appends the transaction's
+// after-images to "<dbfile>.journal" with one write and one fsync; OPEN
+// replays committed journal entries on top of the database file and a
+// successful SAVE empties the journal again.
+
+int txnActive(void);
+int txnBegin(void);
+
+// Number of row changes recorded in the open transaction.
+int txnChangeCount(void);
+
+// Called by the row edit functions in records.c.
+void txnNoteInsert(int index, const StudentRecord *after);
+void txnNoteUpdate(int index, const StudentRecord *before, const StudentRecord *after);
+void txnNoteDelete(int index, const StudentRecord *before);
+
+// Persist the open transaction to the journal and close it. Returns 1 on
+// success; on failure the transaction stays open so it can be retried or
+// rolled back.
+int txnCommit(const char *dbfile);
+
+// Undo every change of the open transaction and close it.
+void txnRollback(StudentRecord records[], int *count);
+
+// Apply committed journal entries for dbfile. Returns the number of rows
+// changed, or -1 on error.
+int replayJournal(const char *dbfile, StudentRecord records[], int *count);
+
+// Empty the journal once the database file itself holds every change.
+void clearJournal(const char *dbfile);
+
+#endif
@@ -0,0 +1,161 @@
+// views.c - sorted-order cache with incremental repair
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "views.h"
+
+#define VIEW_SLOTS 4
+#define VIEW_REPAIR_LIMIT 64    // more changes than this and a full sort is cheaper
+
+typedef struct {
+    int used;
+    SortSpec spec;
+    unsigned long version;      // table version the order is valid for
+    unsigned long last_use;
+    int count;
+    int cap;
+    int *perm;
+} View;
+
+static View views[VIEW_SLOTS];
+static unsigned long use_clock = 0;
+
+static int same_spec(const SortSpec *a, const SortSpec *b) {
+    if (a->n != b->n) return 0;
+    for (int k = 0; k < a->n; ++k) {
+        if (a->field[k] != b->field[k] || a->asc[k] != b->asc[k]) return 0;
+    }
+    return 1;
+}
+
+static int reserve(View *v, int count) {
+    if (count <= v->cap) return 1;
+    int *grown = realloc(v->perm, (size_t)count * sizeof(*grown));
+    if (!grown) return 0;
+    v->perm = grown;
+    v->cap = count;
+    return 1;
+}
+
+static int compare_int(const void *pa, const void *pb) {
+    int a = *(const int *)pa, b = *(const int *)pb;
+    return (a > b) - (a < b);
+}
+
+// Bring v up to the current table version using the change log. Rows that
+// were inserted or updated are pulled out and re-placed by binary search;
+// every other row keeps its relative order, only its index shifts.
+static int repair(View *v, const StudentRecord records[], int count) {
+    RowChange changes[VIEW_REPAIR_LIMIT];
+    int n = rowChangesSince(v->version, changes, VIEW_REPAIR_LIMIT);
+    if (n < 0) return 0;
+
+    int dirty[VIEW_REPAIR_LIMIT];   // current indices of rows to re-place
+    int ndirty = 0;
+    int *perm = v->perm;
+    int m = v->count;
+
+    for (int c = 0; c < n; ++c) {
+        int at = changes[c].index;
+        switch (changes[c].kind) {
+        case ROW_INSERTED:
+            for (int k = 0; k < m; ++k) perm[k] += perm[k] >= at;
+            for (int d = 0; d < ndirty; ++d) dirty[d] += dirty[d] >= at;
+            dirty[ndirty++] = at;
+            break;
+        case ROW_DELETED: {
+            int out = 0;
+            for (int k = 0; k < m; ++k) {
+                if (perm[k] == at) continue;
+                perm[out++] = perm[k] - (perm[k] > at);
+            }
+            m = out;
+            out = 0;
+            for (int d = 0; d < ndirty; ++d) {
+                if (dirty[d] == at) continue;
+                dirty[out++] = dirty[d] - (dirty[d] > at);
+            }
+            ndirty = out;
+            break;
+        }
+        case ROW_UPDATED: {
+            int seen = 0;
+            for (int d = 0; d < ndirty; ++d) seen |= dirty[d] == at;
+            if (!seen) dirty[ndirty++] = at;
+            break;
+        }
+        }
+    }
+
+    // take the changed rows out, then put each back where it now belongs
+    qsort(dirty, (size_t)ndirty, sizeof(*dirty), compare_int);
+    int out = 0;
+    for (int k = 0; k < m; ++k) {
+        if (bsearch(&perm[k], dirty, (size_t)ndirty, sizeof(*dirty), compare_int)) continue;
+        perm[out++] = perm[k];
+    }
+    m = out;
+    if (m + ndirty != count || !reserve(v, count)) return 0;
+    perm = v->perm;
+
+    for (int d = 0; d < ndirty; ++d) {
+        int lo = 0, hi = m;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (compareRowsBySpec(records, &v->spec, perm[mid], dirty[d]) < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        memmove(&perm[lo + 1], &perm[lo], (size_t)(m - lo) * sizeof(*perm));
+        perm[lo] = dirty[d];
+        m++;
+    }
+
+    v->count = m;
+    v->version = tableVersion();
+    return 1;
+}
+
+static View *find_view(const StudentRecord records[], int count, const SortSpec *spec) {
+    for (int s = 0; s < VIEW_SLOTS; ++s) {
+        View *v = &views[s];
+        if (!v->used || !same_spec(&v->spec, spec)) continue;
+        if (v->version == tableVersion() && v->count == count) return v;
+        if (repair(v, records, count)) return v;
+        v->used = 0;    // too far behind; the caller rebuilds
+        return NULL;
+    }
+    return NULL;
+}
+
+const int *cachedView(const StudentRecord records[], int count, const SortSpec *spec) {
+    View *v = find_view(records, count, spec);
+    if (!v) return NULL;
+    v->last_use = ++use_clock;
+    return v->perm;
+}
+
+const int *sortedView(const StudentRecord records[], int count, const SortSpec *spec) {
+    const int *perm = cachedView(records, count, spec);
+    if (perm) return perm;
+
+    // reuse a free slot, else the least recently used one
+    View *v = &views[0];
+    for (int s = 0; s < VIEW_SLOTS; ++s) {
+        if (!views[s].used) {
+            v = &views[s];
+            break;
+        }
+        if (views[s].last_use < v->last_use) v = &views[s];
+    }
+
+    v->used = 0;
+    if (!reserve(v, count > 0 ? count : 1)) return NULL;
+    if (!buildSortedOrder(records, count, spec, v->perm)) return NULL;
+    v->used = 1;
+    v->spec = *spec;
+    v->count = count;
+    v->version = tableVersion();
+    v->last_use = ++use_clock;
+    return v->perm;
+}
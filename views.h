@@ -0,0 +1,21 @@
+#ifndef VIEWS_H
+#define VIEWS_H
+
+#include "records.h"
+#include "sort.h"
+
+// Cache of sorted row orders ("views"), keyed by sort spec and the table
+// version (records.h). A view that is a few edits behind is repaired from the
+// change log by re-placing only the rows that changed; anything older is
+// rebuilt with a full sort.
+
+// Row indices of records[0..count) in spec order, from the cache when
+// possible. Owned by the cache and valid until the next table edit. NULL when
+// out of memory.
+const int *sortedView(const StudentRecord records[], int count, const SortSpec *spec);
+
+// Like sortedView, but never sorts from scratch: NULL unless a current or
+// repairable view for spec already exists.
+const int *cachedView(const StudentRecord records[], int count, const SortSpec *spec);
+
+#endif
@@ -0,0 +1,214 @@
+// watch.c - WATCH: load rows appended to the database file by other processes
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "watch.h"
+#include "database.h"
+#include "history.h"
+#include "txn.h"
+
+#define PROBE_LEN 64    // bytes just before the offset, compared to spot a rewrite
+
+static struct {
+    int active;
+    char path[260];
+    long offset;                    // bytes of the file the table holds
+    unsigned char probe[PROBE_LEN]; // the file's last bytes before offset
+    int probe_len;
+    unsigned long long ino;
+    long long mtime;                // nanoseconds
+    int pending;                    // a change is waiting for the transaction to close
+    long rows_loaded;
+    int reloads;
+#ifdef __linux__
+    int fd;
+    int wd;
+#endif
+} w;
+
+static long long mtime_of(const struct stat *st) {
+#ifdef __linux__
+    return (long long)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+#else
+    return (long long)st->st_mtime * 1000000000LL;
+#endif
+}
+
+// The (up to PROBE_LEN) bytes ending at offset. Returns their count, or -1.
+static int read_probe(long offset, unsigned char *buf) {
+    long start = offset > PROBE_LEN ? offset - PROBE_LEN : 0;
+    FILE *fp = fopen(w.path, "rb");
+    if (!fp) return -1;
+    int n = -1;
+    if (fseek(fp, start, SEEK_SET) == 0) n = (int)fread(buf, 1, (size_t)(offset - start), fp);
+    fclose(fp);
+    return n == offset - start ? n : -1;
+}
+
+// Remember the file as it is now, with offset bytes reflected in the table.
+static void take_baseline(long offset) {
+    struct stat st;
+    w.offset = offset;
+    w.probe_len = read_probe(offset, w.probe);
+    if (stat(w.path, &st) == 0) {
+        w.ino = (unsigned long long)st.st_ino;
+        w.mtime = mtime_of(&st);
+    }
+}
+
+#ifdef __linux__
+// (Re)attach the inotify watch to whatever file the path names now.
+static void arm(void) {
+    if (w.wd >= 0) inotify_rm_watch(w.fd, w.wd);
+    w.wd = inotify_add_watch(w.fd, w.path, IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+}
+
+// Drain the queued events. Returns 1 if any arrived (or the watch is lost).
+static int events_pending(void) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int seen = 0, rearm = w.wd < 0;
+    ssize_t n;
+    while ((n = read(w.fd, buf, sizeof(buf))) > 0) {
+        seen = 1;
+        for (char *p = buf; p < buf + n;) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) rearm = 1;
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+    if (rearm) {
+        if (w.wd >= 0) inotify_rm_watch(w.fd, w.wd);
+        w.wd = -1;
+        arm();
+        seen = 1;
+    }
+    return seen;
+}
+#else
+// Without inotify, compare the file's identity, size and time stamp.
+static int events_pending(void) {
+    struct stat st;
+    if (stat(w.path, &st) != 0) return 0;
+    return (unsigned long long)st.st_ino != w.ino || (long)st.st_size != w.offset || mtime_of(&st) != w.mtime;
+}
+#endif
+
+int watchStart(const char *filename, long offset) {
+    if (w.active) watchStop();
+    memset(&w, 0, sizeof(w));
+    strncpy(w.path, filename, sizeof(w.path) - 1);
+#ifdef __linux__
+    w.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    w.wd = -1;
+    if (w.fd < 0) {
+        printf("CMS: ERROR: Cannot watch \"%s\" (inotify unavailable).\n", filename);
+        return 0;
+    }
+    arm();
+    if (w.wd < 0) {
+        printf("CMS: ERROR: Cannot watch \"%s\".\n", filename);
+        close(w.fd);
+        return 0;
+    }
+#endif
+    take_baseline(offset);
+    w.active = 1;
+    return 1;
+}
+
+void watchStop(void) {
+    if (!w.active) return;
+#ifdef __linux__
+    close(w.fd);
+#endif
+    w.active = 0;
+}
+
+int watchActive(void) {
+    return w.active;
+}
+
+void watchRebase(long offset) {
+    if (!w.active) return;
+#ifdef __linux__
+    events_pending();   // our own writes
+#endif
+    w.pending = 0;
+    take_baseline(offset);
+}
+
+void watchStatus(void) {
+    if (!w.active) {
+        printf("CMS: WATCH is off.\n");
+        return;
+    }
+#ifdef __linux__
+    const char *how = "inotify";
+#else
+    const char *how = "polling";
+#endif
+    printf("CMS: WATCH STATUS\n");
+    printf("  File          : %s (%s)\n", w.path, how);
+    printf("  Loaded up to  : byte %ld\n", w.offset);
+    printf("  Rows appended : %ld\n", w.rows_loaded);
+    printf("  Full reloads  : %d\n", w.reloads);
+    if (w.pending) printf("  Pending       : changes wait for the open transaction\n");
+}
+
+// The file was replaced or edited before the offset: parse it all again.
+static int reload(StudentRecord records[], int *count) {
+    char msg[HISTORY_DESC_LEN];
+    if (loadDB(w.path, records, count) != 1) {
+        printf("CMS: WATCH: \"%s\" was rewritten and could not be reloaded. WATCH stopped.\n", w.path);
+        addHistory("WATCH: Reload failed - stopped");
+        watchStop();
+        return 0;
+    }
+    w.reloads++;
+    take_baseline(loadedBytes());
+    printf("CMS: WATCH: \"%s\" was rewritten; reloaded %d record(s). Unsaved changes were discarded.\n", w.path, *count);
+    snprintf(msg, sizeof(msg), "WATCH: Reloaded %d record(s) after a rewrite", *count);
+    addHistory(msg);
+    return *count;
+}
+
+int watchPoll(StudentRecord records[], int *count) {
+    if (!w.active) return 0;
+    if (events_pending()) w.pending = 1;
+    if (!w.pending || txnActive()) return 0;
+    w.pending = 0;
+
+    struct stat st;
+    if (stat(w.path, &st) != 0) return 0;   // gone for now; a new file is picked up when it appears
+
+    unsigned char probe[PROBE_LEN];
+    int rewritten = (unsigned long long)st.st_ino != w.ino || (long)st.st_size < w.offset || w.probe_len < 0 ||
+                    read_probe(w.offset, probe) != w.probe_len || memcmp(probe, w.probe, (size_t)w.probe_len) != 0;
+    if (!rewritten && (long)st.st_size == w.offset) {
+        // same size: only a changed time stamp means the text was edited
+        if (mtime_of(&st) == w.mtime) return 0;
+        rewritten = 1;
+    }
+    if (rewritten) return reload(records, count);
+
+    int skipped = 0;
+    long offset = w.offset;
+    int added = loadTail(w.path, &offset, records, count, &skipped);
+    take_baseline(offset);
+    if (added < 0 || (added == 0 && skipped == 0)) return 0;     // e.g. only half a line so far
+    w.rows_loaded += added;
+
+    char msg[HISTORY_DESC_LEN];
+    printf("CMS: WATCH: Loaded %d new row(s) from \"%s\".\n", added, w.path);
+    if (skipped > 0) printf("CMS: WARNING: %d appended row(s) repeat an existing ID and were skipped.\n", skipped);
+    snprintf(msg, sizeof(msg), "WATCH: Loaded %d appended row(s)", added);
+    addHistory(msg);
+    return added;
+}
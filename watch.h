@@ -0,0 +1,28 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "records.h"
+
+// WATCH: keep the table in step with rows other processes append to the
+// database file. The watcher remembers how many bytes of the file the table
+// reflects. When the file changes (inotify on Linux, a stat check elsewhere)
+// only the lines past that offset are parsed and appended. A file that
+// shrank, was replaced, or changed before the offset is reloaded in full.
+
+// Start watching filename, whose first offset bytes the table already holds.
+// Returns 1 on success.
+int watchStart(const char *filename, long offset);
+void watchStop(void);
+int watchActive(void);
+void watchStatus(void);
+
+// The table was just loaded from or saved to the watched file, which is now
+// offset bytes long: take that as the new starting point.
+void watchRebase(long offset);
+
+// Apply changes to the watched file since the last call. Called before each
+// command; changes wait while a transaction is open. Returns the number of
+// rows added or reloaded.
+int watchPoll(StudentRecord records[], int *count);
+
+#endif
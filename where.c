@@ -0,0 +1,224 @@
+// where.c parses WHERE predicates and evaluates them over the table.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "where.h"
+#include "dict.h"
+#include "marks.h"
+
+static const char *skip_spaces(const char *p) {
+    while (*p && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+// case-insensitive prefix test
+static int starts_with_ci(const char *s, const char *prefix) {
+    while (*prefix) {
+        if (toupper((unsigned char)*s) != toupper((unsigned char)*prefix)) return 0;
+        s++; prefix++;
+    }
+    return 1;
+}
+
+const char *findKeyword(const char *s, const char *word) {
+    size_t n = strlen(word);
+    for (const char *p = s; *p; ++p) {
+        if ((p == s || isspace((unsigned char)p[-1])) && starts_with_ci(p, word) &&
+            (p[n] == '\0' || isspace((unsigned char)p[n]))) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static int field_value(const StudentRecord *r, PredField field) {
+    switch (field) {
+    case FIELD_ID:        return r->id;
+    case FIELD_MARK:      return r->mark;
+    case FIELD_PROGRAMME: return r->prog;
+    }
+    return 0;
+}
+
+static int test_value(const Condition *c, int v) {
+    switch (c->op) {
+    case OP_EQ:      return v == c->lo;
+    case OP_NE:      return v != c->lo;
+    case OP_LT:      return v < c->lo;
+    case OP_LE:      return v <= c->lo;
+    case OP_GT:      return v > c->lo;
+    case OP_GE:      return v >= c->lo;
+    case OP_BETWEEN: return v >= c->lo && v <= c->hi;
+    }
+    return 0;
+}
+
+// parse a numeric operand for ID or Mark; *end gets the first unused char
+static int parse_number(PredField field, const char *p, const char **end, int *out) {
+    const char *q = p;
+    while (*q && !isspace((unsigned char)*q)) q++;
+    char tok[32];
+    size_t len = (size_t)(q - p);
+    if (len == 0 || len >= sizeof(tok)) return 0;
+    memcpy(tok, p, len);
+    tok[len] = '\0';
+    *end = q;
+
+    if (field == FIELD_MARK) return parseMark(tok, out);
+
+    char *stop = NULL;
+    long v = strtol(tok, &stop, 10);
+    if (*stop != '\0') return 0;
+    *out = (int)v;
+    return 1;
+}
+
+static int parse_where(const char *text, Predicate *pred, char *err, size_t err_size, int intern) {
+    pred->n = 0;
+    const char *p = skip_spaces(text ? text : "");
+    if (*p == '\0') {
+        snprintf(err, err_size, "WHERE needs at least one condition");
+        return 0;
+    }
+
+    for (;;) {
+        if (pred->n == MAX_CONDITIONS) {
+            snprintf(err, err_size, "too many conditions (at most %d)", MAX_CONDITIONS);
+            return 0;
+        }
+        Condition *c = &pred->cond[pred->n];
+
+        // field name
+        if (starts_with_ci(p, "PROGRAMME")) { c->field = FIELD_PROGRAMME; p += 9; }
+        else if (starts_with_ci(p, "MARK")) { c->field = FIELD_MARK; p += 4; }
+        else if (starts_with_ci(p, "ID")) { c->field = FIELD_ID; p += 2; }
+        else {
+            snprintf(err, err_size, "unknown field near '%.20s' (use ID, Mark or Programme)", p);
+            return 0;
+        }
+        p = skip_spaces(p);
+
+        // operator
+        if (starts_with_ci(p, "BETWEEN") && isspace((unsigned char)p[7])) { c->op = OP_BETWEEN; p += 7; }
+        else if (p[0] == '<' && p[1] == '=') { c->op = OP_LE; p += 2; }
+        else if (p[0] == '>' && p[1] == '=') { c->op = OP_GE; p += 2; }
+        else if (p[0] == '!' && p[1] == '=') { c->op = OP_NE; p += 2; }
+        else if (p[0] == '<' && p[1] == '>') { c->op = OP_NE; p += 2; }
+        else if (p[0] == '=' && p[1] == '=') { c->op = OP_EQ; p += 2; }
+        else if (p[0] == '=') { c->op = OP_EQ; p += 1; }
+        else if (p[0] == '<') { c->op = OP_LT; p += 1; }
+        else if (p[0] == '>') { c->op = OP_GT; p += 1; }
+        else {
+            snprintf(err, err_size, "missing comparison near '%.20s'", p);
+            return 0;
+        }
+        p = skip_spaces(p);
+
+        if (c->field == FIELD_PROGRAMME) {
+            if (c->op != OP_EQ && c->op != OP_NE) {
+                snprintf(err, err_size, "Programme only supports = and !=");
+                return 0;
+            }
+            // quoted, or everything up to the next AND
+            char name[256];
+            const char *end;
+            if (*p == '\'' || *p == '"') {
+                const char *close = strchr(p + 1, *p);
+                if (!close) {
+                    snprintf(err, err_size, "unterminated quote in Programme value");
+                    return 0;
+                }
+                end = close + 1;
+                p++;
+                size_t len = (size_t)(close - p);
+                if (len >= sizeof(name)) len = sizeof(name) - 1;
+                memcpy(name, p, len);
+                name[len] = '\0';
+            } else {
+                const char *and_kw = findKeyword(p, "AND");
+                end = and_kw ? and_kw : p + strlen(p);
+                size_t len = (size_t)(end - p);
+                while (len > 0 && isspace((unsigned char)p[len - 1])) len--;
+                if (len >= sizeof(name)) len = sizeof(name) - 1;
+                memcpy(name, p, len);
+                name[len] = '\0';
+            }
+            if (name[0] == '\0') {
+                snprintf(err, err_size, "empty Programme value");
+                return 0;
+            }
+            // a programme never seen cannot match any row
+            c->lo = intern ? internProgramme(name) : findProgramme(name);
+            p = end;
+        } else {
+            if (!parse_number(c->field, p, &p, &c->lo)) {
+                snprintf(err, err_size, "invalid %s value", c->field == FIELD_ID ? "ID" : "Mark");
+                return 0;
+            }
+            if (c->op == OP_BETWEEN) {
+                p = skip_spaces(p);
+                if (!starts_with_ci(p, "AND") || !isspace((unsigned char)p[3])) {
+                    snprintf(err, err_size, "BETWEEN needs '<low> AND <high>'");
+                    return 0;
+                }
+                p = skip_spaces(p + 3);
+                if (!parse_number(c->field, p, &p, &c->hi)) {
+                    snprintf(err, err_size, "invalid %s value", c->field == FIELD_ID ? "ID" : "Mark");
+                    return 0;
+                }
+            }
+        }
+        pred->n++;
+
+        p = skip_spaces(p);
+        if (*p == '\0') return 1;
+        if (!starts_with_ci(p, "AND") || !isspace((unsigned char)p[3])) {
+            snprintf(err, err_size, "expected AND near '%.20s'", p);
+            return 0;
+        }
+        p = skip_spaces(p + 3);
+    }
+}
+
+int parseWhere(const char *text, Predicate *pred, char *err, size_t err_size) {
+    return parse_where(text, pred, err, err_size, 0);
+}
+
+int parseWhereInterning(const char *text, Predicate *pred, char *err, size_t err_size) {
+    return parse_where(text, pred, err, err_size, 1);
+}
+
+int matchRow(const Predicate *pred, const StudentRecord *r) {
+    for (int c = 0; c < pred->n; ++c) {
+        if (!test_value(&pred->cond[c], field_value(r, pred->cond[c].field))) return 0;
+    }
+    return 1;
+}
+
+int selectRows(const StudentRecord records[], int count, const Predicate *pred, int sel[]) {
+    if (pred->n == 0) return 0;
+
+    // first condition scans the whole column ...
+    const Condition *first = &pred->cond[0];
+    int n = 0;
+    for (int i = 0; i < count; ++i) {
+        sel[n] = i;
+        n += test_value(first, field_value(&records[i], first->field));   // branch-free append
+    }
+
+    // ... and each further condition only filters the surviving rows
+    for (int c = 1; c < pred->n && n > 0; ++c) {
+        const Condition *cond = &pred->cond[c];
+        int kept = 0;
+        for (int k = 0; k < n; ++k) {
+            int i = sel[k];
+            sel[kept] = i;
+            kept += test_value(cond, field_value(&records[i], cond->field));
+        }
+        n = kept;
+    }
+    return n;
+}
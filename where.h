@@ -0,0 +1,49 @@
+#ifndef WHERE_H
+#define WHERE_H
+
+#include <stddef.h>
+
+#include "records.h"
+
+// WHERE predicates: conditions joined by AND, e.g.
+//   Programme=Computer Science AND Mark<40
+//   ID BETWEEN 2300000 AND 2399999
+// Fields are ID, Mark and Programme (case-insensitive). Marks are compared in
+// tenths and programmes by dictionary code, so every test is an integer compare.
+
+#define MAX_CONDITIONS 8
+
+typedef enum { FIELD_ID, FIELD_MARK, FIELD_PROGRAMME } PredField;
+typedef enum { OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE, OP_BETWEEN } PredOp;
+
+typedef struct {
+    PredField field;
+    PredOp op;
+    int lo;     // value (ID, mark tenths or programme code), or BETWEEN lower bound
+    int hi;     // BETWEEN upper bound
+} Condition;
+
+typedef struct {
+    int n;
+    Condition cond[MAX_CONDITIONS];
+} Predicate;
+
+// Parse text into pred. Returns 1 on success, otherwise 0 with a message in err.
+int parseWhere(const char *text, Predicate *pred, char *err, size_t err_size);
+
+// As parseWhere, but the programmes the clause names are added to the
+// dictionary, for matching files that know programmes this run has not seen.
+int parseWhereInterning(const char *text, Predicate *pred, char *err, size_t err_size);
+
+// True when r satisfies every condition.
+int matchRow(const Predicate *pred, const StudentRecord *r);
+
+// Evaluate pred column by column over records[0..count) and write the
+// matching row indices (ascending) to sel. Returns the number of matches.
+int selectRows(const StudentRecord records[], int count, const Predicate *pred, int sel[]);
+
+// Case-insensitive search for " AND " style keywords: returns a pointer to the
+// first whole-word occurrence of word in s, or NULL.
+const char *findKeyword(const char *s, const char *word);
+
+#endif